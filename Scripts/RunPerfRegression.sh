@@ -0,0 +1,82 @@
+#!/usr/bin/env bash
+# Perf regression check: replays the recorded session corpus (the Replay_* scenarios of UPerfScenarioSubsystem in
+# Config/DefaultGame.ini) headless at the recorded fixed time steps, and fails when any game or physics timing
+# percentile regressed past the baseline's by more than the configured tolerance. The run is standalone, with no
+# net driver or connections, so net timings are written to the results but not compared against the baseline.
+#
+# Usage: Scripts/RunPerfRegression.sh [-s scenario_wildcard] [-b baseline.json] [-o output.json] [-m map] [-u]
+#
+# The corpus has to be recorded first: record sessions with -InputRecord (see UInputRecordingSubsystem), keep them
+# under Perf/Sessions and add a Replay_* scenario listing them. Until then no scenario matches and the run exits with 2.
+# -u copies the results over the baseline when the run passes, or when there is no baseline yet; commit it with the
+# corpus so every later run compares against the same numbers.
+# Uses the editor binary in -game mode by default; point GAME_BIN at a packaged MilitaryVehicleSim binary instead.
+set -euo pipefail
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_DIR="$(dirname "$SCRIPT_DIR")"
+PROJECT="$PROJECT_DIR/MilitaryVehicleSim.uproject"
+
+SCENARIO="Replay_*"
+MAP=NewMap
+UPDATE_BASELINE=0
+LABEL="$(git -C "$PROJECT_DIR" rev-parse --short HEAD 2>/dev/null || echo unknown)"
+BASELINE=""
+OUTPUT="$PROJECT_DIR/Saved/Perf/Regression-$LABEL-$(date +%Y%m%d-%H%M%S).json"
+
+while getopts "s:b:o:m:u" opt; do
+	case "$opt" in
+		s) SCENARIO="$OPTARG" ;;
+		b) BASELINE="$OPTARG" ;;
+		o) OUTPUT="$OPTARG" ;;
+		m) MAP="$OPTARG" ;;
+		u) UPDATE_BASELINE=1 ;;
+		*) sed -n '2,13p' "$0"; exit 1 ;;
+	esac
+done
+BASELINE="${BASELINE:-$PROJECT_DIR/Perf/Baselines/Replay-$MAP.json}"
+
+if [[ -z "${GAME_BIN:-}" ]]; then
+	: "${UE_ROOT:?Set UE_ROOT to the engine directory, or GAME_BIN to a packaged binary}"
+	GAME_CMD=("$UE_ROOT/Engine/Binaries/Linux/UnrealEditor" "$PROJECT" "$MAP" -game)
+else
+	GAME_CMD=("$GAME_BIN" "$MAP")
+fi
+
+BASELINE_ARG=()
+if [[ -f "$BASELINE" ]]; then
+	BASELINE_ARG=(-PerfBaseline="$BASELINE")
+	echo "Perf regression: $SCENARIO on $MAP at $LABEL against $BASELINE -> $OUTPUT"
+else
+	echo "Perf regression: no baseline at $BASELINE, only budgets are checked (run with -u to create it)"
+fi
+
+mkdir -p "$(dirname "$OUTPUT")"
+
+# Playback fixes the time step to the recorded frame times; the unlocked frame rate lets frames run back to back
+set +e
+"${GAME_CMD[@]}" -nullrhi -unattended -nosound -NoSplash -log -NoVSync -ExecCmds="t.MaxFPS 0" \
+	-PerfTest="$SCENARIO" -PerfJson="$OUTPUT" -PerfLabel="$LABEL" "${BASELINE_ARG[@]}" \
+	-abslog="$(dirname "$OUTPUT")/Regression.log" > /dev/null 2>&1
+STATUS=$?
+set -e
+
+if [[ $STATUS -eq 2 ]]; then
+	echo "Perf regression: no scenarios matched $SCENARIO; record the corpus and add its Replay_* scenarios first"
+	exit $STATUS
+elif [[ $STATUS -ne 0 ]]; then
+	echo "Perf regression: timings regressed, budgets exceeded or run failed (exit $STATUS), see $OUTPUT and Regression.log"
+	if [[ $UPDATE_BASELINE -eq 1 && ! -f "$BASELINE" && -f "$OUTPUT" ]]; then
+		mkdir -p "$(dirname "$BASELINE")"
+		cp "$OUTPUT" "$BASELINE"
+		echo "Perf regression: no baseline existed, wrote $BASELINE anyway; check it before committing"
+	fi
+	exit $STATUS
+fi
+
+echo "Perf regression: no regressions"
+if [[ $UPDATE_BASELINE -eq 1 ]]; then
+	mkdir -p "$(dirname "$BASELINE")"
+	cp "$OUTPUT" "$BASELINE"
+	echo "Perf regression: updated $BASELINE"
+fi
@@ -0,0 +1,71 @@
+#!/usr/bin/env bash
+# Headless performance scenarios: runs the MilitaryVehicleSim.Perf automation tests, one per scenario configured for
+# UPerfScenarioSubsystem (Config/DefaultGame.ini), in a standalone -nullrhi game and fails when any frame-time or
+# allocation budget is exceeded, plus the 10k-round ballistics benchmark. Each test loads NewMap afresh; the
+# automation report lists the failed budgets.
+#
+# Usage: Scripts/RunPerfTests.sh [-s scenario_prefix] [-o output.json]
+#
+# Uses the editor binary in -game mode by default; point GAME_BIN at a packaged MilitaryVehicleSim binary instead.
+# Results are tagged with the current commit so JSON files from different runs can be compared.
+set -euo pipefail
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_DIR="$(dirname "$SCRIPT_DIR")"
+PROJECT="$PROJECT_DIR/MilitaryVehicleSim.uproject"
+
+SCENARIO=""
+LABEL="$(git -C "$PROJECT_DIR" rev-parse --short HEAD 2>/dev/null || echo unknown)"
+OUTPUT="$PROJECT_DIR/Saved/Perf/Perf-$LABEL-$(date +%Y%m%d-%H%M%S).json"
+
+while getopts "s:o:" opt; do
+	case "$opt" in
+		s) SCENARIO="$OPTARG" ;;
+		o) OUTPUT="$OPTARG" ;;
+		*) sed -n '2,10p' "$0"; exit 1 ;;
+	esac
+done
+REPORT_DIR="$(dirname "$OUTPUT")/Report-$LABEL"
+
+if [[ -z "${GAME_BIN:-}" ]]; then
+	: "${UE_ROOT:?Set UE_ROOT to the engine directory, or GAME_BIN to a packaged binary}"
+	GAME_CMD=("$UE_ROOT/Engine/Binaries/Linux/UnrealEditor" "$PROJECT" -game)
+else
+	GAME_CMD=("$GAME_BIN")
+fi
+
+TESTS="MilitaryVehicleSim.Perf"
+if [[ -n "$SCENARIO" ]]; then
+	TESTS="MilitaryVehicleSim.Perf.$SCENARIO"
+fi
+
+mkdir -p "$(dirname "$OUTPUT")"
+rm -rf "$REPORT_DIR"
+echo "Perf: $TESTS at $LABEL -> $OUTPUT"
+
+# Unlocked frame rate so the frame times measure the work rather than vsync or the frame limiter
+set +e
+"${GAME_CMD[@]}" -nullrhi -unattended -nosound -NoSplash -log -NoVSync \
+	-ExecCmds="t.MaxFPS 0,Automation RunTests $TESTS" -TestExit="Automation Test Queue Empty" \
+	-ReportExportPath="$REPORT_DIR" -PerfJson="$OUTPUT" -PerfLabel="$LABEL" \
+	-abslog="$(dirname "$OUTPUT")/Perf.log" > /dev/null 2>&1
+STATUS=$?
+set -e
+
+# The automation report counts the tests; the process exit code alone doesn't say whether any test failed
+REPORT="$REPORT_DIR/index.json"
+if [[ ! -f "$REPORT" ]]; then
+	echo "Perf: run failed before writing $REPORT (exit $STATUS), see Perf.log"
+	exit $(( STATUS != 0 ? STATUS : 1 ))
+fi
+PASSED="$(grep -o '"succeeded"[^,]*' "$REPORT" | grep -o '[0-9]*$' || echo 0)"
+FAILED="$(grep -o '"failed"[^,]*' "$REPORT" | grep -o '[0-9]*$' || echo 0)"
+
+if [[ $(( PASSED + FAILED )) -eq 0 ]]; then
+	echo "Perf: no tests matched $TESTS, see Perf.log"
+	exit 2
+elif [[ $FAILED -ne 0 ]]; then
+	echo "Perf: $FAILED scenarios exceeded their budgets, see $REPORT and $OUTPUT"
+	exit 1
+fi
+echo "Perf: all $PASSED scenarios met their budgets"
@@ -0,0 +1,75 @@
+#!/usr/bin/env bash
+# Headless soak test: dedicated server on NewMap plus N local headless clients, no GPU required.
+#
+# Usage: Scripts/RunSoakTest.sh [-c clients] [-b server_bots] [-d duration_s] [-w warmup_s] [-o output.csv] [-m map]
+#
+# Uses the editor binary in -server/-game mode by default. Point SERVER_BIN / CLIENT_BIN at packaged
+# MilitaryVehicleSimServer / MilitaryVehicleSim binaries to soak cooked builds instead.
+# The server writes <output>.csv and <output>_connections.csv (see USoakTestSubsystem) and exits on its own.
+
+set -euo pipefail
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_DIR="$(dirname "$SCRIPT_DIR")"
+PROJECT="$PROJECT_DIR/MilitaryVehicleSim.uproject"
+
+CLIENTS=8
+BOTS=0
+DURATION=300
+WARMUP=10
+MAP=NewMap
+PORT=7777
+OUTPUT="$PROJECT_DIR/Saved/Soak/Soak-$(date +%Y%m%d-%H%M%S).csv"
+
+while getopts "c:b:d:w:o:m:p:" opt; do
+	case "$opt" in
+		c) CLIENTS="$OPTARG" ;;
+		b) BOTS="$OPTARG" ;;
+		d) DURATION="$OPTARG" ;;
+		w) WARMUP="$OPTARG" ;;
+		o) OUTPUT="$OPTARG" ;;
+		m) MAP="$OPTARG" ;;
+		p) PORT="$OPTARG" ;;
+		*) sed -n '2,9p' "$0"; exit 1 ;;
+	esac
+done
+
+if [[ -z "${SERVER_BIN:-}" || -z "${CLIENT_BIN:-}" ]]; then
+	: "${UE_ROOT:?Set UE_ROOT to the engine directory, or SERVER_BIN and CLIENT_BIN to packaged binaries}"
+	EDITOR="$UE_ROOT/Engine/Binaries/Linux/UnrealEditor"
+	SERVER_CMD=("${SERVER_BIN:-$EDITOR}" "$PROJECT" "$MAP" -server)
+	CLIENT_CMD=("${CLIENT_BIN:-$EDITOR}" "$PROJECT" "127.0.0.1:$PORT" -game)
+else
+	SERVER_CMD=("$SERVER_BIN" "$MAP")
+	CLIENT_CMD=("$CLIENT_BIN" "127.0.0.1:$PORT")
+fi
+
+LOG_DIR="$(dirname "$OUTPUT")"
+mkdir -p "$LOG_DIR"
+
+CLIENT_PIDS=()
+cleanup() {
+	for pid in "${CLIENT_PIDS[@]}"; do
+		kill "$pid" 2>/dev/null || true
+	done
+}
+trap cleanup EXIT
+
+echo "Soak: $CLIENTS clients, $BOTS bots, ${DURATION}s (+${WARMUP}s warmup) on $MAP -> $OUTPUT"
+
+"${SERVER_CMD[@]}" -nullrhi -unattended -nosound -log -Port="$PORT" \
+	-SoakTest -SoakDuration="$DURATION" -SoakWarmup="$WARMUP" -SoakCsv="$OUTPUT" -Bots="$BOTS" \
+	-abslog="$LOG_DIR/SoakServer.log" > /dev/null 2>&1 &
+SERVER_PID=$!
+
+# Give the server time to load the map before clients try to connect
+sleep 15
+
+for ((i = 0; i < CLIENTS; i++)); do
+	"${CLIENT_CMD[@]}" -nullrhi -unattended -nosound -NoSplash -log \
+		-abslog="$LOG_DIR/SoakClient$i.log" > /dev/null 2>&1 &
+	CLIENT_PIDS+=($!)
+done
+
+wait "$SERVER_PID"
+echo "Soak: done, report at $OUTPUT"
@@ -0,0 +1,199 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MilitaryVehicleBotController.h"
+
+#include "MilitaryVehicleSim/Components/DamageReceiverRegistry.h"
+#include "MilitaryVehicleSim/Components/HealthComponent.h"
+#include "MilitaryVehicleSim/Components/TurretComponent.h"
+#include "MilitaryVehicleSim/Vehicles/MilitaryVehicleBase.h"
+
+AMilitaryVehicleBotController::AMilitaryVehicleBotController()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	bWantsPlayerState = true;
+
+	// Bots only run on the server; clients see them through their vehicle and player state
+	bReplicates = false;
+
+	WanderRadius = 8000.0f;
+	AcceptanceRadius = 600.0f;
+	StuckTime = 3.0f;
+	StuckSpeed = 100.0f;
+	EngageRange = 15000.0f;
+	FireConeDegrees = 3.0f;
+	FireInterval = 1.0f;
+	RetargetInterval = 1.0f;
+}
+
+void AMilitaryVehicleBotController::OccupyVehicle(AMilitaryVehicleBase* Vehicle, EMilitaryVehicleBotRole InRole)
+{
+	if (!Vehicle)
+	{
+		return;
+	}
+
+	Role = InRole;
+	if (Role == EMilitaryVehicleBotRole::Driver)
+	{
+		Vehicle->PossessAsDriver(this);
+	}
+	else
+	{
+		Vehicle->PossessAsGunner(this);
+	}
+
+	HomeLocation = Vehicle->GetActorLocation();
+	PickDestination();
+
+	// Spread the first shots of a bulk spawn instead of firing every bot on the same frame
+	FireCooldown = FMath::FRandRange(0.0f, FireInterval);
+	RetargetCooldown = FMath::FRandRange(0.0f, RetargetInterval);
+}
+
+void AMilitaryVehicleBotController::OnUnPossess()
+{
+	if (AMilitaryVehicleBase* Vehicle = Cast<AMilitaryVehicleBase>(GetPawn()))
+	{
+		if (Role == EMilitaryVehicleBotRole::Driver)
+		{
+			Vehicle->SetDriverInput(0.0f, 0.0f, 1.0f);
+		}
+	}
+
+	Super::OnUnPossess();
+}
+
+void AMilitaryVehicleBotController::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	AMilitaryVehicleBase* Vehicle = Cast<AMilitaryVehicleBase>(GetPawn());
+	if (!Vehicle)
+	{
+		return;
+	}
+
+	const UHealthComponent* Health = Vehicle->GetHealthComponent();
+	if (Health && !Health->IsAlive())
+	{
+		if (Role == EMilitaryVehicleBotRole::Driver)
+		{
+			Vehicle->SetDriverInput(0.0f, 0.0f, 1.0f);
+		}
+		return;
+	}
+
+	if (Role == EMilitaryVehicleBotRole::Driver)
+	{
+		TickDriver(Vehicle, DeltaSeconds);
+	}
+	else
+	{
+		TickGunner(Vehicle, DeltaSeconds);
+	}
+}
+
+void AMilitaryVehicleBotController::TickDriver(AMilitaryVehicleBase* Vehicle, float DeltaSeconds)
+{
+	const FVector Location = Vehicle->GetActorLocation();
+	const FVector ToDestination = (Destination - Location) * FVector(1.0f, 1.0f, 0.0f);
+	if (ToDestination.SizeSquared() < FMath::Square(AcceptanceRadius))
+	{
+		PickDestination();
+	}
+
+	const float HeadingError = FMath::FindDeltaAngleDegrees(Vehicle->GetActorRotation().Yaw, ToDestination.Rotation().Yaw);
+	const float Steering = FMath::Clamp(HeadingError / 45.0f, -1.0f, 1.0f);
+
+	if (ReverseTimeRemaining > 0.0f)
+	{
+		// Backing out of an obstacle, steering the other way to turn the nose towards the destination
+		ReverseTimeRemaining -= DeltaSeconds;
+		Vehicle->SetDriverInput(-1.0f, -Steering, 0.0f);
+		return;
+	}
+
+	StuckAccumulator = Vehicle->GetVelocity().Size() < StuckSpeed ? StuckAccumulator + DeltaSeconds : 0.0f;
+	if (StuckAccumulator > StuckTime)
+	{
+		StuckAccumulator = 0.0f;
+		ReverseTimeRemaining = 1.5f;
+	}
+
+	// Ease off for sharp turns rather than braking to a stop
+	const float Throttle = FMath::Abs(HeadingError) > 90.0f ? 0.4f : 1.0f;
+	Vehicle->SetDriverInput(Throttle, Steering, 0.0f);
+}
+
+void AMilitaryVehicleBotController::TickGunner(AMilitaryVehicleBase* Vehicle, float DeltaSeconds)
+{
+	UTurretComponent* Turret = Vehicle->GetTurretComponent();
+	if (!Turret)
+	{
+		return;
+	}
+
+	RetargetCooldown -= DeltaSeconds;
+	if (RetargetCooldown <= 0.0f || !Target.IsValid())
+	{
+		RetargetCooldown = RetargetInterval;
+		Target = FindTarget(Vehicle);
+	}
+
+	const AActor* TargetActor = Target.Get();
+	if (!TargetActor)
+	{
+		// Nothing in range, keep the turret sweeping so aim traffic is still generated
+		Vehicle->AddTurretYawInput(0.25f);
+		return;
+	}
+
+	const FVector MuzzleLocation = Turret->GetMuzzleLocation();
+	const float AimError = FMath::FindDeltaAngleDegrees(Turret->GetMuzzleRotation().Yaw, (TargetActor->GetActorLocation() - MuzzleLocation).Rotation().Yaw);
+	Vehicle->AddTurretYawInput(FMath::Clamp(AimError / 10.0f, -1.0f, 1.0f));
+
+	FireCooldown -= DeltaSeconds;
+	if (FireCooldown <= 0.0f && FMath::Abs(AimError) <= FireConeDegrees)
+	{
+		FireCooldown = FireInterval;
+		Vehicle->FireWeapon();
+	}
+}
+
+void AMilitaryVehicleBotController::PickDestination()
+{
+	const FVector2D Offset = FMath::RandPointInCircle(WanderRadius);
+	Destination = HomeLocation + FVector(Offset, 0.0f);
+}
+
+AActor* AMilitaryVehicleBotController::FindTarget(const AMilitaryVehicleBase* Vehicle) const
+{
+	const UDamageReceiverRegistry* Registry = UDamageReceiverRegistry::Get(Vehicle);
+	if (!Registry)
+	{
+		return nullptr;
+	}
+
+	const FVector Location = Vehicle->GetActorLocation();
+	AActor* BestTarget = nullptr;
+	float BestDistanceSquared = FMath::Square(EngageRange);
+
+	for (const UHealthComponent* Health : Registry->GetHealthComponents())
+	{
+		AActor* Candidate = Health ? Health->GetOwner() : nullptr;
+		if (!Candidate || Candidate == Vehicle || !Health->IsAlive())
+		{
+			continue;
+		}
+
+		const float DistanceSquared = FVector::DistSquared(Location, Candidate->GetActorLocation());
+		if (DistanceSquared < BestDistanceSquared)
+		{
+			BestDistanceSquared = DistanceSquared;
+			BestTarget = Candidate;
+		}
+	}
+
+	return BestTarget;
+}
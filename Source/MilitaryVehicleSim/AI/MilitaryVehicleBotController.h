@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "MilitaryVehicleBotController.generated.h"
+
+class AMilitaryVehicleBase;
+
+UENUM()
+enum class EMilitaryVehicleBotRole : uint8
+{
+	Driver,
+	Gunner,
+};
+
+/**
+ * Load-test bot that occupies a vehicle in one role. The driver wanders between random points around its spawn
+ * through the throttle, steer and brake handlers; the gunner traverses towards the nearest live vehicle and fires
+ * through the fire ability, exactly as a player's input would. Spawned in bulk by UVehicleBotSubsystem.
+ */
+UCLASS()
+class MILITARYVEHICLESIM_API AMilitaryVehicleBotController : public AAIController
+{
+	GENERATED_BODY()
+
+public:
+	AMilitaryVehicleBotController();
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	/** Possesses the vehicle through PossessAsDriver or PossessAsGunner. */
+	void OccupyVehicle(AMilitaryVehicleBase* Vehicle, EMilitaryVehicleBotRole InRole);
+
+	EMilitaryVehicleBotRole GetBotRole() const { return Role; }
+
+protected:
+	virtual void OnUnPossess() override;
+
+	/** Radius around the spawn point the driver picks destinations in. */
+	UPROPERTY(EditDefaultsOnly, Category = "Bot")
+	float WanderRadius;
+
+	/** Distance at which a destination counts as reached. */
+	UPROPERTY(EditDefaultsOnly, Category = "Bot")
+	float AcceptanceRadius;
+
+	/** Seconds below StuckSpeed before the driver reverses out. */
+	UPROPERTY(EditDefaultsOnly, Category = "Bot")
+	float StuckTime;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Bot")
+	float StuckSpeed;
+
+	/** Targets beyond this distance are ignored by the gunner. */
+	UPROPERTY(EditDefaultsOnly, Category = "Bot")
+	float EngageRange;
+
+	/** Yaw error in degrees within which the gunner fires. */
+	UPROPERTY(EditDefaultsOnly, Category = "Bot")
+	float FireConeDegrees;
+
+	/** Seconds between fire attempts; the ability's own cooldown still applies. */
+	UPROPERTY(EditDefaultsOnly, Category = "Bot")
+	float FireInterval;
+
+	/** Seconds between target searches. */
+	UPROPERTY(EditDefaultsOnly, Category = "Bot")
+	float RetargetInterval;
+
+private:
+	void TickDriver(AMilitaryVehicleBase* Vehicle, float DeltaSeconds);
+	void TickGunner(AMilitaryVehicleBase* Vehicle, float DeltaSeconds);
+	void PickDestination();
+	AActor* FindTarget(const AMilitaryVehicleBase* Vehicle) const;
+
+	EMilitaryVehicleBotRole Role = EMilitaryVehicleBotRole::Driver;
+
+	FVector HomeLocation = FVector::ZeroVector;
+	FVector Destination = FVector::ZeroVector;
+	float StuckAccumulator = 0.0f;
+	float ReverseTimeRemaining = 0.0f;
+
+	TWeakObjectPtr<AActor> Target;
+	float RetargetCooldown = 0.0f;
+	float FireCooldown = 0.0f;
+};
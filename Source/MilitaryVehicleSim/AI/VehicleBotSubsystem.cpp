@@ -0,0 +1,144 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VehicleBotSubsystem.h"
+
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CommandLine.h"
+#include "MilitaryVehicleSim/MilitaryVehicleGameMode.h"
+#include "MilitaryVehicleSim/MilitaryVehicleSim.h"
+#include "MilitaryVehicleSim/Vehicles/MilitaryVehicleBase.h"
+
+static FAutoConsoleCommandWithWorldAndArgs SpawnBotsCommand(
+	TEXT("mvs.Bots.Spawn"),
+	TEXT("Spawns load-test bots in their own vehicles. Args: count (default 1), role driver|gunner|mixed (default mixed)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UVehicleBotSubsystem* Bots = World ? World->GetSubsystem<UVehicleBotSubsystem>() : nullptr)
+		{
+			Bots->SpawnBots(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1, Args.Num() > 1 ? Args[1] : FString());
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld ClearBotsCommand(
+	TEXT("mvs.Bots.Clear"),
+	TEXT("Destroys every load-test bot and its vehicle."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UVehicleBotSubsystem* Bots = World ? World->GetSubsystem<UVehicleBotSubsystem>() : nullptr)
+		{
+			Bots->ClearBots();
+		}
+	}));
+
+bool UVehicleBotSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UVehicleBotSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	int32 Count = 0;
+	if (FParse::Value(FCommandLine::Get(), TEXT("Bots="), Count) && Count > 0)
+	{
+		FString RoleName;
+		FParse::Value(FCommandLine::Get(), TEXT("BotRole="), RoleName);
+		SpawnBots(Count, RoleName);
+	}
+}
+
+void UVehicleBotSubsystem::Deinitialize()
+{
+	Bots.Empty();
+
+	Super::Deinitialize();
+}
+
+int32 UVehicleBotSubsystem::SpawnBots(int32 Count, const FString& RoleName)
+{
+	UWorld* World = GetWorld();
+	if (!World || World->GetNetMode() == NM_Client)
+	{
+		UE_LOG(LogMilitaryVehicle, Warning, TEXT("Bots can only be spawned on the server"));
+		return 0;
+	}
+
+	const bool bMixed = !RoleName.Equals(TEXT("driver"), ESearchCase::IgnoreCase) && !RoleName.Equals(TEXT("gunner"), ESearchCase::IgnoreCase);
+	const EMilitaryVehicleBotRole FixedRole = RoleName.Equals(TEXT("gunner"), ESearchCase::IgnoreCase) ? EMilitaryVehicleBotRole::Gunner : EMilitaryVehicleBotRole::Driver;
+
+	int32 NumCreated = 0;
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		const EMilitaryVehicleBotRole Role = bMixed ? ((NumSpawned % 2) ? EMilitaryVehicleBotRole::Gunner : EMilitaryVehicleBotRole::Driver) : FixedRole;
+		if (!SpawnBot(Role))
+		{
+			break;
+		}
+		++NumCreated;
+	}
+
+	UE_LOG(LogMilitaryVehicle, Log, TEXT("Spawned %d of %d bots (%d total)"), NumCreated, Count, Bots.Num());
+	return NumCreated;
+}
+
+AMilitaryVehicleBotController* UVehicleBotSubsystem::SpawnBot(EMilitaryVehicleBotRole Role)
+{
+	UWorld* World = GetWorld();
+	AMilitaryVehicleGameMode* GameMode = World->GetAuthGameMode<AMilitaryVehicleGameMode>();
+	const TSubclassOf<AMilitaryVehicleBase> VehicleClass = GameMode ? GameMode->GetBotVehicleClass() : nullptr;
+	if (!VehicleClass)
+	{
+		UE_LOG(LogMilitaryVehicle, Warning, TEXT("Bots need an AMilitaryVehicleGameMode with a vehicle bot or default pawn class"));
+		return nullptr;
+	}
+
+	FActorSpawnParameters ControllerParams;
+	ControllerParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AMilitaryVehicleBotController* Bot = World->SpawnActor<AMilitaryVehicleBotController>(ControllerParams);
+	if (!Bot)
+	{
+		return nullptr;
+	}
+
+	// The game mode reserves the start it hands out, so a burst of bots spreads over the map
+	const AActor* Start = GameMode->ChoosePlayerStart(Bot);
+	const FTransform SpawnTransform = Start ? Start->GetActorTransform() : FTransform::Identity;
+
+	FActorSpawnParameters VehicleParams;
+	VehicleParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+	AMilitaryVehicleBase* Vehicle = World->SpawnActor<AMilitaryVehicleBase>(VehicleClass, SpawnTransform, VehicleParams);
+	if (!Vehicle)
+	{
+		Bot->Destroy();
+		return nullptr;
+	}
+
+	Bot->OccupyVehicle(Vehicle, Role);
+	Bots.Add(Bot);
+	++NumSpawned;
+	return Bot;
+}
+
+void UVehicleBotSubsystem::ClearBots()
+{
+	for (AMilitaryVehicleBotController* Bot : Bots)
+	{
+		if (!IsValid(Bot))
+		{
+			continue;
+		}
+
+		if (APawn* Vehicle = Bot->GetPawn())
+		{
+			Bot->UnPossess();
+			Vehicle->Destroy();
+		}
+		Bot->Destroy();
+	}
+
+	UE_LOG(LogMilitaryVehicle, Log, TEXT("Cleared %d bots"), Bots.Num());
+	Bots.Empty();
+}
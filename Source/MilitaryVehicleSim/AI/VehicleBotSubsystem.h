@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MilitaryVehicleSim/AI/MilitaryVehicleBotController.h"
+#include "VehicleBotSubsystem.generated.h"
+
+/**
+ * Spawns load-test bots on the server, each in its own vehicle at a start chosen by the game mode.
+ * Console: mvs.Bots.Spawn <count> [driver|gunner|mixed], mvs.Bots.Clear
+ * Command line: -Bots=<count> [-BotRole=driver|gunner|mixed] spawns them once the world begins play.
+ * Mixed alternates roles, so half the bots drive and half stand still and shoot.
+ */
+UCLASS()
+class MILITARYVEHICLESIM_API UVehicleBotSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	/** Spawns Count bots; returns how many got a vehicle. Server only. */
+	int32 SpawnBots(int32 Count, const FString& RoleName);
+
+	/** Destroys every bot and its vehicle. */
+	void ClearBots();
+
+	const TArray<TObjectPtr<AMilitaryVehicleBotController>>& GetBots() const { return Bots; }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	AMilitaryVehicleBotController* SpawnBot(EMilitaryVehicleBotRole Role);
+
+	UPROPERTY()
+	TArray<TObjectPtr<AMilitaryVehicleBotController>> Bots;
+
+	int32 NumSpawned = 0;
+};
@@ -5,9 +5,48 @@
 
 #include "AbilitySystemComponent.h"
 #include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+#include "MilitaryVehicleSim/Abilities/MilitaryVehicleTags.h"
+#include "MilitaryVehicleSim/Components/DamageReceiverRegistry.h"
 #include "MilitaryVehicleSim/Components/TurretComponent.h"
+#include "MilitaryVehicleSim/Diagnostics/CombatStats.h"
+#include "MilitaryVehicleSim/Networking/ProjectileShotSubsystem.h"
+#include "MilitaryVehicleSim/Projectiles/BallisticsSubsystem.h"
 #include "MilitaryVehicleSim/Projectiles/ProjectileBase.h"
-#include "AbilitySystemBlueprintLibrary.h"
+#include "MilitaryVehicleSim/Projectiles/ProjectilePoolSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("FireWeapon ActivateAbility"), STAT_MVS_FireWeaponActivate, STATGROUP_MilitaryVehicle);
+DECLARE_CYCLE_STAT(TEXT("FireWeapon SpawnProjectile"), STAT_MVS_SpawnProjectile, STATGROUP_MilitaryVehicle);
+
+static TAutoConsoleVariable<float> CVarShotBudgetWindow(
+	TEXT("mvs.Weapon.ShotBudgetWindow"),
+	0.25f,
+	TEXT("Seconds of fire the server lets a shooter bank up, absorbing shot batches that arrive together."));
+
+static TAutoConsoleVariable<float> CVarShotAgeSlack(
+	TEXT("mvs.Weapon.ShotAgeSlack"),
+	0.05f,
+	TEXT("Seconds beyond the batch's own shot spacing the server accepts as a client-reported shot age, about one client frame."));
+
+bool FGameplayAbilityTargetData_WeaponFire::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	bool bLocationSuccess = true;
+	bool bDirectionSuccess = true;
+	MuzzleLocation.NetSerialize(Ar, Map, bLocationSuccess);
+	Direction.NetSerialize(Ar, Map, bDirectionSuccess);
+
+	uint32 Count = NumShots;
+	Ar.SerializeInt(Count, FWeaponFireScheduler::MaxShotsPerBatch + 1);
+	NumShots = static_cast<uint8>(Count);
+
+	// Ages are under a frame or two; tenths of a millisecond keep the shot spacing exact enough
+	uint16 AgeTenthsMs = static_cast<uint16>(FMath::Clamp(FMath::RoundToInt(FirstShotAge * 10000.0f), 0, MAX_uint16));
+	Ar << AgeTenthsMs;
+	FirstShotAge = AgeTenthsMs / 10000.0f;
+
+	bOutSuccess = bLocationSuccess && bDirectionSuccess && !Ar.IsError();
+	return true;
+}
 
 UGameplayAbility_FireWeapon::UGameplayAbility_FireWeapon()
 {
@@ -15,14 +54,44 @@ UGameplayAbility_FireWeapon::UGameplayAbility_FireWeapon()
 	NetExecutionPolicy = EGameplayAbilityNetExecutionPolicy::LocalPredicted;
 
 	FireCooldown = 1.0f;
+	FireMode = EWeaponFireMode::SemiAuto;
+	BurstCount = 3;
 	ProjectileDamage = 30.0f;
 
-	AbilityTags.AddTag(FGameplayTag::RequestGameplayTag(TEXT("Ability.Fire")));
+	AbilityTags.AddTag(MilitaryVehicleTags::Ability_Fire);
+}
+
+void UGameplayAbility_FireWeapon::OnGiveAbility(const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilitySpec& Spec)
+{
+	Super::OnGiveAbility(ActorInfo, Spec);
+
+	// Warm the projectile pool up front so the first volley doesn't pay for actor spawns
+	if (ActorInfo && ActorInfo->IsNetAuthority())
+	{
+		if (UWorld* World = GetWorld())
+		{
+			if (UProjectilePoolSubsystem* Pool = World->GetSubsystem<UProjectilePoolSubsystem>())
+			{
+				Pool->Prewarm(ProjectileClass);
+			}
+		}
+	}
+}
+
+FWeaponFireSchedule UGameplayAbility_FireWeapon::GetFireSchedule() const
+{
+	FWeaponFireSchedule Schedule;
+	Schedule.Mode = FireMode;
+	Schedule.ShotInterval = FireCooldown;
+	Schedule.BurstCount = BurstCount;
+	return Schedule;
 }
 
 void UGameplayAbility_FireWeapon::ActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo,
 	const FGameplayAbilityActivationInfo ActivationInfo, const FGameplayEventData* TriggerEventData)
 {
+	SCOPE_CYCLE_COUNTER(STAT_MVS_FireWeaponActivate);
+
 	if (!CommitAbility(Handle, ActorInfo, ActivationInfo))
 	{
 		EndAbility(Handle, ActorInfo, ActivationInfo, true, true);
@@ -30,7 +99,8 @@ void UGameplayAbility_FireWeapon::ActivateAbility(const FGameplayAbilitySpecHand
 	}
 
 	// Get turret component from owner
-	UTurretComponent* TurretComponent = Cast<UTurretComponent>(ActorInfo->OwnerActor->GetComponentByClass(UTurretComponent::StaticClass()));
+	const UDamageReceiverRegistry* Registry = UDamageReceiverRegistry::Get(ActorInfo->OwnerActor.Get());
+	UTurretComponent* TurretComponent = Registry ? Registry->FindTurretComponent(ActorInfo->OwnerActor.Get()) : nullptr;
 	if (!TurretComponent)
 	{
 		EndAbility(Handle, ActorInfo, ActivationInfo, true, true);
@@ -39,28 +109,100 @@ void UGameplayAbility_FireWeapon::ActivateAbility(const FGameplayAbilitySpecHand
 
 	FVector MuzzleLocation = TurretComponent->GetMuzzleLocation();
 	FRotator MuzzleRotation = TurretComponent->GetMuzzleRotation();
+	int32 NumShots = 1;
+	float FirstShotAge = 0.0f;
 
-	// If we have event data, use it for spawn location/rotation (it's better for network)
-	if (TriggerEventData && TriggerEventData->TargetData.Num() > 0)
+	// The firing side's scheduler decides how many shots this batch holds and when each was due
+	const FGameplayAbilityTargetData* TargetData = TriggerEventData ? TriggerEventData->TargetData.Get(0) : nullptr;
+	if (TargetData && TargetData->GetScriptStruct() == FGameplayAbilityTargetData_WeaponFire::StaticStruct())
 	{
-		FGameplayAbilityTargetDataHandle TargetData = TriggerEventData->TargetData;
-		FHitResult HitResult = UAbilitySystemBlueprintLibrary::GetHitResultFromTargetData(TargetData, 0);
-		
-		MuzzleLocation = HitResult.Location;
-		MuzzleRotation = HitResult.ImpactNormal.Rotation();
+		const FGameplayAbilityTargetData_WeaponFire* FireData = static_cast<const FGameplayAbilityTargetData_WeaponFire*>(TargetData);
+		MuzzleLocation = FireData->MuzzleLocation;
+		MuzzleRotation = FireData->Direction.Rotation();
+		NumShots = FireData->NumShots;
+		FirstShotAge = FireData->FirstShotAge;
 	}
 
-	// Spawn projectile on server
+	// Spawn projectiles on server, oldest first so each lands where it would have been had it fired on time
 	if (ActorInfo->OwnerActor->HasAuthority())
 	{
-		SpawnProjectile(MuzzleLocation, MuzzleRotation);
+		float MaxFirstShotAge = 0.0f;
+		NumShots = ConsumeShotBudget(NumShots, MaxFirstShotAge);
+
+		// The age comes from the client; an inflated one would launch authoritative rounds far down-range
+		FirstShotAge = FMath::Clamp(FirstShotAge, 0.0f, MaxFirstShotAge);
+		for (int32 ShotIndex = 0; ShotIndex < NumShots; ++ShotIndex)
+		{
+			// The budget keeps the first shots of a batch, so indices line up with the client's predictions
+			const float ShotAge = FMath::Max(FirstShotAge - ShotIndex * FireCooldown, 0.0f);
+			SpawnProjectile(MuzzleLocation, MuzzleRotation, ShotAge,
+				FPredictedShotKey(ActivationInfo.GetActivationPredictionKey().Current, static_cast<uint8>(ShotIndex)));
+		}
+	}
+	else if (ActorInfo->IsLocallyControlled())
+	{
+		PredictShots(ActivationInfo.GetActivationPredictionKey(), MuzzleLocation, MuzzleRotation, NumShots, FirstShotAge);
 	}
 
 	EndAbility(Handle, ActorInfo, ActivationInfo, true, false);
 }
 
-void UGameplayAbility_FireWeapon::SpawnProjectile(const FVector& SpawnLocation, const FRotator& SpawnRotation)
+int32 UGameplayAbility_FireWeapon::ConsumeShotBudget(int32 RequestedShots, float& OutMaxFirstShotAge)
+{
+	const float ShotInterval = FMath::Max(FireCooldown, UE_KINDA_SMALL_NUMBER);
+	const float MaxBudget = FMath::Max(FireMode == EWeaponFireMode::Burst ? BurstCount : 1, 1) + CVarShotBudgetWindow.GetValueOnGameThread() / ShotInterval;
+	const double Now = GetWorld()->GetTimeSeconds();
+	const bool bHadPreviousBatch = ShotBudget >= 0.0f;
+	const float SincePreviousBatch = static_cast<float>(Now - ShotBudgetTime);
+
+	// Refills at the fire rate; starts full so the first press always goes through
+	ShotBudget = ShotBudget < 0.0f ? MaxBudget : FMath::Min(ShotBudget + static_cast<float>(Now - ShotBudgetTime) / ShotInterval, MaxBudget);
+	ShotBudgetTime = Now;
+
+	const int32 AllowedShots = FMath::Min(RequestedShots, FMath::FloorToInt(ShotBudget));
+	if (AllowedShots < RequestedShots)
+	{
+		UE_LOG(LogMilitaryVehicle, Verbose, TEXT("%s: %d of %d shots exceed the fire rate, dropping them"),
+			*GetNameSafe(GetOwningActorFromActorInfo()), RequestedShots - AllowedShots, RequestedShots);
+	}
+	ShotBudget -= AllowedShots;
+
+	// The first shot of a batch can't have been due earlier than its shots' own spacing plus a frame, nor before
+	// the previous batch reached us
+	OutMaxFirstShotAge = FMath::Max(AllowedShots - 1, 0) * FireCooldown + CVarShotAgeSlack.GetValueOnGameThread();
+	if (bHadPreviousBatch)
+	{
+		OutMaxFirstShotAge = FMath::Min(OutMaxFirstShotAge, FMath::Max(SincePreviousBatch, 0.0f));
+	}
+	return AllowedShots;
+}
+
+void UGameplayAbility_FireWeapon::PredictShots(FPredictionKey PredictionKey, const FVector& MuzzleLocation, const FRotator& MuzzleRotation,
+	int32 NumShots, float FirstShotAge)
+{
+	UProjectileShotSubsystem* ShotSubsystem = GetWorld()->GetSubsystem<UProjectileShotSubsystem>();
+	if (!ProjectileClass || !ShotSubsystem || !PredictionKey.IsValidKey())
+	{
+		return;
+	}
+
+	AActor* OwningActor = GetOwningActorFromActorInfo();
+	for (int32 ShotIndex = 0; ShotIndex < NumShots; ++ShotIndex)
+	{
+		const float ShotAge = FMath::Max(FirstShotAge - ShotIndex * FireCooldown, 0.0f);
+		ShotSubsystem->PredictShot(OwningActor, ProjectileClass, MuzzleLocation, MuzzleRotation.Vector(), ShotAge,
+			FPredictedShotKey(PredictionKey.Current, static_cast<uint8>(ShotIndex)));
+	}
+
+	// A failed activation on the server rejects the key; the rounds it would have fired never existed
+	PredictionKey.NewRejectedDelegate().BindUObject(ShotSubsystem, &UProjectileShotSubsystem::RejectPredictedShots, PredictionKey.Current);
+}
+
+void UGameplayAbility_FireWeapon::SpawnProjectile(const FVector& SpawnLocation, const FRotator& SpawnRotation, float ShotAge,
+	const FPredictedShotKey& PredictedShot)
 {
+	SCOPE_CYCLE_COUNTER(STAT_MVS_SpawnProjectile);
+
 	if (!ProjectileClass)
 	{
 		return;
@@ -72,15 +214,54 @@ void UGameplayAbility_FireWeapon::SpawnProjectile(const FVector& SpawnLocation,
 		return;
 	}
 
-	FActorSpawnParameters SpawnParams;
-	SpawnParams.Owner = GetOwningActorFromActorInfo();
-	SpawnParams.Instigator = Cast<APawn>(GetOwningActorFromActorInfo());
-	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AActor* OwningActor = GetOwningActorFromActorInfo();
+	APawn* OwningPawn = Cast<APawn>(OwningActor);
 
-	AProjectileBase* Projectile = World->SpawnActor<AProjectileBase>(ProjectileClass, SpawnLocation, SpawnRotation, SpawnParams);
-	if (Projectile)
+	const AProjectileBase* ProjectileDefaults = GetDefault<AProjectileBase>(ProjectileClass);
+	CombatStats::Count(World, CombatStats::EEvent::Shot);
+
+	// Shot-event classes fire along the quantized, dispersed path that clients will replay
+	FVector FireLocation = SpawnLocation;
+	FRotator FireRotation = SpawnRotation;
+	FProjectileShotEvent Shot;
+	UProjectileShotSubsystem* ShotSubsystem = World->GetSubsystem<UProjectileShotSubsystem>();
+	const bool bUseShotEvent = ShotSubsystem && UProjectileShotSubsystem::UsesShotEvents(ProjectileDefaults)
+		&& ShotSubsystem->BeginShot(OwningActor, ProjectileClass, SpawnLocation, SpawnRotation.Vector(), Shot);
+	if (bUseShotEvent)
+	{
+		Shot.PredictedShot = PredictedShot;
+		FireLocation = Shot.MuzzleLocation;
+		FireRotation = Shot.GetDirection().Rotation();
+	}
+
+	// Lightweight classes never become actors; the ballistics subsystem simulates them in bulk
+	if (ProjectileDefaults->UsesLightweightSimulation())
+	{
+		if (UBallisticsSubsystem* Ballistics = World->GetSubsystem<UBallisticsSubsystem>())
+		{
+			if (Ballistics->FireRound(ProjectileDefaults, FireLocation, FireRotation.Vector(), ProjectileDamage, OwningActor, Shot.ShotId, ShotAge) && bUseShotEvent)
+			{
+				ShotSubsystem->BroadcastShot(OwningActor, Shot);
+			}
+			return;
+		}
+	}
+
+	// The pool is the only spawn path for projectile actors; it exists in every game world and spawns a plain actor
+	// itself when pooling is off or the class is at its cap
+	UProjectilePoolSubsystem* Pool = World->GetSubsystem<UProjectilePoolSubsystem>();
+	if (AProjectileBase* Projectile = Pool ? Pool->AcquireProjectile(ProjectileClass, FireLocation, FireRotation, OwningActor, OwningPawn) : nullptr)
 	{
 		Projectile->SetDamage(ProjectileDamage);
-		Projectile->InitializeVelocity(SpawnRotation.Vector());
+		Projectile->SetPredictedShot(PredictedShot);
+		Projectile->InitializeVelocity(FireRotation.Vector());
+
+		if (bUseShotEvent)
+		{
+			Projectile->SetShotId(Shot.ShotId);
+			ShotSubsystem->BroadcastShot(OwningActor, Shot);
+		}
+
+		Projectile->CatchUp(ShotAge);
 	}
 }
@@ -4,9 +4,47 @@
 
 #include "CoreMinimal.h"
 #include "Abilities/GameplayAbility.h"
+#include "Abilities/GameplayAbilityTargetTypes.h"
+#include "MilitaryVehicleSim/Abilities/WeaponFireScheduler.h"
 #include "GameplayAbility_FireWeapon.generated.h"
 
+struct FPredictedShotKey;
+
 class AProjectileBase;
+
+/** One batch of scheduled shots from the firing vehicle: where the muzzle was and when each shot was due. */
+USTRUCT()
+struct MILITARYVEHICLESIM_API FGameplayAbilityTargetData_WeaponFire : public FGameplayAbilityTargetData
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize10 MuzzleLocation;
+
+	UPROPERTY()
+	FVector_NetQuantizeNormal Direction;
+
+	/** Shots in this batch, spaced one shot interval apart. */
+	UPROPERTY()
+	uint8 NumShots = 1;
+
+	/** Seconds between the earliest shot's due time and the dispatch; later shots are younger by one interval each. */
+	UPROPERTY()
+	float FirstShotAge = 0.0f;
+
+	virtual UScriptStruct* GetScriptStruct() const override { return StaticStruct(); }
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FGameplayAbilityTargetData_WeaponFire> : public TStructOpsTypeTraitsBase2<FGameplayAbilityTargetData_WeaponFire>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
 /**
  * 
  */
@@ -20,16 +58,43 @@ public:
 	virtual void ActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo,
 		const FGameplayAbilityActivationInfo ActivationInfo, const FGameplayEventData* TriggerEventData) override;
 
+	virtual void OnGiveAbility(const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilitySpec& Spec) override;
+
+	FWeaponFireSchedule GetFireSchedule() const;
+
 protected:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
 	TSubclassOf<AProjectileBase> ProjectileClass;
 
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
+	/** Minimum seconds between shots, enforced by the fire scheduler and checked again by the server. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon", meta = (ClampMin = "0.01"))
 	float FireCooldown;
 
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
+	EWeaponFireMode FireMode;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon", meta = (ClampMin = "1", EditCondition = "FireMode == EWeaponFireMode::Burst"))
+	int32 BurstCount;
+
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
 	float ProjectileDamage;
 
 private:
-	void SpawnProjectile(const FVector& SpawnLocation, const FRotator& SpawnRotation);
+	/**
+	 * Fires one round; ShotAge moves it along its path by the time since the shot was due. PredictedShot is the
+	 * owning client's key for the same shot, handed to clients with the round.
+	 */
+	void SpawnProjectile(const FVector& SpawnLocation, const FRotator& SpawnRotation, float ShotAge, const FPredictedShotKey& PredictedShot);
+
+	/** Owning client: flies the batch locally until the server's rounds take over, see UProjectileShotSubsystem. */
+	void PredictShots(FPredictionKey PredictionKey, const FVector& MuzzleLocation, const FRotator& MuzzleRotation, int32 NumShots, float FirstShotAge);
+
+	/**
+	 * Server: caps a batch to what the fire rate allows since the last one. OutMaxFirstShotAge is the oldest the
+	 * client may claim the batch's first shot to be, given the shots allowed and when the previous batch arrived.
+	 */
+	int32 ConsumeShotBudget(int32 RequestedShots, float& OutMaxFirstShotAge);
+
+	float ShotBudget = -1.0f;
+	double ShotBudgetTime = 0.0;
 };
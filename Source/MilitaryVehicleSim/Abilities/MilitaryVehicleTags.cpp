@@ -0,0 +1,9 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MilitaryVehicleTags.h"
+
+namespace MilitaryVehicleTags
+{
+	UE_DEFINE_GAMEPLAY_TAG_COMMENT(Ability_Fire, "Ability.Fire", "Weapon fire ability, triggered by the gunner's fire input.");
+}
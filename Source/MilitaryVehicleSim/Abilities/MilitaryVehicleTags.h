@@ -0,0 +1,11 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "NativeGameplayTags.h"
+
+/** Gameplay tags used from code, registered natively so lookups never go through the tag name table. */
+namespace MilitaryVehicleTags
+{
+	MILITARYVEHICLESIM_API UE_DECLARE_GAMEPLAY_TAG_EXTERN(Ability_Fire);
+}
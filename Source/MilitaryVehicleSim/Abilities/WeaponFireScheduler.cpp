@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WeaponFireScheduler.h"
+
+void FWeaponFireScheduler::PressTrigger(const FWeaponFireSchedule& Schedule, double Time)
+{
+	// A press during the cooldown waits for it instead of being lost
+	NextShotTime = FMath::Max(NextShotTime, Time);
+	PendingShots = FMath::Max(PendingShots, Schedule.Mode == EWeaponFireMode::Burst ? FMath::Max(Schedule.BurstCount, 1) : 1);
+	bTriggerHeld = true;
+	HeldMode = Schedule.Mode;
+}
+
+void FWeaponFireScheduler::ReleaseTrigger()
+{
+	bTriggerHeld = false;
+}
+
+int32 FWeaponFireScheduler::Advance(const FWeaponFireSchedule& Schedule, double Now, float& OutFirstShotAge)
+{
+	OutFirstShotAge = 0.0f;
+
+	const double ShotInterval = FMath::Max(Schedule.ShotInterval, UE_KINDA_SMALL_NUMBER);
+	const bool bAutomatic = bTriggerHeld && HeldMode == EWeaponFireMode::FullAuto;
+
+	int32 NumShots = 0;
+	while ((PendingShots > 0 || bAutomatic) && NextShotTime <= Now)
+	{
+		if (NumShots == MaxShotsPerBatch)
+		{
+			NextShotTime = Now + ShotInterval;
+			break;
+		}
+
+		if (NumShots == 0)
+		{
+			OutFirstShotAge = static_cast<float>(Now - NextShotTime);
+		}
+
+		++NumShots;
+		NextShotTime += ShotInterval;
+		PendingShots = FMath::Max(PendingShots - 1, 0);
+	}
+
+	return NumShots;
+}
@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WeaponFireScheduler.generated.h"
+
+UENUM()
+enum class EWeaponFireMode : uint8
+{
+	/** One shot per trigger press. */
+	SemiAuto,
+	/** BurstCount shots per press, finished even if the trigger is released early. */
+	Burst,
+	/** Fires for as long as the trigger is held. */
+	FullAuto,
+};
+
+/** Rate-of-fire settings the scheduler runs against, taken from the fire ability. */
+struct FWeaponFireSchedule
+{
+	EWeaponFireMode Mode = EWeaponFireMode::SemiAuto;
+	/** Seconds between shots; 900 RPM is 1/15. */
+	float ShotInterval = 1.0f;
+	int32 BurstCount = 3;
+};
+
+/**
+ * Turns trigger presses and releases into shots at exact times. Shots fall due on a fixed grid from the first
+ * press, independent of the frame rate, and Advance hands back every shot that came due since the last call
+ * along with how long ago the earliest one was due. A 20 Hz server and a 144 Hz client holding the trigger for
+ * the same time fire the same number of shots; the slower one just gets them in larger batches.
+ */
+class MILITARYVEHICLESIM_API FWeaponFireScheduler
+{
+public:
+	/** Most shots one Advance returns; anything beyond that after a long hitch is dropped rather than owed. */
+	static constexpr int32 MaxShotsPerBatch = 16;
+
+	void PressTrigger(const FWeaponFireSchedule& Schedule, double Time);
+	void ReleaseTrigger();
+
+	/** Returns the number of shots due at or before Now. OutFirstShotAge is Now minus the earliest shot's time. */
+	int32 Advance(const FWeaponFireSchedule& Schedule, double Now, float& OutFirstShotAge);
+
+	bool IsTriggerHeld() const { return bTriggerHeld; }
+
+private:
+	/** Earliest time the next shot may go; never earlier than one interval after the last shot. */
+	double NextShotTime = 0.0;
+
+	/** Shots still owed to the last press: one for a tap, the rest of a burst. */
+	int32 PendingShots = 0;
+
+	bool bTriggerHeld = false;
+	EWeaponFireMode HeldMode = EWeaponFireMode::SemiAuto;
+};
@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DamageLog.h"
+
+#include "MilitaryVehicleSim/Components/HealthComponent.h"
+
+void FDamageLogEntry::PostReplicatedAdd(const FDamageLog& InArraySerializer)
+{
+	if (!InArraySerializer.bReceivedInitialLog)
+	{
+		return;
+	}
+
+	if (UHealthComponent* HealthComponent = InArraySerializer.Owner)
+	{
+		HealthComponent->OnDamageTaken.Broadcast(Attacker.Get(), Amount, Time);
+	}
+}
+
+void FDamageLog::Add(AActor* Attacker, float Amount, float Time, int32 MaxEntries)
+{
+	FDamageLogEntry& Entry = Entries.AddDefaulted_GetRef();
+	Entry.Attacker = Attacker;
+	Entry.Amount = Amount;
+	Entry.Time = Time;
+	MarkItemDirty(Entry);
+
+	const int32 NumToRemove = Entries.Num() - FMath::Max(1, MaxEntries);
+	if (NumToRemove > 0)
+	{
+		Entries.RemoveAt(0, NumToRemove, false);
+		MarkArrayDirty();
+	}
+}
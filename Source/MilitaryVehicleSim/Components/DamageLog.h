@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "DamageLog.generated.h"
+
+class UHealthComponent;
+
+/** One resolved hit. */
+USTRUCT(BlueprintType)
+struct MILITARYVEHICLESIM_API FDamageLogEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Health")
+	TWeakObjectPtr<AActor> Attacker;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Health")
+	float Amount = 0.0f;
+
+	/** Server world time the hit was resolved. */
+	UPROPERTY(BlueprintReadOnly, Category = "Health")
+	float Time = 0.0f;
+
+	void PostReplicatedAdd(const struct FDamageLog& InArraySerializer);
+};
+
+/**
+ * Most recent hits taken by a UHealthComponent, delta-replicated so clients only receive new entries.
+ * Clients rebuild hit feedback from it instead of needing a separate RPC per hit.
+ */
+USTRUCT()
+struct MILITARYVEHICLESIM_API FDamageLog : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FDamageLogEntry> Entries;
+
+	/** Appends an entry, dropping the oldest ones past MaxEntries. */
+	void Add(AActor* Attacker, float Amount, float Time, int32 MaxEntries);
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FDamageLogEntry, FDamageLog>(Entries, DeltaParms, *this);
+	}
+
+	/** Called once per received update, after the per-entry callbacks. */
+	void PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters) { bReceivedInitialLog = true; }
+
+	/** Back-pointer to the component holding this log; the component outlives it, so it isn't a reference. */
+	UHealthComponent* Owner = nullptr;
+
+	/**
+	 * Set after the first update received on this client. Entries in that update are hits from before the vehicle
+	 * became relevant to us, so they are not reported again through OnDamageTaken.
+	 */
+	bool bReceivedInitialLog = false;
+};
+
+template<>
+struct TStructOpsTypeTraits<FDamageLog> : public TStructOpsTypeTraitsBase2<FDamageLog>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
@@ -0,0 +1,245 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DamageQueueSubsystem.h"
+
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "MilitaryVehicleSim/MilitaryVehicleSim.h"
+#include "MilitaryVehicleSim/Components/DamageReceiverRegistry.h"
+#include "MilitaryVehicleSim/Components/HealthComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("DamageQueue ResolveDetonations"), STAT_MVS_ResolveDetonations, STATGROUP_MilitaryVehicle);
+
+static FAutoConsoleCommandWithWorldAndArgs DetonationBenchmarkCommand(
+	TEXT("mvs.Splash.Benchmark"),
+	TEXT("Resolves N zero-damage detonations around damageable actors in one batch and logs the cost. Optional arg: count (default 50)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UDamageQueueSubsystem* DamageQueue = World ? World->GetSubsystem<UDamageQueueSubsystem>() : nullptr)
+		{
+			DamageQueue->RunDetonationBenchmark(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 50);
+		}
+	}));
+
+void UDamageQueueSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UDamageQueueSubsystem::HandlePostActorTick);
+}
+
+void UDamageQueueSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+
+	Queues.Empty();
+	ResolvingQueues.Empty();
+	Detonations.Empty();
+	QueueIndexByTarget.Empty();
+	NumActiveQueues = 0;
+	NumQueuedHits = 0;
+
+	Super::Deinitialize();
+}
+
+bool UDamageQueueSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UDamageQueueSubsystem::QueueDamage(UHealthComponent* Target, float Amount, AActor* Causer)
+{
+	int32& QueueIndex = QueueIndexByTarget.FindOrAdd(Target, INDEX_NONE);
+	if (QueueIndex == INDEX_NONE)
+	{
+		QueueIndex = NumActiveQueues++;
+		if (QueueIndex == Queues.Num())
+		{
+			Queues.AddDefaulted();
+		}
+		Queues[QueueIndex].Target = Target;
+	}
+
+	Queues[QueueIndex].Hits.Add({ Amount, Causer });
+	++NumQueuedHits;
+}
+
+void UDamageQueueSubsystem::QueueRadialDamage(const FVector& Origin, const FRadialDamageParams& Params, AActor* Causer)
+{
+	if (Params.BaseDamage <= 0.0f || Params.OuterRadius <= 0.0f)
+	{
+		return;
+	}
+
+	Detonations.Add({ Origin, Params, Causer });
+}
+
+void UDamageQueueSubsystem::HandlePostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World == GetWorld())
+	{
+		Flush();
+	}
+}
+
+void UDamageQueueSubsystem::Flush()
+{
+	ResolveDetonations();
+
+	if (NumQueuedHits == 0)
+	{
+		return;
+	}
+
+	// Hits queued while resolving (e.g. by a death explosion) go into the other buffer and resolve next frame
+	Swap(Queues, ResolvingQueues);
+	const int32 NumResolving = NumActiveQueues;
+	QueueIndexByTarget.Reset();
+	NumActiveQueues = 0;
+	NumQueuedHits = 0;
+
+	for (int32 QueueIndex = 0; QueueIndex < NumResolving; ++QueueIndex)
+	{
+		FTargetQueue& Queue = ResolvingQueues[QueueIndex];
+		if (UHealthComponent* Target = Queue.Target.Get())
+		{
+			Target->ResolveQueuedDamage(Queue.Hits);
+		}
+		Queue.Target.Reset();
+		Queue.Hits.Reset();
+	}
+}
+
+void UDamageQueueSubsystem::ResolveDetonations()
+{
+	if (Detonations.Num() == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_MVS_ResolveDetonations);
+
+	UWorld* World = GetWorld();
+	const UDamageReceiverRegistry* Registry = World->GetSubsystem<UDamageReceiverRegistry>();
+
+	CandidateTargets.Reset();
+	CandidateDetonations.Reset();
+	CandidateDX.Reset();
+	CandidateDY.Reset();
+	CandidateDZ.Reset();
+	CandidateRadius.Reset();
+
+	// Broad phase: one overlap per detonation, reduced to one entry per damageable actor in range
+	FCollisionObjectQueryParams ObjectParams;
+	ObjectParams.AddObjectTypesToQuery(ECC_Pawn);
+	ObjectParams.AddObjectTypesToQuery(ECC_Vehicle);
+
+	for (int32 DetonationIndex = 0; DetonationIndex < Detonations.Num(); ++DetonationIndex)
+	{
+		const FQueuedDetonation& Detonation = Detonations[DetonationIndex];
+		Overlaps.Reset();
+		World->OverlapMultiByObjectType(Overlaps, Detonation.Origin, FQuat::Identity, ObjectParams,
+			FCollisionShape::MakeSphere(FMath::Max(Detonation.Params.OuterRadius, Detonation.Params.InnerRadius)));
+
+		const int32 FirstCandidate = CandidateTargets.Num();
+		for (const FOverlapResult& Overlap : Overlaps)
+		{
+			UHealthComponent* Target = Registry ? Registry->FindHealthComponent(Overlap.GetComponent()) : nullptr;
+			if (!Target || !Target->IsAlive())
+			{
+				continue;
+			}
+
+			// Several components of one actor overlap the same blast; only the first counts
+			bool bAlreadyAdded = false;
+			for (int32 Index = FirstCandidate; Index < CandidateTargets.Num() && !bAlreadyAdded; ++Index)
+			{
+				bAlreadyAdded = CandidateTargets[Index] == Target;
+			}
+			if (bAlreadyAdded)
+			{
+				continue;
+			}
+
+			// Distance is measured to the actor's bounding sphere, so large hulls aren't only hit at their centre
+			const AActor* Owner = Target->GetOwner();
+			const USceneComponent* Root = Owner->GetRootComponent();
+			const FVector Center = Root ? Root->Bounds.Origin : Owner->GetActorLocation();
+			const FVector Offset = Center - Detonation.Origin;
+			CandidateTargets.Add(Target);
+			CandidateDetonations.Add(DetonationIndex);
+			CandidateDX.Add(Offset.X);
+			CandidateDY.Add(Offset.Y);
+			CandidateDZ.Add(Offset.Z);
+			CandidateRadius.Add(Root ? Root->Bounds.SphereRadius : 0.0f);
+		}
+	}
+
+	// Narrow phase: flat passes over every candidate so the distance math vectorizes
+	const int32 NumCandidates = CandidateTargets.Num();
+	CandidateDistance.SetNumUninitialized(NumCandidates, false);
+	CandidateDamage.SetNumUninitialized(NumCandidates, false);
+	float* RESTRICT Distance = CandidateDistance.GetData();
+	const float* RESTRICT DX = CandidateDX.GetData();
+	const float* RESTRICT DY = CandidateDY.GetData();
+	const float* RESTRICT DZ = CandidateDZ.GetData();
+	const float* RESTRICT Radius = CandidateRadius.GetData();
+	for (int32 Index = 0; Index < NumCandidates; ++Index)
+	{
+		Distance[Index] = FMath::Max(FMath::Sqrt(DX[Index] * DX[Index] + DY[Index] * DY[Index] + DZ[Index] * DZ[Index]) - Radius[Index], 0.0f);
+	}
+
+	// Same falloff as the engine's radial damage
+	float* RESTRICT Damage = CandidateDamage.GetData();
+	for (int32 Index = 0; Index < NumCandidates; ++Index)
+	{
+		const FRadialDamageParams& Params = Detonations[CandidateDetonations[Index]].Params;
+		Damage[Index] = FMath::Lerp(Params.MinimumDamage, Params.BaseDamage, Params.GetDamageScale(Distance[Index]));
+	}
+
+	for (int32 Index = 0; Index < NumCandidates; ++Index)
+	{
+		if (Damage[Index] > 0.0f)
+		{
+			QueueDamage(CandidateTargets[Index], Damage[Index], Detonations[CandidateDetonations[Index]].Causer.Get());
+		}
+	}
+
+	Detonations.Reset();
+}
+
+void UDamageQueueSubsystem::RunDetonationBenchmark(int32 Count)
+{
+	const UDamageReceiverRegistry* Registry = GetWorld()->GetSubsystem<UDamageReceiverRegistry>();
+	const TArray<TObjectPtr<UHealthComponent>>* Targets = Registry ? &Registry->GetHealthComponents() : nullptr;
+	if (!Targets || Targets->Num() == 0)
+	{
+		UE_LOG(LogMilitaryVehicle, Log, TEXT("Splash benchmark: no damageable actors"));
+		return;
+	}
+
+	// Airbursts a little above random targets, big enough to reach their neighbours; zero damage keeps it harmless
+	FRadialDamageParams Params;
+	Params.BaseDamage = 0.0f;
+	Params.MinimumDamage = 0.0f;
+	Params.InnerRadius = 300.0f;
+	Params.OuterRadius = 1500.0f;
+	Params.DamageFalloff = 1.0f;
+
+	Count = FMath::Max(1, Count);
+	Detonations.Reserve(Detonations.Num() + Count);
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		const UHealthComponent* Target = (*Targets)[FMath::RandHelper(Targets->Num())];
+		Detonations.Add({ Target->GetOwner()->GetActorLocation() + FVector(0.0f, 0.0f, 500.0f), Params, nullptr });
+	}
+
+	const int32 NumDetonations = Detonations.Num();
+	const double StartTime = FPlatformTime::Seconds();
+	ResolveDetonations();
+	const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+	UE_LOG(LogMilitaryVehicle, Log, TEXT("Splash benchmark: %d detonations, %d actors in range, %.3f ms (%.2f us per detonation)"),
+		NumDetonations, CandidateTargets.Num(), Seconds * 1000.0, Seconds * 1.0e6 / NumDetonations);
+}
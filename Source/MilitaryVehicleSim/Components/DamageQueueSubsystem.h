@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "Engine/OverlapResult.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "DamageQueueSubsystem.generated.h"
+
+class UHealthComponent;
+
+/** A hit waiting to be resolved at the end of the frame. */
+struct FQueuedDamage
+{
+	float Amount = 0.0f;
+	TWeakObjectPtr<AActor> Causer;
+};
+
+/** A splash detonation waiting to be resolved at the end of the frame. */
+struct FQueuedDetonation
+{
+	FVector Origin = FVector::ZeroVector;
+	FRadialDamageParams Params;
+	TWeakObjectPtr<AActor> Causer;
+};
+
+/**
+ * Server-side damage queue. UHealthComponent::ApplyDamage only records hits here; once every actor and
+ * tickable (ballistics included) has ticked, all hits on a target are resolved together, so each target
+ * changes health, broadcasts and replicates at most once per frame.
+ * Splash detonations are resolved as one batch just before that: one overlap query per detonation collects
+ * the damageable actors in range, falloff is computed in flat passes over all of them, and the results join
+ * the same per-target queues as direct hits.
+ */
+UCLASS()
+class MILITARYVEHICLESIM_API UDamageQueueSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	void QueueDamage(UHealthComponent* Target, float Amount, AActor* Causer);
+
+	/** Queues splash damage around Origin, falling off with distance to each actor's bounds. */
+	void QueueRadialDamage(const FVector& Origin, const FRadialDamageParams& Params, AActor* Causer);
+
+	/** Queues Count harmless detonations around registered actors and logs how long resolving them takes. */
+	void RunDetonationBenchmark(int32 Count);
+
+	/** Resolves every queued hit now. Called automatically after actors have ticked. */
+	void Flush();
+
+	int32 GetNumQueuedHits() const { return NumQueuedHits; }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	void HandlePostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+
+	/** Turns every queued detonation into queued damage on the actors it reaches. */
+	void ResolveDetonations();
+
+	struct FTargetQueue
+	{
+		TWeakObjectPtr<UHealthComponent> Target;
+		TArray<FQueuedDamage, TInlineAllocator<8>> Hits;
+	};
+
+	/** Targets hit this frame, in order of their first hit. Entries are reused between frames. */
+	TArray<FTargetQueue> Queues;
+	/** Queues being resolved by Flush, swapped with Queues so resolving can safely queue new hits. */
+	TArray<FTargetQueue> ResolvingQueues;
+	int32 NumActiveQueues = 0;
+	TMap<TWeakObjectPtr<UHealthComponent>, int32> QueueIndexByTarget;
+	int32 NumQueuedHits = 0;
+
+	TArray<FQueuedDetonation> Detonations;
+
+	// Detonation scratch, one entry per (detonation, damageable actor in range) pair, kept between frames
+	TArray<FOverlapResult> Overlaps;
+	TArray<UHealthComponent*> CandidateTargets;
+	TArray<int32> CandidateDetonations;
+	TArray<float> CandidateDX;
+	TArray<float> CandidateDY;
+	TArray<float> CandidateDZ;
+	TArray<float> CandidateRadius;
+	TArray<float> CandidateDistance;
+	TArray<float> CandidateDamage;
+
+	FDelegateHandle PostActorTickHandle;
+};
@@ -0,0 +1,149 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DamageReceiverRegistry.h"
+
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "MilitaryVehicleSim/MilitaryVehicleSim.h"
+#include "MilitaryVehicleSim/Components/HealthComponent.h"
+#include "MilitaryVehicleSim/Components/TurretComponent.h"
+
+static FAutoConsoleCommandWithWorldAndArgs DamageReceiverBenchmarkCommand(
+	TEXT("mvs.DamageRegistry.Benchmark"),
+	TEXT("Times health component lookups via GetComponentByClass versus the registry. Optional arg: iterations (default 1000)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (const UDamageReceiverRegistry* Registry = World ? World->GetSubsystem<UDamageReceiverRegistry>() : nullptr)
+		{
+			Registry->RunLookupBenchmark(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000);
+		}
+	}));
+
+bool UDamageReceiverRegistry::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UDamageReceiverRegistry::Deinitialize()
+{
+	HealthComponents.Empty();
+	HealthIndexByActor.Empty();
+	TurretByActor.Empty();
+
+	Super::Deinitialize();
+}
+
+UDamageReceiverRegistry* UDamageReceiverRegistry::Get(const AActor* Actor)
+{
+	const UWorld* World = Actor ? Actor->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UDamageReceiverRegistry>() : nullptr;
+}
+
+void UDamageReceiverRegistry::RegisterHealthComponent(UHealthComponent* HealthComponent)
+{
+	AActor* Owner = HealthComponent ? HealthComponent->GetOwner() : nullptr;
+	if (!Owner || HealthIndexByActor.Contains(Owner))
+	{
+		return;
+	}
+
+	HealthIndexByActor.Add(Owner, HealthComponents.Add(HealthComponent));
+}
+
+void UDamageReceiverRegistry::UnregisterHealthComponent(UHealthComponent* HealthComponent)
+{
+	AActor* Owner = HealthComponent ? HealthComponent->GetOwner() : nullptr;
+	int32 Index = INDEX_NONE;
+	if (!Owner || !HealthIndexByActor.RemoveAndCopyValue(Owner, Index))
+	{
+		return;
+	}
+
+	// Keep the array packed; the last entry moves into the freed slot
+	HealthComponents.RemoveAtSwap(Index, 1, false);
+	if (HealthComponents.IsValidIndex(Index))
+	{
+		HealthIndexByActor.Add(HealthComponents[Index]->GetOwner(), Index);
+	}
+}
+
+void UDamageReceiverRegistry::RegisterTurretComponent(UTurretComponent* TurretComponent)
+{
+	if (AActor* Owner = TurretComponent ? TurretComponent->GetOwner() : nullptr)
+	{
+		TurretByActor.Add(Owner, TurretComponent);
+	}
+}
+
+void UDamageReceiverRegistry::UnregisterTurretComponent(UTurretComponent* TurretComponent)
+{
+	if (AActor* Owner = TurretComponent ? TurretComponent->GetOwner() : nullptr)
+	{
+		TurretByActor.Remove(Owner);
+	}
+}
+
+UHealthComponent* UDamageReceiverRegistry::FindHealthComponent(const AActor* Actor) const
+{
+	const int32* Index = Actor ? HealthIndexByActor.Find(Actor) : nullptr;
+	return Index ? HealthComponents[*Index].Get() : nullptr;
+}
+
+UHealthComponent* UDamageReceiverRegistry::FindHealthComponent(const UPrimitiveComponent* HitComponent) const
+{
+	return HitComponent ? FindHealthComponent(HitComponent->GetOwner()) : nullptr;
+}
+
+UTurretComponent* UDamageReceiverRegistry::FindTurretComponent(const AActor* Actor) const
+{
+	const TWeakObjectPtr<UTurretComponent>* Turret = Actor ? TurretByActor.Find(Actor) : nullptr;
+	return Turret ? Turret->Get() : nullptr;
+}
+
+void UDamageReceiverRegistry::RunLookupBenchmark(int32 Iterations) const
+{
+	TArray<const AActor*> Actors;
+	Actors.Reserve(HealthComponents.Num());
+	for (const UHealthComponent* HealthComponent : HealthComponents)
+	{
+		Actors.Add(HealthComponent->GetOwner());
+	}
+
+	Iterations = FMath::Max(1, Iterations);
+	const int32 NumLookups = Iterations * Actors.Num();
+	if (NumLookups == 0)
+	{
+		UE_LOG(LogMilitaryVehicle, Log, TEXT("Damage registry benchmark: no registered actors"));
+		return;
+	}
+
+	// Count the hits so neither loop can be optimized away
+	int32 ScanFound = 0;
+	const double ScanStart = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+	{
+		for (const AActor* Actor : Actors)
+		{
+			ScanFound += Actor->GetComponentByClass(UHealthComponent::StaticClass()) != nullptr;
+		}
+	}
+	const double ScanSeconds = FPlatformTime::Seconds() - ScanStart;
+
+	int32 RegistryFound = 0;
+	const double RegistryStart = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+	{
+		for (const AActor* Actor : Actors)
+		{
+			RegistryFound += FindHealthComponent(Actor) != nullptr;
+		}
+	}
+	const double RegistrySeconds = FPlatformTime::Seconds() - RegistryStart;
+
+	UE_LOG(LogMilitaryVehicle, Log, TEXT("Damage registry benchmark: %d actors x %d iterations"), Actors.Num(), Iterations);
+	UE_LOG(LogMilitaryVehicle, Log, TEXT("  GetComponentByClass: %.1f ns/lookup (%d found)"), ScanSeconds * 1.0e9 / NumLookups, ScanFound);
+	UE_LOG(LogMilitaryVehicle, Log, TEXT("  Registry:            %.1f ns/lookup (%d found), %.1fx"), RegistrySeconds * 1.0e9 / NumLookups, RegistryFound,
+		RegistrySeconds > 0.0 ? ScanSeconds / RegistrySeconds : 0.0);
+}
@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "DamageReceiverRegistry.generated.h"
+
+class UHealthComponent;
+class UPrimitiveComponent;
+class UTurretComponent;
+
+/**
+ * Constant-time lookup of the health and turret components of an actor, replacing GetComponentByClass
+ * scans on every hit and shot. Components register themselves in BeginPlay and unregister in EndPlay.
+ * Live health components are also kept packed in one array for systems that sweep over every damageable actor.
+ */
+UCLASS()
+class MILITARYVEHICLESIM_API UDamageReceiverRegistry : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	void RegisterHealthComponent(UHealthComponent* HealthComponent);
+	void UnregisterHealthComponent(UHealthComponent* HealthComponent);
+
+	void RegisterTurretComponent(UTurretComponent* TurretComponent);
+	void UnregisterTurretComponent(UTurretComponent* TurretComponent);
+
+	UHealthComponent* FindHealthComponent(const AActor* Actor) const;
+
+	/** Health component of the actor owning a hit component. */
+	UHealthComponent* FindHealthComponent(const UPrimitiveComponent* HitComponent) const;
+
+	UTurretComponent* FindTurretComponent(const AActor* Actor) const;
+
+	/** Every registered health component, packed. Order changes as components unregister. */
+	const TArray<TObjectPtr<UHealthComponent>>& GetHealthComponents() const { return HealthComponents; }
+
+	/** Times GetComponentByClass against the registry over every registered actor and logs the cost per lookup. */
+	void RunLookupBenchmark(int32 Iterations) const;
+
+	/** Registry of the actor's world, or null. */
+	static UDamageReceiverRegistry* Get(const AActor* Actor);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	UPROPERTY()
+	TArray<TObjectPtr<UHealthComponent>> HealthComponents;
+
+	TMap<TObjectKey<AActor>, int32> HealthIndexByActor;
+
+	TMap<TObjectKey<AActor>, TWeakObjectPtr<UTurretComponent>> TurretByActor;
+};
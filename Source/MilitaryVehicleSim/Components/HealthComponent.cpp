@@ -2,8 +2,15 @@
 
 
 #include "HealthComponent.h"
+#include "GameFramework/GameStateBase.h"
+#include "MilitaryVehicleSim/Components/DamageQueueSubsystem.h"
+#include "MilitaryVehicleSim/Components/DamageReceiverRegistry.h"
+#include "MilitaryVehicleSim/MilitaryVehicleSim.h"
 #include "Net/UnrealNetwork.h"
 
+DECLARE_CYCLE_STAT(TEXT("Health ApplyDamage"), STAT_MVS_ApplyDamage, STATGROUP_MilitaryVehicle);
+DECLARE_CYCLE_STAT(TEXT("Health ResolveQueuedDamage"), STAT_MVS_ResolveQueuedDamage, STATGROUP_MilitaryVehicle);
+
 UHealthComponent::UHealthComponent()
 {
 	PrimaryComponentTick.bCanEverTick = false;
@@ -11,6 +18,8 @@ UHealthComponent::UHealthComponent()
 
 	MaxHealth = 300.0f;
 	CurrentHealth = MaxHealth;
+	MaxDamageLogEntries = 16;
+	DamageLog.Owner = this;
 }
 
 void UHealthComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
@@ -18,6 +27,7 @@ void UHealthComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& Out
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
 	DOREPLIFETIME(UHealthComponent, CurrentHealth);
+	DOREPLIFETIME(UHealthComponent, DamageLog);
 }
 
 void UHealthComponent::BeginPlay()
@@ -25,6 +35,21 @@ void UHealthComponent::BeginPlay()
 	Super::BeginPlay();
 	CurrentHealth = MaxHealth;
 	BroadcastHealthChanged();
+
+	if (UDamageReceiverRegistry* Registry = UDamageReceiverRegistry::Get(GetOwner()))
+	{
+		Registry->RegisterHealthComponent(this);
+	}
+}
+
+void UHealthComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UDamageReceiverRegistry* Registry = UDamageReceiverRegistry::Get(GetOwner()))
+	{
+		Registry->UnregisterHealthComponent(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 float UHealthComponent::GetHealthPercentage() const
@@ -34,6 +59,8 @@ float UHealthComponent::GetHealthPercentage() const
 
 void UHealthComponent::ApplyDamage(float DamageAmount, AActor* DamageCauser)
 {
+	SCOPE_CYCLE_COUNTER(STAT_MVS_ApplyDamage);
+
 	// Only apply damage on server
 	if (!GetOwner()->HasAuthority())
 	{
@@ -45,7 +72,46 @@ void UHealthComponent::ApplyDamage(float DamageAmount, AActor* DamageCauser)
 		return;
 	}
 
-	CurrentHealth = FMath::Max(0.0f, CurrentHealth - DamageAmount);
+	if (UDamageQueueSubsystem* DamageQueue = GetWorld()->GetSubsystem<UDamageQueueSubsystem>())
+	{
+		DamageQueue->QueueDamage(this, DamageAmount, DamageCauser);
+		return;
+	}
+
+	const FQueuedDamage Hit{ DamageAmount, DamageCauser };
+	ResolveQueuedDamage(MakeArrayView(&Hit, 1));
+}
+
+void UHealthComponent::ResolveQueuedDamage(TConstArrayView<FQueuedDamage> Hits)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MVS_ResolveQueuedDamage);
+
+	if (!IsAlive())
+	{
+		return;
+	}
+
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	const float Now = GameState ? static_cast<float>(GameState->GetServerWorldTimeSeconds()) : GetWorld()->GetTimeSeconds();
+	const bool bBroadcastHits = GetNetMode() != NM_DedicatedServer;
+
+	for (const FQueuedDamage& Hit : Hits)
+	{
+		// Hits after the killing blow are dropped, as they were when damage applied immediately
+		if (CurrentHealth <= 0.0f)
+		{
+			break;
+		}
+
+		CurrentHealth = FMath::Max(0.0f, CurrentHealth - Hit.Amount);
+		DamageLog.Add(Hit.Causer.Get(), Hit.Amount, Now, MaxDamageLogEntries);
+
+		if (bBroadcastHits)
+		{
+			OnDamageTaken.Broadcast(Hit.Causer.Get(), Hit.Amount, Now);
+		}
+	}
+
 	BroadcastHealthChanged();
 
 	if (CurrentHealth <= 0.0f)
@@ -3,10 +3,14 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "MilitaryVehicleSim/Components/DamageLog.h"
 #include "HealthComponent.generated.h"
 
+struct FQueuedDamage;
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnHealthChanged, float, CurrentHealth, float, MaxHealth);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnDeath);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnDamageTaken, AActor*, Attacker, float, Amount, float, Time);
 
 /**
  * Component responsible for managing actor health
@@ -34,18 +38,30 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Health")
 	bool IsAlive() const { return CurrentHealth > 0.0f; }
 
-	// Apply damage to this component (should be called on server)
+	// Apply damage to this component (should be called on server).
+	// Queued through UDamageQueueSubsystem and resolved with the frame's other hits on this component.
 	UFUNCTION(BlueprintCallable, Category = "Health")
 	void ApplyDamage(float DamageAmount, AActor* DamageCauser);
 
+	/** Applies a frame's worth of hits in order, then broadcasts once. */
+	void ResolveQueuedDamage(TConstArrayView<FQueuedDamage> Hits);
+
+	UFUNCTION(BlueprintCallable, Category = "Health")
+	const TArray<FDamageLogEntry>& GetDamageLog() const { return DamageLog.Entries; }
+
 	UPROPERTY(BlueprintAssignable, Category = "Health")
 	FOnHealthChanged OnHealthChanged;
 
 	UPROPERTY(BlueprintAssignable, Category = "Health")
 	FOnDeath OnDeath;
 
+	/** Fires for every logged hit, on the server and on clients as damage log entries arrive. Use it for hit feedback. */
+	UPROPERTY(BlueprintAssignable, Category = "Health")
+	FOnDamageTaken OnDamageTaken;
+
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Health", meta = (ClampMin = "0.0"))
 	float MaxHealth;
@@ -56,6 +72,13 @@ protected:
 	UFUNCTION()
 	void OnRep_CurrentHealth();
 
+	/** Number of recent hits kept in the replicated damage log. */
+	UPROPERTY(EditDefaultsOnly, Category = "Health", meta = (ClampMin = "1"))
+	int32 MaxDamageLogEntries;
+
+	UPROPERTY(Replicated)
+	FDamageLog DamageLog;
+
 private:
 	void BroadcastHealthChanged();
 };
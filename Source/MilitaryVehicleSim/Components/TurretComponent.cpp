@@ -1,11 +1,14 @@
 ﻿#include "TurretComponent.h"
 
+#include "MilitaryVehicleSim/Components/DamageReceiverRegistry.h"
+
 UTurretComponent::UTurretComponent()
 {
 	PrimaryComponentTick.bCanEverTick = false;
 
 	MuzzleSocketName = TEXT("MuzzleSocket");
 	RotationSpeed = 50.0f;
+	MaxYawRate = 180.0f;
 	VisualRotationOffset = FRotator::ZeroRotator;
 	MuzzleRotationOffset = FRotator::ZeroRotator;
 
@@ -20,14 +23,43 @@ UTurretComponent::UTurretComponent()
 	SetCanEverAffectNavigation(false);
 }
 
+void UTurretComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (UDamageReceiverRegistry* Registry = UDamageReceiverRegistry::Get(GetOwner()))
+	{
+		Registry->RegisterTurretComponent(this);
+	}
+}
+
+void UTurretComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UDamageReceiverRegistry* Registry = UDamageReceiverRegistry::Get(GetOwner()))
+	{
+		Registry->UnregisterTurretComponent(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void UTurretComponent::RotateTurret(float YawInput)
 {
 	if (YawInput == 0.0f) return;
 
-	float DeltaYaw = YawInput * RotationSpeed * GetWorld()->GetDeltaSeconds();
+	const float DeltaSeconds = GetWorld()->GetDeltaSeconds();
+	const float MaxDeltaYaw = MaxYawRate * DeltaSeconds;
+	float DeltaYaw = FMath::Clamp(YawInput * RotationSpeed * DeltaSeconds, -MaxDeltaYaw, MaxDeltaYaw);
 	AddLocalRotation(FRotator(0.0f, DeltaYaw, 0.0f));
 }
 
+void UTurretComponent::SetTurretYaw(float Yaw)
+{
+	FRotator NewRotation = GetRelativeRotation();
+	NewRotation.Yaw = Yaw;
+	SetRelativeRotation(NewRotation);
+}
+
 FVector UTurretComponent::GetMuzzleLocation() const
 {
 	if (DoesSocketExist(MuzzleSocketName))
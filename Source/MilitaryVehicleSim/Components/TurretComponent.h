@@ -12,9 +12,17 @@ class MILITARYVEHICLESIM_API UTurretComponent : public UStaticMeshComponent
 public:
 	UTurretComponent();
 
-	/** Rotates the turret on the yaw axis. */
+	/** Rotates the turret on the yaw axis, no faster than MaxYawRate. */
 	void RotateTurret(float YawInput);
 
+	/** Sets the turret's relative yaw directly. */
+	void SetTurretYaw(float Yaw);
+
+	float GetTurretYaw() const { return GetRelativeRotation().Yaw; }
+
+	/** Fastest the turret may traverse, in degrees per second. The server holds remote aim to the same limit. */
+	float GetMaxYawRate() const { return MaxYawRate; }
+
 	/** Returns the location of the MuzzleSocket. */
 	FVector GetMuzzleLocation() const;
 
@@ -22,12 +30,18 @@ public:
 	FRotator GetMuzzleRotation() const;
 
 protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	UPROPERTY(EditDefaultsOnly, Category = "Turret")
 	FName MuzzleSocketName;
 
 	UPROPERTY(EditDefaultsOnly, Category = "Turret")
 	float RotationSpeed;
 
+	UPROPERTY(EditDefaultsOnly, Category = "Turret", meta = (ClampMin = "0.0"))
+	float MaxYawRate;
+
 	/** Offset applied to the mesh to align its forward axis. */
 	UPROPERTY(EditDefaultsOnly, Category = "Turret")
 	FRotator VisualRotationOffset;
@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatStats.h"
+
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "ProfilingDebugging/CountersTrace.h"
+
+DEFINE_STAT(STAT_MVS_LiveProjectiles);
+DEFINE_STAT(STAT_MVS_LiveRounds);
+DEFINE_STAT(STAT_MVS_ShotsPerSecond);
+DEFINE_STAT(STAT_MVS_HitsPerSecond);
+DEFINE_STAT(STAT_MVS_RpcsPerSecond);
+
+#if MVS_COMBAT_STATS
+
+TRACE_DECLARE_INT_COUNTER(MVS_LiveProjectiles, TEXT("MilitaryVehicle/LiveProjectiles"));
+TRACE_DECLARE_INT_COUNTER(MVS_LiveRounds, TEXT("MilitaryVehicle/LiveRounds"));
+TRACE_DECLARE_FLOAT_COUNTER(MVS_ShotsPerSecond, TEXT("MilitaryVehicle/ShotsPerSecond"));
+TRACE_DECLARE_FLOAT_COUNTER(MVS_HitsPerSecond, TEXT("MilitaryVehicle/HitsPerSecond"));
+TRACE_DECLARE_FLOAT_COUNTER(MVS_RpcsPerSecond, TEXT("MilitaryVehicle/RpcsPerSecond"));
+
+namespace CombatStats
+{
+	void Count(const UObject* WorldContextObject, EEvent Event)
+	{
+		const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+		if (UCombatStatsSubsystem* Stats = World ? World->GetSubsystem<UCombatStatsSubsystem>() : nullptr)
+		{
+			Stats->CountEvent(Event);
+		}
+	}
+
+	void AddLiveProjectiles(int32 Delta)
+	{
+		INC_DWORD_STAT_BY(STAT_MVS_LiveProjectiles, Delta);
+		TRACE_COUNTER_ADD(MVS_LiveProjectiles, Delta);
+	}
+
+	void SetLiveRounds(int32 NumRounds)
+	{
+		SET_DWORD_STAT(STAT_MVS_LiveRounds, NumRounds);
+		TRACE_COUNTER_SET(MVS_LiveRounds, NumRounds);
+	}
+}
+
+#endif
+
+bool UCombatStatsSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return MVS_COMBAT_STATS && Super::ShouldCreateSubsystem(Outer);
+}
+
+bool UCombatStatsSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UCombatStatsSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatStatsSubsystem, STATGROUP_Tickables);
+}
+
+void UCombatStatsSubsystem::Tick(float DeltaTime)
+{
+#if MVS_COMBAT_STATS
+	SecondsSincePublish += DeltaTime;
+	if (SecondsSincePublish < 1.0f)
+	{
+		return;
+	}
+
+	const float ShotsPerSecond = EventCounts[static_cast<int32>(CombatStats::EEvent::Shot)] / SecondsSincePublish;
+	const float HitsPerSecond = EventCounts[static_cast<int32>(CombatStats::EEvent::Hit)] / SecondsSincePublish;
+	const float RpcsPerSecond = EventCounts[static_cast<int32>(CombatStats::EEvent::Rpc)] / SecondsSincePublish;
+	FMemory::Memzero(EventCounts);
+	SecondsSincePublish = 0.0f;
+
+	if (!ShouldPublish())
+	{
+		return;
+	}
+
+	SET_FLOAT_STAT(STAT_MVS_ShotsPerSecond, ShotsPerSecond);
+	SET_FLOAT_STAT(STAT_MVS_HitsPerSecond, HitsPerSecond);
+	SET_FLOAT_STAT(STAT_MVS_RpcsPerSecond, RpcsPerSecond);
+	TRACE_COUNTER_SET(MVS_ShotsPerSecond, ShotsPerSecond);
+	TRACE_COUNTER_SET(MVS_HitsPerSecond, HitsPerSecond);
+	TRACE_COUNTER_SET(MVS_RpcsPerSecond, RpcsPerSecond);
+#endif
+}
+
+bool UCombatStatsSubsystem::ShouldPublish() const
+{
+	const UWorld* Publisher = nullptr;
+	for (const FWorldContext& Context : GEngine->GetWorldContexts())
+	{
+		const UWorld* World = Context.World();
+		if (!World || !DoesSupportWorldType(World->WorldType) || !World->GetSubsystem<UCombatStatsSubsystem>())
+		{
+			continue;
+		}
+		if (World->GetNetMode() != NM_Client)
+		{
+			Publisher = World;
+			break;
+		}
+		if (!Publisher)
+		{
+			Publisher = World;
+		}
+	}
+	return Publisher == GetWorld();
+}
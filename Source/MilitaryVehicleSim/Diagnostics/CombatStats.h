@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MilitaryVehicleSim/MilitaryVehicleSim.h"
+#include "CombatStats.generated.h"
+
+/** Combat counters are compiled out of shipping builds; the cycle stats go with STATS. */
+#define MVS_COMBAT_STATS !UE_BUILD_SHIPPING
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Live projectile actors"), STAT_MVS_LiveProjectiles, STATGROUP_MilitaryVehicle, MILITARYVEHICLESIM_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Live ballistic rounds"), STAT_MVS_LiveRounds, STATGROUP_MilitaryVehicle, MILITARYVEHICLESIM_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Shots/sec"), STAT_MVS_ShotsPerSecond, STATGROUP_MilitaryVehicle, MILITARYVEHICLESIM_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Hits/sec"), STAT_MVS_HitsPerSecond, STATGROUP_MilitaryVehicle, MILITARYVEHICLESIM_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("RPCs/sec"), STAT_MVS_RpcsPerSecond, STATGROUP_MilitaryVehicle, MILITARYVEHICLESIM_API);
+
+/**
+ * Event counters for the combat pipeline, counted per world by its UCombatStatsSubsystem. Rates are published once a
+ * second to "stat MilitaryVehicle" and, with "Trace.Enable counters", to the MilitaryVehicle counters in Insights.
+ * The cycle stats in the same group also show up as CPU scopes in Insights with the cpu channel on.
+ */
+namespace CombatStats
+{
+	enum class EEvent : uint8
+	{
+		Shot,
+		Hit,
+		Rpc,
+		Num
+	};
+
+#if MVS_COMBAT_STATS
+	/** Counts an event in the world of WorldContextObject. */
+	MILITARYVEHICLESIM_API void Count(const UObject* WorldContextObject, EEvent Event);
+	MILITARYVEHICLESIM_API void AddLiveProjectiles(int32 Delta);
+	MILITARYVEHICLESIM_API void SetLiveRounds(int32 NumRounds);
+#else
+	inline void Count(const UObject* WorldContextObject, EEvent Event) {}
+	inline void AddLiveProjectiles(int32 Delta) {}
+	inline void SetLiveRounds(int32 NumRounds) {}
+#endif
+}
+
+/**
+ * Counts the combat events of its world and turns them into per-second rates. Stats are process wide, so with several
+ * worlds, as in multi-client PIE, only one publishes them: the first server or standalone world, else the first client.
+ * Not created in shipping builds.
+ */
+UCLASS()
+class MILITARYVEHICLESIM_API UCombatStatsSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void CountEvent(CombatStats::EEvent Event) { ++EventCounts[static_cast<int32>(Event)]; }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	bool ShouldPublish() const;
+
+	int32 EventCounts[static_cast<int32>(CombatStats::EEvent::Num)] = {};
+	float SecondsSincePublish = 0.0f;
+};
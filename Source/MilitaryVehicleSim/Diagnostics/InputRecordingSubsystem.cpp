@@ -0,0 +1,641 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InputRecordingSubsystem.h"
+
+#include "AIController.h"
+#include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "InputActionValue.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "MilitaryVehicleSim/MilitaryVehicleSim.h"
+#include "MilitaryVehicleSim/Vehicles/MilitaryVehicleBase.h"
+
+static FAutoConsoleCommandWithWorldAndArgs RecordInputCommand(
+	TEXT("mvs.Input.Record"),
+	TEXT("Records the input of locally controlled vehicles until mvs.Input.Stop. Optional arg: output path."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UInputRecordingSubsystem* Recorder = World ? World->GetSubsystem<UInputRecordingSubsystem>() : nullptr)
+		{
+			Recorder->StartRecording(Args.Num() > 0 ? Args[0] : FString());
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs PlayInputCommand(
+	TEXT("mvs.Input.Play"),
+	TEXT("Plays back one or more recorded input streams in new vehicles. Args: paths."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UInputRecordingSubsystem* Recorder = World ? World->GetSubsystem<UInputRecordingSubsystem>() : nullptr)
+		{
+			Recorder->StartPlayback(Args);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld StopInputCommand(
+	TEXT("mvs.Input.Stop"),
+	TEXT("Stops input recording, writing the stream, and any playback."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UInputRecordingSubsystem* Recorder = World ? World->GetSubsystem<UInputRecordingSubsystem>() : nullptr)
+		{
+			Recorder->StopRecording();
+			Recorder->StopPlayback();
+		}
+	}));
+
+namespace InputRecording
+{
+	static constexpr uint32 Magic = 0x4D565349; // "MVSI"
+	static constexpr uint16 Version = 2;
+
+	/** Event kind marking a vehicle's first appearance, followed by its class, transform and role. */
+	static constexpr uint8 SpawnRecord = 0x7F;
+
+	/** Set on the event kind of button actions when pressed; they carry no other value. */
+	static constexpr uint8 PressedBit = 0x80;
+
+	enum class EValueType : uint8
+	{
+		Bool,
+		Axis1D,
+		Axis2D,
+	};
+
+	EValueType GetValueType(EVehicleInputAction Action)
+	{
+		switch (Action)
+		{
+		case EVehicleInputAction::Throttle:
+		case EVehicleInputAction::Steer:
+		case EVehicleInputAction::Brake:
+			return EValueType::Axis1D;
+		case EVehicleInputAction::Look:
+		case EVehicleInputAction::LookWithMouse:
+			return EValueType::Axis2D;
+		default:
+			return EValueType::Bool;
+		}
+	}
+
+	FInputActionValue MakeValue(EVehicleInputAction Action, const FVector2D& Value)
+	{
+		switch (GetValueType(Action))
+		{
+		case EValueType::Axis1D:
+			return FInputActionValue(static_cast<float>(Value.X));
+		case EValueType::Axis2D:
+			return FInputActionValue(Value);
+		default:
+			return FInputActionValue(Value.X != 0.0);
+		}
+	}
+}
+
+bool UInputRecordingSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UInputRecordingSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	TickStartHandle = FWorldDelegates::OnWorldTickStart.AddUObject(this, &UInputRecordingSubsystem::HandleWorldTickStart);
+	PostTickFlushHandle = InWorld.OnPostTickFlush().AddUObject(this, &UInputRecordingSubsystem::HandlePostTickFlush);
+
+	FString PlaybackPaths;
+	if (FParse::Value(FCommandLine::Get(), TEXT("InputPlayback="), PlaybackPaths))
+	{
+		TArray<FString> Paths;
+		PlaybackPaths.ParseIntoArray(Paths, TEXT("+"));
+		bExitWhenDone = true;
+		if (!StartPlayback(Paths))
+		{
+			FPlatformMisc::RequestExitWithStatus(false, 1);
+		}
+		return;
+	}
+
+	FString Path;
+	if (FParse::Value(FCommandLine::Get(), TEXT("InputRecord="), Path) || FParse::Param(FCommandLine::Get(), TEXT("InputRecord")))
+	{
+		StartRecording(Path);
+	}
+}
+
+void UInputRecordingSubsystem::Deinitialize()
+{
+	bExitWhenDone = false;
+	StopRecording();
+	StopPlayback();
+
+	FWorldDelegates::OnWorldTickStart.Remove(TickStartHandle);
+	if (UWorld* World = GetWorld())
+	{
+		World->OnPostTickFlush().Remove(PostTickFlushHandle);
+	}
+
+	Super::Deinitialize();
+}
+
+double UInputRecordingSubsystem::GetServerWorldTime() const
+{
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	return GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+}
+
+FString UInputRecordingSubsystem::GetCurrentMapName() const
+{
+	return UWorld::RemovePIEPrefix(GetWorld()->GetMapName());
+}
+
+void UInputRecordingSubsystem::SeedRandom(int32 Seed)
+{
+	FMath::RandInit(Seed);
+	FMath::SRandInit(Seed);
+}
+
+bool UInputRecordingSubsystem::StartRecording(const FString& Path)
+{
+	if (bRecording || IsPlayingBack())
+	{
+		UE_LOG(LogMilitaryVehicle, Warning, TEXT("Input: already recording or playing back"));
+		return false;
+	}
+
+	RecordPath = Path.IsEmpty()
+		? FPaths::ProjectSavedDir() / TEXT("Input") / FString::Printf(TEXT("Input-%s.mvsinput"), *FDateTime::Now().ToString())
+		: Path;
+
+	int32 Seed = static_cast<int32>(FPlatformTime::Cycles());
+	FParse::Value(FCommandLine::Get(), TEXT("InputSeed="), Seed);
+	SeedRandom(Seed);
+
+	RecordBuffer.Reset();
+	FrameEventBytes.Reset();
+	FrameEventCount = 0;
+	FrameDelta = static_cast<float>(FApp::GetDeltaTime());
+	RecordedPlayers.Reset();
+
+	// Server time is shared by every machine in the session, so streams recorded on different clients line up on it
+	RecordStartServerTime = GetServerWorldTime();
+	FrameServerTime = RecordStartServerTime;
+
+	FMemoryWriter Writer(RecordBuffer);
+	uint32 Magic = InputRecording::Magic;
+	uint16 Version = InputRecording::Version;
+	FString MapName = GetCurrentMapName();
+	Writer << Magic << Version << Seed << MapName << RecordStartServerTime;
+
+	bRecording = true;
+	UE_LOG(LogMilitaryVehicle, Log, TEXT("Input: recording with seed %d to %s"), Seed, *RecordPath);
+	return true;
+}
+
+void UInputRecordingSubsystem::StopRecording()
+{
+	if (!bRecording)
+	{
+		return;
+	}
+
+	FlushRecordedFrame();
+	bRecording = false;
+
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(RecordPath), true);
+	if (FFileHelper::SaveArrayToFile(RecordBuffer, *RecordPath))
+	{
+		UE_LOG(LogMilitaryVehicle, Log, TEXT("Input: wrote %d players, %d bytes to %s"), RecordedPlayers.Num(), RecordBuffer.Num(), *RecordPath);
+	}
+	else
+	{
+		UE_LOG(LogMilitaryVehicle, Error, TEXT("Input: could not write %s"), *RecordPath);
+	}
+
+	RecordBuffer.Empty();
+	FrameEventBytes.Empty();
+	RecordedPlayers.Empty();
+}
+
+int32 UInputRecordingSubsystem::FindOrAddRecordedPlayer(const AMilitaryVehicleBase* Vehicle)
+{
+	if (const int32* Player = RecordedPlayers.Find(Vehicle))
+	{
+		return *Player;
+	}
+
+	const int32 Player = RecordedPlayers.Num();
+	RecordedPlayers.Add(Vehicle, Player);
+
+	// Where the vehicle is now, so playback starts it from the same place whatever spawned it
+	FMemoryWriter Writer(FrameEventBytes, false, true);
+	uint8 Kind = InputRecording::SpawnRecord;
+	uint32 PlayerIndex = static_cast<uint32>(Player);
+	FString VehicleClass = FSoftClassPath(Vehicle->GetClass()).ToString();
+	FVector Location = Vehicle->GetActorLocation();
+	FQuat Rotation = Vehicle->GetActorQuat();
+	bool bDriver = Vehicle->IsDriverRole();
+	Writer << Kind;
+	Writer.SerializeIntPacked(PlayerIndex);
+	Writer << VehicleClass << Location << Rotation << bDriver;
+	++FrameEventCount;
+
+	return Player;
+}
+
+void UInputRecordingSubsystem::RecordInput(const AMilitaryVehicleBase* Vehicle, EVehicleInputAction Action, const FInputActionValue& Value)
+{
+	if (!bRecording || !Vehicle)
+	{
+		return;
+	}
+
+	uint32 Player = static_cast<uint32>(FindOrAddRecordedPlayer(Vehicle));
+
+	FMemoryWriter Writer(FrameEventBytes, false, true);
+	uint8 Kind = static_cast<uint8>(Action);
+	switch (InputRecording::GetValueType(Action))
+	{
+	case InputRecording::EValueType::Bool:
+		Kind |= Value.Get<bool>() ? InputRecording::PressedBit : 0;
+		Writer << Kind;
+		Writer.SerializeIntPacked(Player);
+		break;
+	case InputRecording::EValueType::Axis1D:
+	{
+		float Axis = Value.Get<float>();
+		Writer << Kind;
+		Writer.SerializeIntPacked(Player);
+		Writer << Axis;
+		break;
+	}
+	case InputRecording::EValueType::Axis2D:
+	{
+		const FVector2D Axis2D = Value.Get<FVector2D>();
+		float X = static_cast<float>(Axis2D.X);
+		float Y = static_cast<float>(Axis2D.Y);
+		Writer << Kind;
+		Writer.SerializeIntPacked(Player);
+		Writer << X << Y;
+		break;
+	}
+	}
+	++FrameEventCount;
+}
+
+void UInputRecordingSubsystem::FlushRecordedFrame()
+{
+	FMemoryWriter Writer(RecordBuffer, false, true);
+	uint32 NumEvents = static_cast<uint32>(FrameEventCount);
+	float ServerTimeOffset = static_cast<float>(FrameServerTime - RecordStartServerTime);
+	Writer << FrameDelta << ServerTimeOffset;
+	Writer.SerializeIntPacked(NumEvents);
+	RecordBuffer.Append(FrameEventBytes);
+
+	FrameEventBytes.Reset();
+	FrameEventCount = 0;
+}
+
+bool UInputRecordingSubsystem::LoadStream(const FString& Path, const FString& ExpectedMapName, FPlaybackStream& OutStream)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Path))
+	{
+		UE_LOG(LogMilitaryVehicle, Error, TEXT("Input: could not read %s"), *Path);
+		return false;
+	}
+
+	FMemoryReader Reader(Bytes);
+	uint32 Magic = 0;
+	uint16 Version = 0;
+	FString MapName;
+	Reader << Magic << Version;
+	if (Magic != InputRecording::Magic || Version != InputRecording::Version)
+	{
+		UE_LOG(LogMilitaryVehicle, Error, TEXT("Input: %s is not an input stream of version %d"), *Path, InputRecording::Version);
+		return false;
+	}
+	double StartServerTime = 0.0;
+	Reader << OutStream.Seed << MapName << StartServerTime;
+	OutStream.Path = Path;
+
+	// Vehicles would spawn at the recorded transforms in a different level
+	if (MapName != ExpectedMapName)
+	{
+		UE_LOG(LogMilitaryVehicle, Error, TEXT("Input: %s was recorded on %s, not %s"), *Path, *MapName, *ExpectedMapName);
+		return false;
+	}
+
+	while (!Reader.AtEnd() && !Reader.IsError())
+	{
+		float Delta = 0.0f;
+		float ServerTimeOffset = 0.0f;
+		uint32 NumEvents = 0;
+		Reader << Delta << ServerTimeOffset;
+		Reader.SerializeIntPacked(NumEvents);
+
+		for (uint32 EventIndex = 0; EventIndex < NumEvents && !Reader.IsError(); ++EventIndex)
+		{
+			FPlaybackEvent& Event = OutStream.Events.AddDefaulted_GetRef();
+			uint8 Kind = 0;
+			uint32 Player = 0;
+			Reader << Kind;
+			Reader.SerializeIntPacked(Player);
+			Event.Player = static_cast<int32>(Player);
+
+			if (Kind == InputRecording::SpawnRecord)
+			{
+				FPlaybackSpawn& Spawn = OutStream.Spawns.AddDefaulted_GetRef();
+				FString VehicleClass;
+				FVector Location;
+				FQuat Rotation;
+				Reader << VehicleClass << Location << Rotation << Spawn.bDriver;
+				Spawn.VehicleClass = FSoftClassPath(VehicleClass);
+				Spawn.Transform = FTransform(Rotation, Location);
+				Event.Kind = Kind;
+				continue;
+			}
+
+			Event.Kind = Kind & ~InputRecording::PressedBit;
+			if (Event.Kind >= static_cast<uint8>(EVehicleInputAction::Num))
+			{
+				UE_LOG(LogMilitaryVehicle, Error, TEXT("Input: %s has an unknown action %d"), *Path, Event.Kind);
+				return false;
+			}
+
+			switch (InputRecording::GetValueType(static_cast<EVehicleInputAction>(Event.Kind)))
+			{
+			case InputRecording::EValueType::Bool:
+				Event.Value.X = (Kind & InputRecording::PressedBit) ? 1.0 : 0.0;
+				break;
+			case InputRecording::EValueType::Axis1D:
+			{
+				float Axis = 0.0f;
+				Reader << Axis;
+				Event.Value.X = Axis;
+				break;
+			}
+			case InputRecording::EValueType::Axis2D:
+			{
+				float X = 0.0f;
+				float Y = 0.0f;
+				Reader << X << Y;
+				Event.Value = FVector2D(X, Y);
+				break;
+			}
+			}
+		}
+
+		OutStream.FrameDeltas.Add(Delta);
+		OutStream.FrameServerTimes.Add(StartServerTime + ServerTimeOffset);
+		OutStream.FrameEventEnd.Add(OutStream.Events.Num());
+	}
+
+	if (Reader.IsError())
+	{
+		UE_LOG(LogMilitaryVehicle, Error, TEXT("Input: %s is truncated"), *Path);
+		return false;
+	}
+
+	UE_LOG(LogMilitaryVehicle, Log, TEXT("Input: loaded %s (%s), %d frames, %d players, %d actions"),
+		*Path, *MapName, OutStream.FrameDeltas.Num(), OutStream.Spawns.Num(), OutStream.Events.Num() - OutStream.Spawns.Num());
+	return true;
+}
+
+bool UInputRecordingSubsystem::StartPlayback(const TArray<FString>& Paths)
+{
+	UWorld* World = GetWorld();
+	if (bRecording || IsPlayingBack())
+	{
+		UE_LOG(LogMilitaryVehicle, Warning, TEXT("Input: already recording or playing back"));
+		return false;
+	}
+	if (!World || World->GetNetMode() == NM_Client)
+	{
+		UE_LOG(LogMilitaryVehicle, Warning, TEXT("Input: playback spawns vehicles and can only run on the server"));
+		return false;
+	}
+
+	const FString MapName = GetCurrentMapName();
+	for (const FString& Path : Paths)
+	{
+		FPlaybackStream Stream;
+		if (!LoadStream(Path, MapName, Stream))
+		{
+			Streams.Empty();
+			return false;
+		}
+		if (Stream.FrameDeltas.Num() > 0)
+		{
+			Streams.Add(MoveTemp(Stream));
+		}
+	}
+
+	if (Streams.Num() == 0)
+	{
+		UE_LOG(LogMilitaryVehicle, Warning, TEXT("Input: nothing to play back"));
+		return false;
+	}
+
+	// The stream that started recording first times the frames until it ends
+	ClockStream = 0;
+	for (int32 Index = 1; Index < Streams.Num(); ++Index)
+	{
+		if (Streams[Index].FrameServerTimes[0] < Streams[ClockStream].FrameServerTimes[0])
+		{
+			ClockStream = Index;
+		}
+	}
+	PlaybackStartTime = Streams[ClockStream].FrameServerTimes[0];
+
+	// Every following frame runs at the recorded delta; the first takes effect with the next frame
+	SeedRandom(Streams[0].Seed);
+	PlaybackTime = 0.0;
+	bPreviousUseFixedTimeStep = FApp::UseFixedTimeStep();
+	PreviousFixedDeltaTime = FApp::GetFixedDeltaTime();
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(Streams[ClockStream].FrameDeltas[0]);
+
+	UE_LOG(LogMilitaryVehicle, Log, TEXT("Input: playing back %d streams with seed %d"), Streams.Num(), Streams[0].Seed);
+	return true;
+}
+
+void UInputRecordingSubsystem::StopPlayback()
+{
+	if (!IsPlayingBack())
+	{
+		return;
+	}
+
+	Streams.Empty();
+	FApp::SetUseFixedTimeStep(bPreviousUseFixedTimeStep);
+	FApp::SetFixedDeltaTime(PreviousFixedDeltaTime);
+	UE_LOG(LogMilitaryVehicle, Log, TEXT("Input: playback finished after %.2fs"), PlaybackTime);
+
+	if (bExitWhenDone)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void UInputRecordingSubsystem::HandleWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World != GetWorld())
+	{
+		return;
+	}
+
+	if (bRecording)
+	{
+		// Actions handled from here on belong to this frame
+		FlushRecordedFrame();
+		FrameDelta = DeltaSeconds;
+		FrameServerTime = GetServerWorldTime();
+	}
+
+	if (!IsPlayingBack())
+	{
+		return;
+	}
+
+	// The clock stream's frames line up exactly; the others dispatch every frame that ended by the same server time
+	const double FrameEnd = Streams[ClockStream].GetNextFrameEnd();
+	PlaybackTime = FrameEnd - PlaybackStartTime;
+	for (FPlaybackStream& Stream : Streams)
+	{
+		while (!Stream.IsDone() && Stream.GetNextFrameEnd() <= FrameEnd)
+		{
+			DispatchFrame(Stream);
+		}
+	}
+}
+
+bool UInputRecordingSubsystem::SelectClockStream()
+{
+	if (!Streams[ClockStream].IsDone())
+	{
+		return true;
+	}
+
+	int32 NextClock = INDEX_NONE;
+	for (int32 Index = 0; Index < Streams.Num(); ++Index)
+	{
+		if (!Streams[Index].IsDone() && (NextClock == INDEX_NONE || Streams[Index].GetNextFrameEnd() < Streams[NextClock].GetNextFrameEnd()))
+		{
+			NextClock = Index;
+		}
+	}
+
+	if (NextClock == INDEX_NONE)
+	{
+		return false;
+	}
+	ClockStream = NextClock;
+	return true;
+}
+
+void UInputRecordingSubsystem::HandlePostTickFlush()
+{
+	if (!IsPlayingBack())
+	{
+		return;
+	}
+
+	if (!SelectClockStream())
+	{
+		StopPlayback();
+		return;
+	}
+	const FPlaybackStream& Clock = Streams[ClockStream];
+	FApp::SetFixedDeltaTime(Clock.FrameDeltas[Clock.NextFrame]);
+}
+
+void UInputRecordingSubsystem::DispatchFrame(FPlaybackStream& Stream)
+{
+	const int32 FirstEvent = Stream.NextFrame > 0 ? Stream.FrameEventEnd[Stream.NextFrame - 1] : 0;
+	const int32 EndEvent = Stream.FrameEventEnd[Stream.NextFrame];
+	++Stream.NextFrame;
+
+	for (int32 EventIndex = FirstEvent; EventIndex < EndEvent; ++EventIndex)
+	{
+		const FPlaybackEvent& Event = Stream.Events[EventIndex];
+		if (Event.Kind == InputRecording::SpawnRecord)
+		{
+			Stream.Vehicles.SetNum(FMath::Max(Stream.Vehicles.Num(), Event.Player + 1));
+			Stream.Vehicles[Event.Player] = SpawnPlaybackVehicle(Stream.Spawns[Stream.NextSpawn++]);
+			continue;
+		}
+
+		AMilitaryVehicleBase* Vehicle = Stream.Vehicles.IsValidIndex(Event.Player) ? Stream.Vehicles[Event.Player].Get() : nullptr;
+		if (Vehicle)
+		{
+			const EVehicleInputAction Action = static_cast<EVehicleInputAction>(Event.Kind);
+			Vehicle->ApplyRecordedInput(Action, InputRecording::MakeValue(Action, Event.Value));
+		}
+	}
+}
+
+AMilitaryVehicleBase* UInputRecordingSubsystem::SpawnPlaybackVehicle(const FPlaybackSpawn& Spawn)
+{
+	UWorld* World = GetWorld();
+	UClass* VehicleClass = Spawn.VehicleClass.TryLoadClass<AMilitaryVehicleBase>();
+	if (!VehicleClass)
+	{
+		UE_LOG(LogMilitaryVehicle, Warning, TEXT("Input: vehicle class %s not found, skipping its player"), *Spawn.VehicleClass.ToString());
+		return nullptr;
+	}
+
+	FActorSpawnParameters VehicleParams;
+	VehicleParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+	AMilitaryVehicleBase* Vehicle = World->SpawnActor<AMilitaryVehicleBase>(VehicleClass, Spawn.Transform, VehicleParams);
+	if (!Vehicle)
+	{
+		return nullptr;
+	}
+
+	// A plain AI controller: it gives the vehicle a controller without driving it, and is never recorded itself
+	FActorSpawnParameters ControllerParams;
+	ControllerParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AAIController* Controller = World->SpawnActor<AAIController>(ControllerParams);
+	if (Spawn.bDriver)
+	{
+		Vehicle->PossessAsDriver(Controller);
+	}
+	else
+	{
+		Vehicle->PossessAsGunner(Controller);
+	}
+
+	PlaybackVehicles.Add(Vehicle);
+	return Vehicle;
+}
+
+void UInputRecordingSubsystem::ClearPlaybackVehicles()
+{
+	for (const TWeakObjectPtr<AMilitaryVehicleBase>& VehiclePtr : PlaybackVehicles)
+	{
+		AMilitaryVehicleBase* Vehicle = VehiclePtr.Get();
+		if (!Vehicle)
+		{
+			continue;
+		}
+
+		if (AController* Controller = Vehicle->GetController())
+		{
+			Controller->UnPossess();
+			Controller->Destroy();
+		}
+		Vehicle->Destroy();
+	}
+	PlaybackVehicles.Empty();
+}
@@ -0,0 +1,160 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "InputRecordingSubsystem.generated.h"
+
+class AMilitaryVehicleBase;
+struct FInputActionValue;
+
+/** Vehicle input handlers the recorder captures and replays, see AMilitaryVehicleBase::ApplyRecordedInput. */
+enum class EVehicleInputAction : uint8
+{
+	Throttle,
+	Steer,
+	Brake,
+	Handbrake,
+	Look,
+	LookWithMouse,
+	Fire,
+	FireReleased,
+	ToggleRole,
+	Num
+};
+
+/**
+ * Records the Enhanced Input actions of every locally player-controlled vehicle into a compact binary stream, and
+ * plays such streams back headless through the same vehicle handlers, without any players connected.
+ *
+ * A stream starts with the RNG seed, which both recording and playback apply through FMath::RandInit and SRandInit,
+ * the map and the server world time recording started at. Then comes one entry per frame: its delta time, the server
+ * world time it started at and the actions handled during it. A vehicle enters the stream with
+ * its class, transform and role at its first recorded action. Playback spawns a vehicle for each one, possessed by a
+ * plain AI controller. It steps the engine at the recorded frame times with a fixed time step and calls each action
+ * on the frame it was recorded in. The inputs and frame timing are reproduced exactly; physics and anything
+ * replicated from other machines are only as deterministic as the engine makes them.
+ *
+ * Clients record their own players. To replay a multiplayer session, pass each client's stream to one playback,
+ * which lines them up on their server times, so players act in the same order and at the same intervals as they
+ * did in the session. The seed comes from the first stream. Frame timing follows the stream that started recording
+ * first, then whichever is still playing. Streams recorded on another map are rejected.
+ *
+ * Console: mvs.Input.Record [path], mvs.Input.Play <path> [path...], mvs.Input.Stop
+ * Command line: -InputRecord[=<path>] (default Saved/Input/Input-<timestamp>.mvsinput) records from begin play;
+ *               -InputPlayback=<path>[+<path>...] plays back from begin play and exits when the streams end.
+ */
+UCLASS()
+class MILITARYVEHICLESIM_API UInputRecordingSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	/** Starts a new stream, to be written to Path when recording stops. */
+	bool StartRecording(const FString& Path = FString());
+	void StopRecording();
+	bool IsRecording() const { return bRecording; }
+
+	/** Adds an action handled by a locally player-controlled vehicle to the current frame. */
+	void RecordInput(const AMilitaryVehicleBase* Vehicle, EVehicleInputAction Action, const FInputActionValue& Value);
+
+	/** Loads the streams and starts playing them back from the next frame. Server or standalone only. */
+	bool StartPlayback(const TArray<FString>& Paths);
+	void StopPlayback();
+	bool IsPlayingBack() const { return Streams.Num() > 0; }
+
+	/** Recorded seconds played back so far, counted from the earliest stream's start. */
+	double GetPlaybackTime() const { return PlaybackTime; }
+
+	/** Destroys the vehicles playback spawned, and their controllers. They are left in the world when playback ends. */
+	void ClearPlaybackVehicles();
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	struct FPlaybackSpawn
+	{
+		FSoftClassPath VehicleClass;
+		FTransform Transform;
+		bool bDriver = true;
+	};
+
+	struct FPlaybackEvent
+	{
+		int32 Player = 0;
+		/** An EVehicleInputAction, or InputRecording::SpawnRecord. */
+		uint8 Kind = 0;
+		FVector2D Value = FVector2D::ZeroVector;
+	};
+
+	/** One stream file; frame N's events are Events[FrameEventEnd[N - 1], FrameEventEnd[N]). */
+	struct FPlaybackStream
+	{
+		FString Path;
+		int32 Seed = 0;
+		TArray<float> FrameDeltas;
+		/** Server world time each frame started at. */
+		TArray<double> FrameServerTimes;
+		TArray<int32> FrameEventEnd;
+		TArray<FPlaybackEvent> Events;
+		TArray<FPlaybackSpawn> Spawns;
+
+		int32 NextFrame = 0;
+		int32 NextSpawn = 0;
+		TArray<TWeakObjectPtr<AMilitaryVehicleBase>> Vehicles;
+
+		bool IsDone() const { return NextFrame >= FrameDeltas.Num(); }
+
+		/** Server world time the next frame ends at. */
+		double GetNextFrameEnd() const { return FrameServerTimes[NextFrame] + FrameDeltas[NextFrame]; }
+	};
+
+	void HandleWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	void HandlePostTickFlush();
+
+	void FlushRecordedFrame();
+	int32 FindOrAddRecordedPlayer(const AMilitaryVehicleBase* Vehicle);
+
+	/** Loads a stream recorded on MapName. */
+	static bool LoadStream(const FString& Path, const FString& MapName, FPlaybackStream& OutStream);
+	void DispatchFrame(FPlaybackStream& Stream);
+
+	/** Picks the unfinished stream whose next frame ends first to time the frames; false when all have finished. */
+	bool SelectClockStream();
+
+	/** GameState's server world time, or the local world time without one. */
+	double GetServerWorldTime() const;
+	FString GetCurrentMapName() const;
+	AMilitaryVehicleBase* SpawnPlaybackVehicle(const FPlaybackSpawn& Spawn);
+	static void SeedRandom(int32 Seed);
+
+	// Recording
+	bool bRecording = false;
+	FString RecordPath;
+	TArray<uint8> RecordBuffer;
+	TArray<uint8> FrameEventBytes;
+	int32 FrameEventCount = 0;
+	float FrameDelta = 0.0f;
+	double FrameServerTime = 0.0;
+	double RecordStartServerTime = 0.0;
+	TMap<TObjectKey<AMilitaryVehicleBase>, int32> RecordedPlayers;
+
+	// Playback; frame timing follows Streams[ClockStream], all streams run on server time from PlaybackStartTime
+	TArray<FPlaybackStream> Streams;
+	int32 ClockStream = 0;
+	double PlaybackStartTime = 0.0;
+	double PlaybackTime = 0.0;
+	bool bExitWhenDone = false;
+	bool bPreviousUseFixedTimeStep = false;
+	double PreviousFixedDeltaTime = 0.0;
+	TArray<TWeakObjectPtr<AMilitaryVehicleBase>> PlaybackVehicles;
+
+	FDelegateHandle TickStartHandle;
+	FDelegateHandle PostTickFlushHandle;
+};
@@ -0,0 +1,688 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PerfScenarioSubsystem.h"
+
+#include "Dom/JsonObject.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/MemoryBase.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/AutomationTest.h"
+#include "Serialization/JsonSerializer.h"
+#include "Tests/AutomationCommon.h"
+#include "MilitaryVehicleSim/MilitaryVehicleSim.h"
+#include "MilitaryVehicleSim/AI/VehicleBotSubsystem.h"
+#include "MilitaryVehicleSim/Diagnostics/InputRecordingSubsystem.h"
+#include "MilitaryVehicleSim/Components/DamageReceiverRegistry.h"
+#include "MilitaryVehicleSim/Components/HealthComponent.h"
+#include "MilitaryVehicleSim/Vehicles/MilitaryVehicleBase.h"
+
+static FAutoConsoleCommandWithWorldAndArgs RunPerfScenariosCommand(
+	TEXT("mvs.Perf.Run"),
+	TEXT("Runs the configured performance scenarios and writes the results to Saved/Perf. Optional arg: scenario name or wildcard."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UPerfScenarioSubsystem* Perf = World ? World->GetSubsystem<UPerfScenarioSubsystem>() : nullptr)
+		{
+			Perf->RunScenarios(Args.Num() > 0 ? FName(*Args[0]) : NAME_None);
+		}
+	}));
+
+namespace
+{
+	float Mean(const TArray<float>& Values)
+	{
+		double Sum = 0.0;
+		for (const float Value : Values)
+		{
+			Sum += Value;
+		}
+		return Values.Num() > 0 ? static_cast<float>(Sum / Values.Num()) : 0.0f;
+	}
+
+	/** Nearest-rank percentile of values already sorted. */
+	float SortedPercentile(const TArray<float>& Values, float Fraction)
+	{
+		return Values.Num() > 0 ? Values[FMath::Clamp(FMath::CeilToInt(Values.Num() * Fraction) - 1, 0, Values.Num() - 1)] : 0.0f;
+	}
+
+	/** Nearest-rank 99th percentile; sorts the values in place. */
+	float Percentile99(TArray<float>& Values)
+	{
+		Values.Sort();
+		return SortedPercentile(Values, 0.99f);
+	}
+}
+
+namespace PerfHistogram
+{
+	/** Upper bucket edges in milliseconds; a last bucket takes everything above. Fixed so runs can be diffed bucket by bucket. */
+	static constexpr float EdgesMs[] = { 0.25f, 0.5f, 1.0f, 2.0f, 3.0f, 4.0f, 6.0f, 8.0f, 11.1f, 16.7f, 25.0f, 33.3f, 50.0f, 100.0f };
+	static constexpr int32 NumEdges = UE_ARRAY_COUNT(EdgesMs);
+	static constexpr int32 NumBuckets = NumEdges + 1;
+
+	int32 GetBucket(float ValueMs)
+	{
+		int32 Bucket = 0;
+		while (Bucket < NumEdges && ValueMs > EdgesMs[Bucket])
+		{
+			++Bucket;
+		}
+		return Bucket;
+	}
+}
+
+bool UPerfScenarioSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UPerfScenarioSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	FString OnlyScenario;
+	if (FParse::Value(FCommandLine::Get(), TEXT("PerfTest="), OnlyScenario) || FParse::Param(FCommandLine::Get(), TEXT("PerfTest")))
+	{
+		bExitWhenDone = true;
+		RunScenarios(OnlyScenario.IsEmpty() ? NAME_None : FName(*OnlyScenario));
+	}
+}
+
+void UPerfScenarioSubsystem::Deinitialize()
+{
+	PhysicsStartMarker.UnRegisterTickFunction();
+	PhysicsEndMarker.UnRegisterTickFunction();
+
+	FWorldDelegates::OnWorldTickStart.Remove(TickStartHandle);
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	if (UWorld* World = GetWorld())
+	{
+		World->OnPostTickDispatch().Remove(PostTickDispatchHandle);
+		World->OnPostTickFlush().Remove(PostTickFlushHandle);
+	}
+
+	Super::Deinitialize();
+}
+
+void UPerfScenarioSubsystem::RunScenarios(FName OnlyScenario, bool bInAppendResults)
+{
+	if (IsRunning())
+	{
+		UE_LOG(LogMilitaryVehicle, Warning, TEXT("Perf: scenarios already running"));
+		return;
+	}
+
+	UWorld* World = GetWorld();
+	if (!World || World->GetNetMode() == NM_Client)
+	{
+		UE_LOG(LogMilitaryVehicle, Warning, TEXT("Perf: scenarios spawn vehicles and can only run on the server"));
+		return;
+	}
+
+	QueuedScenarios.Reset();
+	for (int32 Index = 0; Index < Scenarios.Num(); ++Index)
+	{
+		if (OnlyScenario.IsNone() || Scenarios[Index].Name.ToString().MatchesWildcard(OnlyScenario.ToString()))
+		{
+			QueuedScenarios.Add(Index);
+		}
+	}
+
+	// Nothing ran, so nothing was over budget either; exit with its own status so scripts can tell the two apart
+	if (QueuedScenarios.Num() == 0)
+	{
+		UE_LOG(LogMilitaryVehicle, Error, TEXT("Perf: no scenarios matched %s"), *OnlyScenario.ToString());
+		if (bExitWhenDone)
+		{
+			FPlatformMisc::RequestExitWithStatus(false, 2);
+		}
+		return;
+	}
+
+	if (!FParse::Value(FCommandLine::Get(), TEXT("PerfJson="), JsonPath))
+	{
+		JsonPath = FPaths::ProjectSavedDir() / TEXT("Perf") / FString::Printf(TEXT("Perf-%s.json"), *FDateTime::Now().ToString());
+	}
+	FParse::Value(FCommandLine::Get(), TEXT("PerfLabel="), Label);
+	bAppendResults = bInAppendResults;
+	Results.Reset();
+
+	BaselineScenarios.Reset();
+	FString BaselinePath;
+	if (FParse::Value(FCommandLine::Get(), TEXT("PerfBaseline="), BaselinePath))
+	{
+		FString BaselineJson;
+		TSharedPtr<FJsonObject> Baseline;
+		const TArray<TSharedPtr<FJsonValue>>* BaselineValues = nullptr;
+		if (FFileHelper::LoadFileToString(BaselineJson, *BaselinePath)
+			&& FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(BaselineJson), Baseline) && Baseline.IsValid()
+			&& Baseline->TryGetArrayField(TEXT("scenarios"), BaselineValues))
+		{
+			for (const TSharedPtr<FJsonValue>& Value : *BaselineValues)
+			{
+				const TSharedPtr<FJsonObject> Object = Value->AsObject();
+				FString Name;
+				if (Object.IsValid() && Object->TryGetStringField(TEXT("name"), Name))
+				{
+					BaselineScenarios.Add(Name, Object);
+				}
+			}
+			UE_LOG(LogMilitaryVehicle, Log, TEXT("Perf: comparing against %d baseline scenarios from %s"), BaselineScenarios.Num(), *BaselinePath);
+		}
+		else
+		{
+			UE_LOG(LogMilitaryVehicle, Warning, TEXT("Perf: could not read baseline %s, running without it"), *BaselinePath);
+		}
+	}
+
+	if (!PhysicsStartMarker.IsTickFunctionRegistered())
+	{
+		PhysicsStartMarker.Register(World->PersistentLevel, TG_StartPhysics, &PhysicsStartTime);
+		PhysicsEndMarker.Register(World->PersistentLevel, TG_PostPhysics, &PhysicsEndTime);
+		TickStartHandle = FWorldDelegates::OnWorldTickStart.AddUObject(this, &UPerfScenarioSubsystem::HandleWorldTickStart);
+		PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UPerfScenarioSubsystem::HandlePostActorTick);
+		PostTickDispatchHandle = World->OnPostTickDispatch().AddUObject(this, &UPerfScenarioSubsystem::HandlePostTickDispatch);
+		PostTickFlushHandle = World->OnPostTickFlush().AddUObject(this, &UPerfScenarioSubsystem::HandlePostTickFlush);
+	}
+
+	StartScenario(QueuedScenarios[0]);
+}
+
+const TArray<FString>* UPerfScenarioSubsystem::FindFailures(FName Scenario) const
+{
+	const FScenarioResult* Result = Results.FindByPredicate([Scenario](const FScenarioResult& Candidate) { return Candidate.Name == Scenario; });
+	return Result ? &Result->Failures : nullptr;
+}
+
+void UPerfScenarioSubsystem::StartScenario(int32 Index)
+{
+	CurrentScenario = Index;
+	const FPerfScenario& Scenario = Scenarios[Index];
+
+	UVehicleBotSubsystem* Bots = GetWorld()->GetSubsystem<UVehicleBotSubsystem>();
+	Bots->ClearBots();
+
+	Samples.Reset();
+	Samples.Reserve(FMath::CeilToInt(Scenario.SampleSeconds * 120.0f));
+
+	const double Now = FPlatformTime::Seconds();
+	SampleStartTime = Now + Scenario.WarmupSeconds;
+	SampleEndTime = SampleStartTime + Scenario.SampleSeconds;
+
+	if (Scenario.Load == EPerfScenarioLoad::Replay)
+	{
+		TArray<FString> Paths;
+		for (const FString& Stream : Scenario.InputStreams)
+		{
+			Paths.Add(FPaths::IsRelative(Stream) ? FPaths::ProjectDir() / Stream : Stream);
+		}
+
+		// Replays end with their streams; one that cannot start ends straight away with no frames
+		UInputRecordingSubsystem* Recorder = GetWorld()->GetSubsystem<UInputRecordingSubsystem>();
+		SampleEndTime = Recorder && Recorder->StartPlayback(Paths) ? DBL_MAX : Now;
+		UE_LOG(LogMilitaryVehicle, Log, TEXT("Perf: running %s, replaying %d streams"), *Scenario.Name.ToString(), Paths.Num());
+		return;
+	}
+
+	const int32 NumSpawned = Bots->SpawnBots(Scenario.NumVehicles, Scenario.Load == EPerfScenarioLoad::SustainedFire ? TEXT("gunner") : TEXT("driver"));
+	if (NumSpawned < Scenario.NumVehicles)
+	{
+		UE_LOG(LogMilitaryVehicle, Warning, TEXT("Perf: %s spawned only %d of %d vehicles"), *Scenario.Name.ToString(), NumSpawned, Scenario.NumVehicles);
+	}
+
+	UE_LOG(LogMilitaryVehicle, Log, TEXT("Perf: running %s with %d vehicles"), *Scenario.Name.ToString(), NumSpawned);
+}
+
+void UPerfScenarioSubsystem::ApplyScenarioLoad(const FPerfScenario& Scenario)
+{
+	if (Scenario.Load == EPerfScenarioLoad::SustainedFire)
+	{
+		for (const AMilitaryVehicleBotController* Bot : GetWorld()->GetSubsystem<UVehicleBotSubsystem>()->GetBots())
+		{
+			if (AMilitaryVehicleBase* Vehicle = Bot ? Cast<AMilitaryVehicleBase>(Bot->GetPawn()) : nullptr)
+			{
+				Vehicle->FireWeapon();
+			}
+		}
+	}
+	else if (Scenario.Load == EPerfScenarioLoad::MassDamage)
+	{
+		if (const UDamageReceiverRegistry* Registry = GetWorld()->GetSubsystem<UDamageReceiverRegistry>())
+		{
+			// No copy, which would count against the allocations being measured. A vehicle destroyed on death
+			// unregisters by swapping the last entry into its slot, so walk backwards over entries already visited.
+			const TArray<TObjectPtr<UHealthComponent>>& Targets = Registry->GetHealthComponents();
+			for (int32 Index = Targets.Num() - 1; Index >= 0; --Index)
+			{
+				if (Targets.IsValidIndex(Index) && Targets[Index])
+				{
+					Targets[Index]->ApplyDamage(Scenario.DamagePerFrame, nullptr);
+				}
+			}
+		}
+	}
+}
+
+void UPerfScenarioSubsystem::HandleWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World != GetWorld() || !IsRunning())
+	{
+		return;
+	}
+
+	TickStartTime = FPlatformTime::Seconds();
+	PostDispatchTime = PhysicsStartTime = PhysicsEndTime = PostActorTickTime = TickStartTime;
+	TickStartAllocations = GetTotalAllocations();
+
+	ApplyScenarioLoad(Scenarios[CurrentScenario]);
+}
+
+void UPerfScenarioSubsystem::HandlePostTickDispatch()
+{
+	PostDispatchTime = FPlatformTime::Seconds();
+}
+
+void UPerfScenarioSubsystem::HandlePostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World == GetWorld())
+	{
+		PostActorTickTime = FPlatformTime::Seconds();
+	}
+}
+
+void UPerfScenarioSubsystem::HandlePostTickFlush()
+{
+	if (!IsRunning())
+	{
+		return;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	const FPerfScenario& Scenario = Scenarios[CurrentScenario];
+	const UInputRecordingSubsystem* Recorder = GetWorld()->GetSubsystem<UInputRecordingSubsystem>();
+	const bool bReplay = Scenario.Load == EPerfScenarioLoad::Replay;
+
+	// Replays step at the recorded frame times as fast as they can, so their warmup is recorded time rather than ours
+	const bool bWarmedUp = bReplay ? Recorder && Recorder->GetPlaybackTime() >= Scenario.WarmupSeconds : Now >= SampleStartTime;
+	if (bWarmedUp)
+	{
+		FFrameSample& Sample = Samples.AddDefaulted_GetRef();
+		Sample.GameThreadMs = static_cast<float>((Now - TickStartTime) * 1000.0);
+		Sample.PhysicsMs = static_cast<float>(FMath::Max(0.0, PhysicsEndTime - PhysicsStartTime) * 1000.0);
+		Sample.NetMs = static_cast<float>(((PostDispatchTime - TickStartTime) + (Now - PostActorTickTime)) * 1000.0);
+		Sample.GameMs = FMath::Max(0.0f, Sample.GameThreadMs - Sample.PhysicsMs - Sample.NetMs);
+		Sample.Allocations = GetTotalAllocations() - TickStartAllocations;
+	}
+
+	if (Now >= SampleEndTime || (bReplay && !(Recorder && Recorder->IsPlayingBack())))
+	{
+		FinishScenario();
+	}
+}
+
+void UPerfScenarioSubsystem::FinishScenario()
+{
+	const FScenarioResult& Result = Results.Add_GetRef(Summarize(Scenarios[CurrentScenario]));
+	UE_LOG(LogMilitaryVehicle, Log, TEXT("Perf: %s %s - game thread %.2f/%.2f ms, physics %.2f/%.2f ms, allocations %.0f/%.0f (mean/p99, %d frames)"),
+		*Result.Name.ToString(), Result.Failures.Num() == 0 ? TEXT("passed") : TEXT("FAILED"), Result.GameThreadMeanMs, Result.GameThreadP99Ms,
+		Result.PhysicsMeanMs, Result.PhysicsP99Ms, Result.AllocationsMean, Result.AllocationsP99, Result.NumFrames);
+	for (const FString& Failure : Result.Failures)
+	{
+		UE_LOG(LogMilitaryVehicle, Error, TEXT("Perf: %s %s"), *Result.Name.ToString(), *Failure);
+	}
+
+	GetWorld()->GetSubsystem<UVehicleBotSubsystem>()->ClearBots();
+	if (UInputRecordingSubsystem* Recorder = GetWorld()->GetSubsystem<UInputRecordingSubsystem>())
+	{
+		Recorder->StopPlayback();
+		Recorder->ClearPlaybackVehicles();
+	}
+
+	QueuedScenarios.RemoveAt(0);
+	if (QueuedScenarios.Num() > 0)
+	{
+		StartScenario(QueuedScenarios[0]);
+	}
+	else
+	{
+		FinishRun();
+	}
+}
+
+void UPerfScenarioSubsystem::FinishRun()
+{
+	CurrentScenario = INDEX_NONE;
+	WriteResults();
+
+	bool bPassed = Results.Num() > 0;
+	for (const FScenarioResult& Result : Results)
+	{
+		bPassed &= Result.Failures.Num() == 0;
+	}
+
+	if (bExitWhenDone)
+	{
+		UE_LOG(LogMilitaryVehicle, Log, TEXT("Perf: %s, requesting exit"), bPassed ? TEXT("all budgets met") : TEXT("budgets exceeded"));
+		FPlatformMisc::RequestExitWithStatus(false, bPassed ? 0 : 1);
+	}
+}
+
+UPerfScenarioSubsystem::FScenarioResult UPerfScenarioSubsystem::Summarize(const FPerfScenario& Scenario) const
+{
+	TArray<float> GameThreadMs;
+	TArray<float> GameMs;
+	TArray<float> PhysicsMs;
+	TArray<float> NetMs;
+	TArray<float> Allocations;
+	GameThreadMs.Reserve(Samples.Num());
+	GameMs.Reserve(Samples.Num());
+	PhysicsMs.Reserve(Samples.Num());
+	NetMs.Reserve(Samples.Num());
+	Allocations.Reserve(Samples.Num());
+	for (const FFrameSample& Sample : Samples)
+	{
+		GameThreadMs.Add(Sample.GameThreadMs);
+		GameMs.Add(Sample.GameMs);
+		PhysicsMs.Add(Sample.PhysicsMs);
+		NetMs.Add(Sample.NetMs);
+		Allocations.Add(static_cast<float>(Sample.Allocations));
+	}
+
+	FScenarioResult Result;
+	Result.Name = Scenario.Name;
+	Result.NumVehicles = Scenario.NumVehicles;
+	Result.NumFrames = Samples.Num();
+	Result.GameThreadMeanMs = Mean(GameThreadMs);
+	Result.GameThreadP99Ms = Percentile99(GameThreadMs);
+	Result.PhysicsMeanMs = Mean(PhysicsMs);
+	Result.PhysicsP99Ms = Percentile99(PhysicsMs);
+	Result.AllocationsMean = Mean(Allocations);
+	Result.AllocationsP99 = Percentile99(Allocations);
+	Result.Game = SummarizeTiming(GameMs);
+	Result.Physics = SummarizeTiming(PhysicsMs);
+	Result.Net = SummarizeTiming(NetMs);
+
+	const UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	Result.bNetworked = NetDriver && NetDriver->ClientConnections.Num() > 0;
+
+	if (Result.NumFrames == 0)
+	{
+		Result.Failures.Add(TEXT("recorded no frames"));
+	}
+	if (Scenario.GameThreadP99BudgetMs > 0.0f && Result.GameThreadP99Ms > Scenario.GameThreadP99BudgetMs)
+	{
+		Result.Failures.Add(FString::Printf(TEXT("game thread p99 %.2f ms over budget %.2f ms"), Result.GameThreadP99Ms, Scenario.GameThreadP99BudgetMs));
+	}
+	if (Scenario.PhysicsP99BudgetMs > 0.0f && Result.PhysicsP99Ms > Scenario.PhysicsP99BudgetMs)
+	{
+		Result.Failures.Add(FString::Printf(TEXT("physics p99 %.2f ms over budget %.2f ms"), Result.PhysicsP99Ms, Scenario.PhysicsP99BudgetMs));
+	}
+	if (Scenario.AllocationsPerFrameBudget > 0.0f && Result.AllocationsMean > Scenario.AllocationsPerFrameBudget)
+	{
+		Result.Failures.Add(FString::Printf(TEXT("%.0f allocations per frame over budget %.0f"), Result.AllocationsMean, Scenario.AllocationsPerFrameBudget));
+	}
+
+	CompareWithBaseline(Result);
+	return Result;
+}
+
+UPerfScenarioSubsystem::FTimingSummary UPerfScenarioSubsystem::SummarizeTiming(TArray<float>& ValuesMs)
+{
+	FTimingSummary Summary;
+	Summary.MeanMs = Mean(ValuesMs);
+	ValuesMs.Sort();
+	Summary.P50Ms = SortedPercentile(ValuesMs, 0.5f);
+	Summary.P90Ms = SortedPercentile(ValuesMs, 0.9f);
+	Summary.P99Ms = SortedPercentile(ValuesMs, 0.99f);
+
+	Summary.Histogram.SetNumZeroed(PerfHistogram::NumBuckets);
+	for (const float Value : ValuesMs)
+	{
+		++Summary.Histogram[PerfHistogram::GetBucket(Value)];
+	}
+	return Summary;
+}
+
+void UPerfScenarioSubsystem::CompareWithBaseline(FScenarioResult& Result) const
+{
+	const TSharedPtr<FJsonObject>* Baseline = BaselineScenarios.Find(Result.Name.ToString());
+	if (!Baseline || Result.NumFrames == 0)
+	{
+		return;
+	}
+
+	// Standalone runs, like Scripts/RunPerfRegression.sh's, replicate nothing, so their net time is noise
+	bool bBaselineNetworked = false;
+	(*Baseline)->TryGetBoolField(TEXT("networked"), bBaselineNetworked);
+	const bool bCompareNet = Result.bNetworked && bBaselineNetworked;
+
+	const TPair<const TCHAR*, const FTimingSummary*> Timings[] = {
+		{ TEXT("game"), &Result.Game },
+		{ TEXT("physics"), &Result.Physics },
+		{ TEXT("net"), bCompareNet ? &Result.Net : nullptr },
+	};
+
+	for (const TPair<const TCHAR*, const FTimingSummary*>& Timing : Timings)
+	{
+		if (!Timing.Value)
+		{
+			continue;
+		}
+
+		const TPair<const TCHAR*, float> Percentiles[] = {
+			{ TEXT("p50"), Timing.Value->P50Ms },
+			{ TEXT("p90"), Timing.Value->P90Ms },
+			{ TEXT("p99"), Timing.Value->P99Ms },
+		};
+
+		for (const TPair<const TCHAR*, float>& Percentile : Percentiles)
+		{
+			// Baselines from before a timing was recorded simply have no field for it
+			double BaselineMs = 0.0;
+			if (!(*Baseline)->TryGetNumberField(FString::Printf(TEXT("%s_%s_ms"), Timing.Key, Percentile.Key), BaselineMs))
+			{
+				continue;
+			}
+
+			const double AllowedMs = BaselineMs * (1.0 + BaselineTolerancePercent / 100.0) + BaselineToleranceMs;
+			if (Percentile.Value > AllowedMs)
+			{
+				Result.Failures.Add(FString::Printf(TEXT("%s %s %.2f ms regressed from baseline %.2f ms (allowed %.2f ms)"),
+					Timing.Key, Percentile.Key, Percentile.Value, BaselineMs, AllowedMs));
+			}
+		}
+	}
+}
+
+void UPerfScenarioSubsystem::WriteResults() const
+{
+	if (Results.Num() == 0)
+	{
+		return;
+	}
+
+	TArray<TSharedPtr<FJsonValue>> ScenarioValues;
+	FString ExistingJson;
+	TSharedPtr<FJsonObject> Existing;
+	const TArray<TSharedPtr<FJsonValue>>* ExistingValues = nullptr;
+	if (bAppendResults && FFileHelper::LoadFileToString(ExistingJson, *JsonPath)
+		&& FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(ExistingJson), Existing) && Existing.IsValid()
+		&& Existing->TryGetArrayField(TEXT("scenarios"), ExistingValues))
+	{
+		for (const TSharedPtr<FJsonValue>& Value : *ExistingValues)
+		{
+			const TSharedPtr<FJsonObject> Object = Value->AsObject();
+			FString Name;
+			if (Object.IsValid() && Object->TryGetStringField(TEXT("name"), Name) && !FindFailures(FName(*Name)))
+			{
+				ScenarioValues.Add(Value);
+			}
+		}
+	}
+
+	for (const FScenarioResult& Result : Results)
+	{
+		const TSharedRef<FJsonObject> Object = MakeShared<FJsonObject>();
+		Object->SetStringField(TEXT("name"), Result.Name.ToString());
+		Object->SetBoolField(TEXT("passed"), Result.Failures.Num() == 0);
+		Object->SetNumberField(TEXT("vehicles"), Result.NumVehicles);
+		Object->SetNumberField(TEXT("frames"), Result.NumFrames);
+		Object->SetBoolField(TEXT("networked"), Result.bNetworked);
+		Object->SetNumberField(TEXT("game_thread_mean_ms"), Result.GameThreadMeanMs);
+		Object->SetNumberField(TEXT("game_thread_p99_ms"), Result.GameThreadP99Ms);
+		Object->SetNumberField(TEXT("physics_mean_ms"), Result.PhysicsMeanMs);
+		Object->SetNumberField(TEXT("physics_p99_ms"), Result.PhysicsP99Ms);
+		Object->SetNumberField(TEXT("allocations_mean"), Result.AllocationsMean);
+		Object->SetNumberField(TEXT("allocations_p99"), Result.AllocationsP99);
+
+		const TPair<const TCHAR*, const FTimingSummary*> Timings[] = {
+			{ TEXT("game"), &Result.Game },
+			{ TEXT("physics"), &Result.Physics },
+			{ TEXT("net"), &Result.Net },
+		};
+		for (const TPair<const TCHAR*, const FTimingSummary*>& Timing : Timings)
+		{
+			Object->SetNumberField(FString::Printf(TEXT("%s_mean_ms"), Timing.Key), Timing.Value->MeanMs);
+			Object->SetNumberField(FString::Printf(TEXT("%s_p50_ms"), Timing.Key), Timing.Value->P50Ms);
+			Object->SetNumberField(FString::Printf(TEXT("%s_p90_ms"), Timing.Key), Timing.Value->P90Ms);
+			Object->SetNumberField(FString::Printf(TEXT("%s_p99_ms"), Timing.Key), Timing.Value->P99Ms);
+
+			TArray<TSharedPtr<FJsonValue>> Histogram;
+			for (const int32 Count : Timing.Value->Histogram)
+			{
+				Histogram.Add(MakeShared<FJsonValueNumber>(Count));
+			}
+			Object->SetArrayField(FString::Printf(TEXT("%s_histogram"), Timing.Key), Histogram);
+		}
+
+		TArray<TSharedPtr<FJsonValue>> Failures;
+		for (const FString& Failure : Result.Failures)
+		{
+			Failures.Add(MakeShared<FJsonValueString>(Failure));
+		}
+		Object->SetArrayField(TEXT("failures"), Failures);
+		ScenarioValues.Add(MakeShared<FJsonValueObject>(Object));
+	}
+
+	const TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+	Root->SetStringField(TEXT("label"), Label);
+	Root->SetStringField(TEXT("map"), GetWorld()->GetMapName());
+	Root->SetStringField(TEXT("timestamp"), FDateTime::UtcNow().ToIso8601());
+
+	TArray<TSharedPtr<FJsonValue>> HistogramEdges;
+	for (const float Edge : PerfHistogram::EdgesMs)
+	{
+		HistogramEdges.Add(MakeShared<FJsonValueNumber>(Edge));
+	}
+	Root->SetArrayField(TEXT("histogram_edges_ms"), HistogramEdges);
+	Root->SetArrayField(TEXT("scenarios"), ScenarioValues);
+
+	FString Json;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+	FJsonSerializer::Serialize(Root, Writer);
+
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(JsonPath), true);
+	FFileHelper::SaveStringToFile(Json, *JsonPath);
+	UE_LOG(LogMilitaryVehicle, Log, TEXT("Perf: wrote %d scenario results to %s"), ScenarioValues.Num(), *JsonPath);
+}
+
+int64 UPerfScenarioSubsystem::GetTotalAllocations()
+{
+#if UE_STATS
+	return static_cast<int64>(FMalloc::TotalMallocCalls) + static_cast<int64>(FMalloc::TotalReallocCalls);
+#else
+	// Allocation counters only exist in builds with stats; report zero rather than failing the budget
+	return 0;
+#endif
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	/** Runs one scenario on the loaded game world's perf subsystem and reports its failures to the test when it ends. */
+	class FRunPerfScenarioCommand : public IAutomationLatentCommand
+	{
+	public:
+		FRunPerfScenarioCommand(FName InScenario, FAutomationTestBase* InTest)
+			: Scenario(InScenario)
+			, Test(InTest)
+		{
+		}
+
+		virtual bool Update() override
+		{
+			UWorld* World = AutomationCommon::GetAnyGameWorld();
+			UPerfScenarioSubsystem* Perf = World ? World->GetSubsystem<UPerfScenarioSubsystem>() : nullptr;
+			if (!Perf)
+			{
+				Test->AddError(TEXT("No game world with a perf scenario subsystem"));
+				return true;
+			}
+
+			if (!bStarted)
+			{
+				bStarted = true;
+				Perf->RunScenarios(Scenario, true);
+				if (!Perf->IsRunning())
+				{
+					Test->AddError(FString::Printf(TEXT("Scenario %s did not start"), *Scenario.ToString()));
+					return true;
+				}
+				return false;
+			}
+
+			if (Perf->IsRunning())
+			{
+				return false;
+			}
+
+			if (const TArray<FString>* Failures = Perf->FindFailures(Scenario))
+			{
+				for (const FString& Failure : *Failures)
+				{
+					Test->AddError(Failure);
+				}
+			}
+			else
+			{
+				Test->AddError(FString::Printf(TEXT("Scenario %s produced no result"), *Scenario.ToString()));
+			}
+			return true;
+		}
+
+	private:
+		FName Scenario;
+		FAutomationTestBase* Test;
+		bool bStarted = false;
+	};
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FPerfScenarioTest, "MilitaryVehicleSim.Perf",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+void FPerfScenarioTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	for (const FPerfScenario& Scenario : GetDefault<UPerfScenarioSubsystem>()->GetScenarios())
+	{
+		OutBeautifiedNames.Add(Scenario.Name.ToString());
+		OutTestCommands.Add(Scenario.Name.ToString());
+	}
+}
+
+bool FPerfScenarioTest::RunTest(const FString& Parameters)
+{
+	// Every scenario gets a freshly loaded map, so vehicles and projectiles left by the one before don't load it
+	AutomationOpenMap(TEXT("/Game/NewMap"), true);
+	ADD_LATENT_AUTOMATION_COMMAND(FRunPerfScenarioCommand(FName(*Parameters), this));
+	return true;
+}
+
+#endif
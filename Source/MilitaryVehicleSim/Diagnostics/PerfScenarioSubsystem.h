@@ -0,0 +1,202 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MilitaryVehicleSim/Diagnostics/PhysicsTimingMarker.h"
+#include "PerfScenarioSubsystem.generated.h"
+
+UENUM()
+enum class EPerfScenarioLoad : uint8
+{
+	/** Vehicles driven by bots, no firing. */
+	Drive,
+	/** Gunner bots firing through the fire ability every frame; the ability cooldown limits the rate. */
+	SustainedFire,
+	/** Driving vehicles all damaged through UHealthComponent every frame. */
+	MassDamage,
+	/** Recorded sessions played back through UInputRecordingSubsystem instead of bots; ends with the streams. */
+	Replay,
+};
+
+/** One performance scenario and its pass/fail budgets. Zero disables a budget. */
+USTRUCT()
+struct FPerfScenario
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Config)
+	FName Name;
+
+	UPROPERTY(Config)
+	int32 NumVehicles = 50;
+
+	UPROPERTY(Config)
+	EPerfScenarioLoad Load = EPerfScenarioLoad::Drive;
+
+	/** Seconds to let spawning and physics settle before sampling. Replays count recorded time instead. */
+	UPROPERTY(Config)
+	float WarmupSeconds = 3.0f;
+
+	/** Unused by replays, which sample until their streams end. */
+	UPROPERTY(Config)
+	float SampleSeconds = 10.0f;
+
+	/** Input streams a Replay plays together, relative to the project directory. */
+	UPROPERTY(Config)
+	TArray<FString> InputStreams;
+
+	/** Damage applied to every vehicle per frame in MassDamage. */
+	UPROPERTY(Config)
+	float DamagePerFrame = 0.01f;
+
+	UPROPERTY(Config)
+	float GameThreadP99BudgetMs = 0.0f;
+
+	UPROPERTY(Config)
+	float PhysicsP99BudgetMs = 0.0f;
+
+	UPROPERTY(Config)
+	float AllocationsPerFrameBudget = 0.0f;
+};
+
+/**
+ * Runs the scenarios in [/Script/MilitaryVehicleSim.PerfScenarioSubsystem] one after another on the current map,
+ * spawning vehicles through UVehicleBotSubsystem or replaying recorded sessions. Each records game thread time,
+ * split into net receive, game, physics and net send, and allocations per frame. The results keep means,
+ * percentiles and histograms of those timings. They are checked against the scenario budgets and, when given a
+ * baseline from an earlier run, against the baseline's percentiles within the configured tolerances. Net timings
+ * are only compared when both runs had client connections; without any they measure nothing but the tick overhead. All results
+ * go to one JSON file, which can serve as the next baseline. Each scenario is also an automation test,
+ * MilitaryVehicleSim.Perf.<scenario>, that opens NewMap, runs it and fails on its budget failures. Headless runs go
+ * through Scripts/RunPerfTests.sh, which runs those tests, and Scripts/RunPerfRegression.sh; both fail when any budget
+ * is exceeded or any timing regressed.
+ *
+ * Console: mvs.Perf.Run [scenario or wildcard]
+ * Automation: Automation RunTests MilitaryVehicleSim.Perf[.<scenario>]
+ * Command line: -PerfTest[=<scenario or wildcard>] -PerfJson=<path> (default Saved/Perf/Perf-<timestamp>.json)
+ *               -PerfLabel=<text> to tag the results, e.g. with the commit. Exits when done, with code 1 on failure
+ *               and 2 when no scenario matched.
+ *               -PerfBaseline=<path> to a results JSON to compare against, by scenario name.
+ */
+UCLASS(Config = Game)
+class MILITARYVEHICLESIM_API UPerfScenarioSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	/**
+	 * Queues every scenario, or only the named one, and starts running. With bAppendResults the results are merged into
+	 * the JSON file already at the output path, replacing scenarios of the same name, so separate runs fill one file.
+	 */
+	void RunScenarios(FName OnlyScenario = NAME_None, bool bAppendResults = false);
+
+	bool IsRunning() const { return CurrentScenario != INDEX_NONE; }
+
+	const TArray<FPerfScenario>& GetScenarios() const { return Scenarios; }
+
+	/** Budget and baseline failures of the named scenario in the last run, or null when it produced no result. */
+	const TArray<FString>* FindFailures(FName Scenario) const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	UPROPERTY(Config)
+	TArray<FPerfScenario> Scenarios;
+
+	/** A baseline percentile regresses when exceeded by more than this fraction of it plus BaselineToleranceMs. */
+	UPROPERTY(Config)
+	float BaselineTolerancePercent = 10.0f;
+
+	UPROPERTY(Config)
+	float BaselineToleranceMs = 0.25f;
+
+private:
+	struct FFrameSample
+	{
+		float GameThreadMs = 0.0f;
+		float GameMs = 0.0f;
+		float PhysicsMs = 0.0f;
+		float NetMs = 0.0f;
+		int64 Allocations = 0;
+	};
+
+	/** Distribution of one per-frame timing; Histogram counts frames per bucket of PerfHistogram::EdgesMs. */
+	struct FTimingSummary
+	{
+		float MeanMs = 0.0f;
+		float P50Ms = 0.0f;
+		float P90Ms = 0.0f;
+		float P99Ms = 0.0f;
+		TArray<int32> Histogram;
+	};
+
+	struct FScenarioResult
+	{
+		FName Name;
+		int32 NumVehicles = 0;
+		int32 NumFrames = 0;
+		float GameThreadMeanMs = 0.0f;
+		float GameThreadP99Ms = 0.0f;
+		float PhysicsMeanMs = 0.0f;
+		float PhysicsP99Ms = 0.0f;
+		float AllocationsMean = 0.0f;
+		float AllocationsP99 = 0.0f;
+		FTimingSummary Game;
+		FTimingSummary Physics;
+		FTimingSummary Net;
+		/** Whether the world had client connections, without which Net times no replication. */
+		bool bNetworked = false;
+		TArray<FString> Failures;
+	};
+
+	void StartScenario(int32 Index);
+	void FinishScenario();
+	void FinishRun();
+	void ApplyScenarioLoad(const FPerfScenario& Scenario);
+	FScenarioResult Summarize(const FPerfScenario& Scenario) const;
+	static FTimingSummary SummarizeTiming(TArray<float>& ValuesMs);
+	void CompareWithBaseline(FScenarioResult& Result) const;
+	void WriteResults() const;
+
+	void HandleWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	void HandlePostTickDispatch();
+	void HandlePostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	void HandlePostTickFlush();
+
+	static int64 GetTotalAllocations();
+
+	TArray<int32> QueuedScenarios;
+	int32 CurrentScenario = INDEX_NONE;
+	double SampleStartTime = 0.0;
+	double SampleEndTime = 0.0;
+
+	TArray<FFrameSample> Samples;
+	TArray<FScenarioResult> Results;
+
+	FPhysicsTimingMarkerTickFunction PhysicsStartMarker;
+	FPhysicsTimingMarkerTickFunction PhysicsEndMarker;
+	double TickStartTime = 0.0;
+	double PostDispatchTime = 0.0;
+	double PhysicsStartTime = 0.0;
+	double PhysicsEndTime = 0.0;
+	double PostActorTickTime = 0.0;
+	int64 TickStartAllocations = 0;
+
+	bool bExitWhenDone = false;
+	bool bAppendResults = false;
+	FString JsonPath;
+	FString Label;
+
+	/** Scenarios of the -PerfBaseline results, by name. */
+	TMap<FString, TSharedPtr<class FJsonObject>> BaselineScenarios;
+
+	FDelegateHandle TickStartHandle;
+	FDelegateHandle PostTickDispatchHandle;
+	FDelegateHandle PostActorTickHandle;
+	FDelegateHandle PostTickFlushHandle;
+};
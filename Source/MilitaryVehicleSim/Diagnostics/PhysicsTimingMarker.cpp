@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PhysicsTimingMarker.h"
+
+#include "HAL/PlatformTime.h"
+
+void FPhysicsTimingMarkerTickFunction::Register(ULevel* Level, ETickingGroup Group, double* InTimestamp)
+{
+	Timestamp = InTimestamp;
+	TickGroup = Group;
+	bTickEvenWhenPaused = true;
+	RegisterTickFunction(Level);
+}
+
+void FPhysicsTimingMarkerTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread,
+	const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Timestamp)
+	{
+		*Timestamp = FPlatformTime::Seconds();
+	}
+}
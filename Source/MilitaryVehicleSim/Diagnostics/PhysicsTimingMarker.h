@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+
+class ULevel;
+
+/**
+ * Tick function placed in a physics tick group that timestamps the frame for the diagnostics recorders.
+ * One in TG_StartPhysics and one in TG_PostPhysics bracket the physics step without touching the vehicles.
+ */
+struct FPhysicsTimingMarkerTickFunction : public FTickFunction
+{
+	/** Receives FPlatformTime::Seconds() each time the marker runs. */
+	double* Timestamp = nullptr;
+
+	void Register(ULevel* Level, ETickingGroup Group, double* InTimestamp);
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override { return TEXT("PhysicsTimingMarker"); }
+};
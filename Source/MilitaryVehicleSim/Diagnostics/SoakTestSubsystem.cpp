@@ -0,0 +1,191 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SoakTestSubsystem.h"
+
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "MilitaryVehicleSim/MilitaryVehicleSim.h"
+
+bool USoakTestSubsystem::IsSoakTestRequested()
+{
+	return FParse::Param(FCommandLine::Get(), TEXT("SoakTest"));
+}
+
+bool USoakTestSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return IsRunningDedicatedServer() && IsSoakTestRequested() && Super::ShouldCreateSubsystem(Outer);
+}
+
+bool USoakTestSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game;
+}
+
+void USoakTestSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UWorld* World = GetWorld();
+	TickStartHandle = FWorldDelegates::OnWorldTickStart.AddUObject(this, &USoakTestSubsystem::HandleWorldTickStart);
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &USoakTestSubsystem::HandlePostActorTick);
+	PostTickDispatchHandle = World->OnPostTickDispatch().AddUObject(this, &USoakTestSubsystem::HandlePostTickDispatch);
+	PostTickFlushHandle = World->OnPostTickFlush().AddUObject(this, &USoakTestSubsystem::HandlePostTickFlush);
+
+	if (!FParse::Value(FCommandLine::Get(), TEXT("SoakCsv="), CsvPath))
+	{
+		CsvPath = FPaths::ProjectSavedDir() / TEXT("Soak") / FString::Printf(TEXT("Soak-%s.csv"), *FDateTime::Now().ToString());
+	}
+}
+
+void USoakTestSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	float Duration = 300.0f;
+	float Warmup = 10.0f;
+	FParse::Value(FCommandLine::Get(), TEXT("SoakDuration="), Duration);
+	FParse::Value(FCommandLine::Get(), TEXT("SoakWarmup="), Warmup);
+
+	const double Now = FPlatformTime::Seconds();
+	RecordStartTime = Now + Warmup;
+	EndTime = RecordStartTime + Duration;
+
+	// Physics runs between these tick groups; the markers bracket it without touching the vehicles
+	PhysicsStartMarker.Register(InWorld.PersistentLevel, TG_StartPhysics, &PhysicsStartTime);
+	PhysicsEndMarker.Register(InWorld.PersistentLevel, TG_PostPhysics, &PhysicsEndTime);
+
+	UE_LOG(LogMilitaryVehicle, Log, TEXT("Soak test: recording %.0fs after %.0fs warmup to %s"), Duration, Warmup, *CsvPath);
+}
+
+void USoakTestSubsystem::Deinitialize()
+{
+	WriteReport();
+
+	PhysicsStartMarker.UnRegisterTickFunction();
+	PhysicsEndMarker.UnRegisterTickFunction();
+
+	FWorldDelegates::OnWorldTickStart.Remove(TickStartHandle);
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	if (UWorld* World = GetWorld())
+	{
+		World->OnPostTickDispatch().Remove(PostTickDispatchHandle);
+		World->OnPostTickFlush().Remove(PostTickFlushHandle);
+	}
+
+	Super::Deinitialize();
+}
+
+void USoakTestSubsystem::HandleWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World == GetWorld())
+	{
+		TickStartTime = FPlatformTime::Seconds();
+		PostDispatchTime = PhysicsStartTime = PhysicsEndTime = PostActorTickTime = TickStartTime;
+	}
+}
+
+void USoakTestSubsystem::HandlePostTickDispatch()
+{
+	PostDispatchTime = FPlatformTime::Seconds();
+}
+
+void USoakTestSubsystem::HandlePostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World == GetWorld())
+	{
+		PostActorTickTime = FPlatformTime::Seconds();
+	}
+}
+
+void USoakTestSubsystem::HandlePostTickFlush()
+{
+	const double Now = FPlatformTime::Seconds();
+	if (Now >= RecordStartTime && !bReportWritten)
+	{
+		RecordFrame();
+	}
+
+	if (Now >= EndTime && !bReportWritten)
+	{
+		WriteReport();
+		UE_LOG(LogMilitaryVehicle, Log, TEXT("Soak test: finished, requesting exit"));
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void USoakTestSubsystem::RecordFrame()
+{
+	const double Now = FPlatformTime::Seconds();
+	const double NetReceiveMs = (PostDispatchTime - TickStartTime) * 1000.0;
+	const double PhysicsMs = FMath::Max(0.0, PhysicsEndTime - PhysicsStartTime) * 1000.0;
+	const double GameMs = FMath::Max(0.0, (PostActorTickTime - PostDispatchTime) * 1000.0 - PhysicsMs);
+	const double NetSendMs = (Now - PostActorTickTime) * 1000.0;
+	const double TickMs = (Now - TickStartTime) * 1000.0;
+
+	int32 NumConnections = 0;
+	int64 TotalBytesOut = 0;
+	int64 MaxBytesOut = 0;
+	int32 TotalActorChannels = 0;
+
+	if (const UNetDriver* NetDriver = GetWorld()->GetNetDriver())
+	{
+		for (UNetConnection* Connection : NetDriver->ClientConnections)
+		{
+			if (!Connection)
+			{
+				continue;
+			}
+
+			// OutTotalBytes only grows, so the per-frame cost is the delta since the last sample
+			int64& LastBytes = LastOutTotalBytes.FindOrAdd(Connection, Connection->OutTotalBytes);
+			const int64 BytesOut = Connection->OutTotalBytes - LastBytes;
+			LastBytes = Connection->OutTotalBytes;
+
+			const int32 ActorChannels = Connection->ActorChannelsNum();
+
+			++NumConnections;
+			TotalBytesOut += BytesOut;
+			MaxBytesOut = FMath::Max(MaxBytesOut, BytesOut);
+			TotalActorChannels += ActorChannels;
+
+			ConnectionRows.Add(FString::Printf(TEXT("%llu,%s,%lld,%d"), FrameIndex, *Connection->LowLevelGetRemoteAddress(true), BytesOut, ActorChannels));
+		}
+	}
+
+	FrameRows.Add(FString::Printf(TEXT("%llu,%.4f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%d,%lld,%.1f,%lld,%d,%.1f"),
+		FrameIndex, Now - RecordStartTime, FApp::GetDeltaTime() * 1000.0, TickMs, NetReceiveMs, GameMs, PhysicsMs, NetSendMs,
+		NumConnections, TotalBytesOut, NumConnections > 0 ? static_cast<double>(TotalBytesOut) / NumConnections : 0.0, MaxBytesOut,
+		TotalActorChannels, NumConnections > 0 ? static_cast<double>(TotalActorChannels) / NumConnections : 0.0));
+
+	++FrameIndex;
+}
+
+void USoakTestSubsystem::WriteReport()
+{
+	if (bReportWritten || FrameRows.Num() == 0)
+	{
+		return;
+	}
+	bReportWritten = true;
+
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(CsvPath), true);
+
+	FString FrameCsv = TEXT("frame,time_s,frame_ms,server_tick_ms,net_receive_ms,game_ms,physics_ms,net_send_ms,connections,")
+		TEXT("bytes_out,bytes_out_per_connection,bytes_out_max_connection,actor_channels,actor_channels_per_connection\n");
+	FrameCsv += FString::Join(FrameRows, TEXT("\n"));
+	FFileHelper::SaveStringToFile(FrameCsv, *CsvPath);
+
+	const FString ConnectionCsvPath = FPaths::GetPath(CsvPath) / FPaths::GetBaseFilename(CsvPath) + TEXT("_connections.csv");
+	FString ConnectionCsv = TEXT("frame,connection,bytes_out,actor_channels\n");
+	ConnectionCsv += FString::Join(ConnectionRows, TEXT("\n"));
+	FFileHelper::SaveStringToFile(ConnectionCsv, *ConnectionCsvPath);
+
+	UE_LOG(LogMilitaryVehicle, Log, TEXT("Soak test: wrote %d frames to %s"), FrameRows.Num(), *CsvPath);
+}
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MilitaryVehicleSim/Diagnostics/PhysicsTimingMarker.h"
+#include "SoakTestSubsystem.generated.h"
+
+class UNetConnection;
+
+/**
+ * Server-side soak recorder, enabled with -SoakTest on a dedicated server (see Scripts/RunSoakTest.sh).
+ * Records one CSV row per server frame with the tick split into net receive, game (actors, tickables),
+ * physics and net send, plus outgoing bytes and actor channels over all client connections. Per-connection
+ * rows go to a second CSV next to it. The server exits after -SoakDuration seconds (default 300).
+ *
+ * Options: -SoakDuration=<seconds> -SoakCsv=<path> (default Saved/Soak/Soak-<timestamp>.csv)
+ *          -SoakWarmup=<seconds> (default 10) to skip frames recorded while clients are still joining
+ */
+UCLASS()
+class MILITARYVEHICLESIM_API USoakTestSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	static bool IsSoakTestRequested();
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	void HandleWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	void HandlePostTickDispatch();
+	void HandlePostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	void HandlePostTickFlush();
+
+	void RecordFrame();
+	void WriteReport();
+
+	FPhysicsTimingMarkerTickFunction PhysicsStartMarker;
+	FPhysicsTimingMarkerTickFunction PhysicsEndMarker;
+
+	// Timestamps of the current frame, in seconds
+	double TickStartTime = 0.0;
+	double PostDispatchTime = 0.0;
+	double PhysicsStartTime = 0.0;
+	double PhysicsEndTime = 0.0;
+	double PostActorTickTime = 0.0;
+
+	double RecordStartTime = 0.0;
+	double EndTime = 0.0;
+	uint64 FrameIndex = 0;
+
+	TMap<TWeakObjectPtr<UNetConnection>, int64> LastOutTotalBytes;
+
+	FString CsvPath;
+	TArray<FString> FrameRows;
+	TArray<FString> ConnectionRows;
+	bool bReportWritten = false;
+
+	FDelegateHandle TickStartHandle;
+	FDelegateHandle PostActorTickHandle;
+	FDelegateHandle PostTickDispatchHandle;
+	FDelegateHandle PostTickFlushHandle;
+};
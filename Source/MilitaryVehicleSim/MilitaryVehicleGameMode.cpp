@@ -3,51 +3,174 @@
 
 #include "MilitaryVehicleGameMode.h"
 #include "GameFramework/PlayerStart.h"
-#include "Kismet/GameplayStatics.h"
 #include "Engine/World.h"
+#include "EngineUtils.h"
+#include "TimerManager.h"
+#include "MilitaryVehicleSim/Components/DamageReceiverRegistry.h"
+#include "MilitaryVehicleSim/Components/HealthComponent.h"
+#include "MilitaryVehicleSim/MilitaryVehicleSim.h"
+#include "MilitaryVehicleSim/Vehicles/MilitaryVehicleBase.h"
 
-AActor* AMilitaryVehicleGameMode::ChoosePlayerStart_Implementation(AController* Player)
+DECLARE_CYCLE_STAT(TEXT("GameMode ChoosePlayerStart"), STAT_MVS_ChoosePlayerStart, STATGROUP_MilitaryVehicle);
+
+AMilitaryVehicleGameMode::AMilitaryVehicleGameMode()
 {
-	TArray<AActor*> PlayerStarts;
-	UGameplayStatics::GetAllActorsOfClass(GetWorld(), APlayerStart::StaticClass(), PlayerStarts);
+	// Increased radius to 500.0f as vehicles are larger than standard pawns
+	PlayerStartClearance = 500.0f;
+	OccupancyRefreshInterval = 0.5f;
+	SafeSpawnDistance = 5000.0f;
+	RecentUseWindow = 10.0f;
 
-	TArray<AActor*> UnoccupiedStarts;
-	TArray<AActor*> OccupiedStarts;
+	bPlayerStartsCached = false;
+	VehicleDistanceFrame = 0;
+}
 
-	for (AActor* Start : PlayerStarts)
+TSubclassOf<AMilitaryVehicleBase> AMilitaryVehicleGameMode::GetBotVehicleClass() const
+{
+	if (BotVehicleClass)
 	{
-		APlayerStart* PlayerStart = Cast<APlayerStart>(Start);
-		if (PlayerStart)
-		{
-			FVector StartLocation = PlayerStart->GetActorLocation();
-			FRotator StartRotation = PlayerStart->GetActorRotation();
+		return BotVehicleClass;
+	}
+	return DefaultPawnClass && DefaultPawnClass->IsChildOf<AMilitaryVehicleBase>() ? TSubclassOf<AMilitaryVehicleBase>(DefaultPawnClass) : nullptr;
+}
+
+void AMilitaryVehicleGameMode::StartPlay()
+{
+	Super::StartPlay();
 
-			// Check if any pawn or vehicle is overlapping this start location
-			FCollisionObjectQueryParams ObjectParams;
-			ObjectParams.AddObjectTypesToQuery(ECC_Pawn);
-			ObjectParams.AddObjectTypesToQuery(ECC_Vehicle);
+	CachePlayerStarts();
 
-			// Increased radius to 500.0f as vehicles are larger than standard pawns
-			if (!GetWorld()->OverlapAnyTestByObjectType(StartLocation, FQuat::Identity, ObjectParams, FCollisionShape::MakeSphere(500.0f)))
-			{
-				UnoccupiedStarts.Add(PlayerStart);
-			}
-			else
+	OccupancyDelegate.BindUObject(this, &AMilitaryVehicleGameMode::HandleOccupancyResult);
+	GetWorldTimerManager().SetTimer(OccupancyTimerHandle, this, &AMilitaryVehicleGameMode::RefreshOccupancy, OccupancyRefreshInterval, true, 0.0f);
+}
+
+void AMilitaryVehicleGameMode::CachePlayerStarts()
+{
+	PlayerStartSlots.Reset();
+	for (TActorIterator<APlayerStart> It(GetWorld()); It; ++It)
+	{
+		FPlayerStartSlot& Slot = PlayerStartSlots.AddDefaulted_GetRef();
+		Slot.Start = *It;
+		Slot.Location = It->GetActorLocation();
+	}
+	bPlayerStartsCached = true;
+}
+
+void AMilitaryVehicleGameMode::RefreshOccupancy()
+{
+	// Check if any pawn or vehicle is overlapping each start, without blocking the game thread on the results
+	FCollisionObjectQueryParams ObjectParams;
+	ObjectParams.AddObjectTypesToQuery(ECC_Pawn);
+	ObjectParams.AddObjectTypesToQuery(ECC_Vehicle);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	for (int32 Index = 0; Index < PlayerStartSlots.Num(); ++Index)
+	{
+		FPlayerStartSlot& Slot = PlayerStartSlots[Index];
+		Slot.QueryIssuedTime = Now;
+		GetWorld()->AsyncOverlapByObjectType(Slot.Location, FQuat::Identity, ObjectParams, FCollisionShape::MakeSphere(PlayerStartClearance),
+			FCollisionQueryParams::DefaultQueryParam, &OccupancyDelegate, Index);
+	}
+}
+
+void AMilitaryVehicleGameMode::HandleOccupancyResult(const FTraceHandle& TraceHandle, FOverlapDatum& OverlapData)
+{
+	if (!PlayerStartSlots.IsValidIndex(OverlapData.UserData))
+	{
+		return;
+	}
+
+	// A start handed out after this query was issued stays reserved until the next refresh sees its pawn
+	FPlayerStartSlot& Slot = PlayerStartSlots[OverlapData.UserData];
+	if (Slot.LastUsedTime < Slot.QueryIssuedTime)
+	{
+		Slot.bOccupied = OverlapData.OutOverlaps.Num() > 0;
+	}
+}
+
+void AMilitaryVehicleGameMode::UpdateVehicleDistances()
+{
+	if (VehicleDistanceFrame == GFrameCounter)
+	{
+		return;
+	}
+	VehicleDistanceFrame = GFrameCounter;
+
+	TArray<FVector, TInlineAllocator<64>> VehicleLocations;
+	if (const UDamageReceiverRegistry* Registry = GetWorld()->GetSubsystem<UDamageReceiverRegistry>())
+	{
+		for (const UHealthComponent* HealthComponent : Registry->GetHealthComponents())
+		{
+			if (HealthComponent->IsAlive() && HealthComponent->GetOwner()->IsA<AMilitaryVehicleBase>())
 			{
-				OccupiedStarts.Add(PlayerStart);
+				VehicleLocations.Add(HealthComponent->GetOwner()->GetActorLocation());
 			}
 		}
 	}
 
-	if (UnoccupiedStarts.Num() > 0)
+	for (FPlayerStartSlot& Slot : PlayerStartSlots)
+	{
+		double NearestDistSquared = FMath::Square(static_cast<double>(SafeSpawnDistance));
+		for (const FVector& VehicleLocation : VehicleLocations)
+		{
+			NearestDistSquared = FMath::Min(NearestDistSquared, FVector::DistSquared(Slot.Location, VehicleLocation));
+		}
+		Slot.NearestVehicleDistance = FMath::Sqrt(NearestDistSquared);
+	}
+}
+
+float AMilitaryVehicleGameMode::ScorePlayerStart(const FPlayerStartSlot& Slot, double Now) const
+{
+	const float DistanceScore = Slot.NearestVehicleDistance / SafeSpawnDistance;
+	const float RecentUsePenalty = RecentUseWindow > 0.0f ? FMath::Max(0.0f, 1.0f - static_cast<float>(Now - Slot.LastUsedTime) / RecentUseWindow) : 0.0f;
+
+	// Small jitter so equally good starts don't always resolve the same way
+	return DistanceScore - RecentUsePenalty + FMath::FRand() * 0.05f;
+}
+
+AActor* AMilitaryVehicleGameMode::ChoosePlayerStart_Implementation(AController* Player)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MVS_ChoosePlayerStart);
+
+	if (!bPlayerStartsCached)
+	{
+		CachePlayerStarts();
+	}
+
+	UpdateVehicleDistances();
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	FPlayerStartSlot* BestUnoccupied = nullptr;
+	FPlayerStartSlot* BestOccupied = nullptr;
+	float BestUnoccupiedScore = -FLT_MAX;
+	float BestOccupiedScore = -FLT_MAX;
+
+	for (FPlayerStartSlot& Slot : PlayerStartSlots)
 	{
-		// Return a random unoccupied start
-		return UnoccupiedStarts[FMath::RandRange(0, UnoccupiedStarts.Num() - 1)];
+		if (!Slot.Start.IsValid())
+		{
+			continue;
+		}
+
+		const float Score = ScorePlayerStart(Slot, Now);
+		if (!Slot.bOccupied && Score > BestUnoccupiedScore)
+		{
+			BestUnoccupied = &Slot;
+			BestUnoccupiedScore = Score;
+		}
+		else if (Slot.bOccupied && Score > BestOccupiedScore)
+		{
+			BestOccupied = &Slot;
+			BestOccupiedScore = Score;
+		}
 	}
-	else if (OccupiedStarts.Num() > 0)
+
+	// If all are occupied, just return the best occupied one (better than nothing)
+	if (FPlayerStartSlot* Chosen = BestUnoccupied ? BestUnoccupied : BestOccupied)
 	{
-		// If all are occupied, just return a random one (better than nothing)
-		return OccupiedStarts[FMath::RandRange(0, OccupiedStarts.Num() - 1)];
+		Chosen->bOccupied = true;
+		Chosen->LastUsedTime = Now;
+		return Chosen->Start.Get();
 	}
 
 	// Fallback to super implementation if no PlayerStarts found
@@ -4,10 +4,16 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameModeBase.h"
+#include "WorldCollision.h"
 #include "MilitaryVehicleGameMode.generated.h"
 
+class AMilitaryVehicleBase;
+class APlayerStart;
+
 /**
- * 
+ * Player starts are gathered once per level. Their occupancy is refreshed in the background with async
+ * overlaps and reserved as soon as a start is handed out, so a burst of joins in one frame needs no queries.
+ * Each choice scores every start by distance to live vehicles and how recently it was used.
  */
 UCLASS()
 class MILITARYVEHICLESIM_API AMilitaryVehicleGameMode : public AGameModeBase
@@ -15,5 +21,57 @@ class MILITARYVEHICLESIM_API AMilitaryVehicleGameMode : public AGameModeBase
 	GENERATED_BODY()
 	
 public:
+	AMilitaryVehicleGameMode();
+
+	virtual void StartPlay() override;
 	virtual AActor* ChoosePlayerStart_Implementation(AController* Player) override;
+
+	/** Vehicle spawned for load-test bots, falling back to the default pawn class. */
+	TSubclassOf<AMilitaryVehicleBase> GetBotVehicleClass() const;
+
+protected:
+	UPROPERTY(EditDefaultsOnly, Category = "Bots")
+	TSubclassOf<AMilitaryVehicleBase> BotVehicleClass;
+
+	/** Radius around a start that must be free of pawns and vehicles. */
+	UPROPERTY(EditDefaultsOnly, Category = "Spawning", meta = (ClampMin = "0.0"))
+	float PlayerStartClearance;
+
+	/** Seconds between background occupancy refreshes. */
+	UPROPERTY(EditDefaultsOnly, Category = "Spawning", meta = (ClampMin = "0.05"))
+	float OccupancyRefreshInterval;
+
+	/** Distance to the nearest vehicle beyond which a start counts as fully safe. */
+	UPROPERTY(EditDefaultsOnly, Category = "Spawning", meta = (ClampMin = "1.0"))
+	float SafeSpawnDistance;
+
+	/** Seconds after use during which a start is penalized, spreading bursts of spawns across starts. */
+	UPROPERTY(EditDefaultsOnly, Category = "Spawning", meta = (ClampMin = "0.0"))
+	float RecentUseWindow;
+
+private:
+	struct FPlayerStartSlot
+	{
+		TWeakObjectPtr<APlayerStart> Start;
+		FVector Location = FVector::ZeroVector;
+		bool bOccupied = false;
+		double LastUsedTime = -DBL_MAX;
+		double QueryIssuedTime = -DBL_MAX;
+		float NearestVehicleDistance = 0.0f;
+	};
+
+	void CachePlayerStarts();
+	void RefreshOccupancy();
+	void HandleOccupancyResult(const FTraceHandle& TraceHandle, FOverlapDatum& OverlapData);
+	void UpdateVehicleDistances();
+	float ScorePlayerStart(const FPlayerStartSlot& Slot, double Now) const;
+
+	TArray<FPlayerStartSlot> PlayerStartSlots;
+	bool bPlayerStartsCached;
+
+	/** Frame the vehicle distances were last gathered on, so a burst of joins shares one pass. */
+	uint64 VehicleDistanceFrame;
+
+	FTimerHandle OccupancyTimerHandle;
+	FOverlapDelegate OccupancyDelegate;
 };
@@ -3,4 +3,6 @@
 #include "MilitaryVehicleSim.h"
 #include "Modules/ModuleManager.h"
 
+DEFINE_LOG_CATEGORY(LogMilitaryVehicle);
+
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, MilitaryVehicleSim, "MilitaryVehicleSim" );
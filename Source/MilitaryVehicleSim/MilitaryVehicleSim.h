@@ -4,3 +4,10 @@
 
 #include "CoreMinimal.h"
 
+DECLARE_LOG_CATEGORY_EXTERN(LogMilitaryVehicle, Log, All);
+
+/** Combat pipeline scopes and counters, shown with "stat MilitaryVehicle". See Diagnostics/CombatStats.h. */
+DECLARE_STATS_GROUP(TEXT("MilitaryVehicle"), STATGROUP_MilitaryVehicle, STATCAT_Advanced);
+
+/** Object channel used by projectiles (see the "Projectile" collision profile). */
+#define ECC_Projectile ECC_GameTraceChannel1
@@ -0,0 +1,404 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LagCompensationSubsystem.h"
+
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/IConsoleManager.h"
+#include "MilitaryVehicleSim/Components/TurretComponent.h"
+#include "MilitaryVehicleSim/Projectiles/ProjectileBase.h"
+#include "MilitaryVehicleSim/Vehicles/MilitaryVehicleBase.h"
+
+static TAutoConsoleVariable<bool> CVarLagCompensationEnabled(
+	TEXT("mvs.LagCompensation.Enabled"),
+	true,
+	TEXT("Test vehicle hits against the poses the shooter was seeing instead of the current ones."));
+
+static TAutoConsoleVariable<float> CVarLagCompensationMaxRewindMs(
+	TEXT("mvs.LagCompensation.MaxRewindMs"),
+	300.0f,
+	TEXT("Maximum rewind window in milliseconds. Sizes the per-vehicle history, so it applies to vehicles registered after a change."));
+
+static TAutoConsoleVariable<float> CVarLagCompensationSampleRate(
+	TEXT("mvs.LagCompensation.SampleRate"),
+	60.0f,
+	TEXT("Vehicle poses recorded per second."));
+
+static TAutoConsoleVariable<float> CVarLagCompensationInterpDelayMs(
+	TEXT("mvs.LagCompensation.InterpDelayMs"),
+	50.0f,
+	TEXT("Client-side render delay of remote vehicles, added to half the round trip when rewinding."));
+
+namespace LagCompensation
+{
+	/** Intersects a world-space segment with a box given in the space of BoxToWorld. */
+	static bool SegmentHitsBox(const FTransform& BoxToWorld, const FBox& LocalBox, const FVector& Start, const FVector& End,
+		float& OutTime, FVector& OutLocation, FVector& OutNormal)
+	{
+		if (!LocalBox.IsValid)
+		{
+			return false;
+		}
+
+		const FVector LocalStart = BoxToWorld.InverseTransformPosition(Start);
+		const FVector LocalEnd = BoxToWorld.InverseTransformPosition(End);
+
+		FVector LocalHit;
+		FVector LocalNormal;
+		float HitTime = 0.0f;
+		if (!FMath::LineExtentBoxIntersection(LocalBox, LocalStart, LocalEnd, FVector::ZeroVector, LocalHit, LocalNormal, HitTime))
+		{
+			return false;
+		}
+
+		OutTime = HitTime;
+		OutLocation = BoxToWorld.TransformPosition(LocalHit);
+		OutNormal = BoxToWorld.TransformVectorNoScale(LocalNormal);
+		return true;
+	}
+}
+
+void FVehicleTransformHistory::Init(int32 Capacity)
+{
+	Samples.SetNum(FMath::Max(Capacity, 2));
+	Head = INDEX_NONE;
+	Count = 0;
+}
+
+void FVehicleTransformHistory::Record(double Time, const FTransform& HullTransform, float TurretYaw)
+{
+	Head = (Head + 1) % Samples.Num();
+	FVehicleTransformSample& Sample = Samples[Head];
+	Sample.Time = Time;
+	Sample.HullTransform = HullTransform;
+	Sample.TurretYaw = TurretYaw;
+	Count = FMath::Min(Count + 1, Samples.Num());
+}
+
+bool FVehicleTransformHistory::Rewind(double Time, FTransform& OutHullTransform, float& OutTurretYaw) const
+{
+	if (Count == 0)
+	{
+		return false;
+	}
+
+	const FVehicleTransformSample& Newest = GetByAge(0);
+	const FVehicleTransformSample& Oldest = GetByAge(Count - 1);
+	if (Time >= Newest.Time || Count == 1)
+	{
+		OutHullTransform = Newest.HullTransform;
+		OutTurretYaw = Newest.TurretYaw;
+		return true;
+	}
+	if (Time <= Oldest.Time)
+	{
+		OutHullTransform = Oldest.HullTransform;
+		OutTurretYaw = Oldest.TurretYaw;
+		return true;
+	}
+
+	// Find the youngest sample at or before Time; samples get older as age grows
+	int32 Low = 1;
+	int32 High = Count - 1;
+	while (Low < High)
+	{
+		const int32 Mid = (Low + High) / 2;
+		if (GetByAge(Mid).Time <= Time)
+		{
+			High = Mid;
+		}
+		else
+		{
+			Low = Mid + 1;
+		}
+	}
+
+	const FVehicleTransformSample& Older = GetByAge(Low);
+	const FVehicleTransformSample& Newer = GetByAge(Low - 1);
+	const double Span = Newer.Time - Older.Time;
+	const float Alpha = Span > UE_SMALL_NUMBER ? static_cast<float>((Time - Older.Time) / Span) : 1.0f;
+
+	OutHullTransform.Blend(Older.HullTransform, Newer.HullTransform, Alpha);
+	OutTurretYaw = Older.TurretYaw + FMath::FindDeltaAngleDegrees(Older.TurretYaw, Newer.TurretYaw) * Alpha;
+	return true;
+}
+
+bool ULagCompensationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void ULagCompensationSubsystem::Deinitialize()
+{
+	Histories.Empty();
+	TrackedProjectiles.Empty();
+	Super::Deinitialize();
+}
+
+TStatId ULagCompensationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULagCompensationSubsystem, STATGROUP_Tickables);
+}
+
+void ULagCompensationSubsystem::RegisterVehicle(AMilitaryVehicleBase* Vehicle)
+{
+	if (!Vehicle || !Vehicle->HasAuthority())
+	{
+		return;
+	}
+
+	const float MaxRewindSeconds = FMath::Max(0.0f, CVarLagCompensationMaxRewindMs.GetValueOnGameThread()) * 0.001f;
+	const float SampleRate = FMath::Max(1.0f, CVarLagCompensationSampleRate.GetValueOnGameThread());
+
+	FVehicleTransformHistory& History = Histories.AddDefaulted_GetRef();
+	History.Vehicle = Vehicle;
+	// Two extra slots so the oldest sample still brackets a full-window rewind
+	History.Init(FMath::CeilToInt(MaxRewindSeconds * SampleRate) + 2);
+
+	if (const USkeletalMeshComponent* Hull = Vehicle->GetMesh())
+	{
+		History.HullBounds = Hull->CalcBounds(FTransform::Identity).GetBox();
+	}
+	if (const UTurretComponent* Turret = Vehicle->GetTurretComponent())
+	{
+		History.TurretBounds = Turret->CalcBounds(FTransform::Identity).GetBox();
+		History.TurretRelativeTransform = Turret->GetRelativeTransform();
+	}
+}
+
+void ULagCompensationSubsystem::UnregisterVehicle(AMilitaryVehicleBase* Vehicle)
+{
+	const int32 Index = Histories.IndexOfByPredicate([Vehicle](const FVehicleTransformHistory& History)
+	{
+		return History.Vehicle.Get() == Vehicle;
+	});
+
+	if (Index != INDEX_NONE)
+	{
+		Histories.RemoveAtSwap(Index, 1, false);
+	}
+}
+
+float ULagCompensationSubsystem::GetRewindSeconds(const AActor* Shooter) const
+{
+	if (!CVarLagCompensationEnabled.GetValueOnGameThread())
+	{
+		return 0.0f;
+	}
+
+	const APawn* ShooterPawn = Cast<APawn>(Shooter);
+	const APlayerState* PlayerState = ShooterPawn ? ShooterPawn->GetPlayerState() : nullptr;
+	if (!PlayerState || PlayerState->IsABot() || ShooterPawn->IsLocallyControlled())
+	{
+		return 0.0f;
+	}
+
+	// Ping is a round trip; the shooter saw the world half a trip plus its render delay ago
+	const float RewindMs = PlayerState->GetPingInMilliseconds() * 0.5f + CVarLagCompensationInterpDelayMs.GetValueOnGameThread();
+	return FMath::Clamp(RewindMs, 0.0f, CVarLagCompensationMaxRewindMs.GetValueOnGameThread()) * 0.001f;
+}
+
+void ULagCompensationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	const UWorld* World = GetWorld();
+	if (!World || World->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	const double Now = World->GetTimeSeconds();
+	RecordVehicles(Now);
+	ValidateTrackedProjectiles(Now);
+}
+
+void ULagCompensationSubsystem::RecordVehicles(double Now)
+{
+	const float SampleInterval = 1.0f / FMath::Max(1.0f, CVarLagCompensationSampleRate.GetValueOnGameThread());
+	if (Now - LastRecordTime < SampleInterval)
+	{
+		return;
+	}
+
+	// Keep the cadence on the sample grid rather than drifting by each frame's overshoot; after a hitch, start it over
+	// from now instead of recording every frame to catch up
+	LastRecordTime += SampleInterval;
+	if (Now - LastRecordTime >= SampleInterval)
+	{
+		LastRecordTime = Now;
+	}
+
+	for (int32 Index = Histories.Num() - 1; Index >= 0; --Index)
+	{
+		FVehicleTransformHistory& History = Histories[Index];
+		const AMilitaryVehicleBase* Vehicle = History.Vehicle.Get();
+		if (!Vehicle)
+		{
+			Histories.RemoveAtSwap(Index, 1, false);
+			continue;
+		}
+
+		History.Record(Now, Vehicle->GetMesh()->GetComponentTransform(), Vehicle->TurretYaw);
+	}
+}
+
+void ULagCompensationSubsystem::RewindAllVehicles(double ViewTime)
+{
+	const int32 NumVehicles = Histories.Num();
+	RewoundHulls.SetNum(NumVehicles, false);
+	RewoundTurrets.SetNum(NumVehicles, false);
+	RewoundValid.SetNum(NumVehicles, false);
+
+	for (int32 Index = 0; Index < NumVehicles; ++Index)
+	{
+		const FVehicleTransformHistory& History = Histories[Index];
+
+		float TurretYaw = 0.0f;
+		RewoundValid[Index] = History.Vehicle.IsValid() && History.Rewind(ViewTime, RewoundHulls[Index], TurretYaw);
+		if (RewoundValid[Index])
+		{
+			FTransform TurretRelative = History.TurretRelativeTransform;
+			TurretRelative.SetRotation(FRotator(0.0f, TurretYaw, 0.0f).Quaternion());
+			RewoundTurrets[Index] = TurretRelative * RewoundHulls[Index];
+		}
+	}
+}
+
+void ULagCompensationSubsystem::ValidateShots(TConstArrayView<FLagCompensatedShot> Shots, TArray<FLagCompensatedHit>& OutHits)
+{
+	if (Shots.Num() == 0 || Histories.Num() == 0)
+	{
+		return;
+	}
+
+	// Sort by view time so shots seeing the same moment share one rewind
+	ShotOrder.Reset(Shots.Num());
+	for (int32 Index = 0; Index < Shots.Num(); ++Index)
+	{
+		ShotOrder.Add(Index);
+	}
+	ShotOrder.Sort([&Shots](int32 A, int32 B) { return Shots[A].ViewTime < Shots[B].ViewTime; });
+
+	const double RewindTolerance = 0.5 / FMath::Max(1.0f, CVarLagCompensationSampleRate.GetValueOnGameThread());
+	double RewoundTime = -DBL_MAX;
+
+	for (const int32 ShotIndex : ShotOrder)
+	{
+		const FLagCompensatedShot& Shot = Shots[ShotIndex];
+		if (FMath::Abs(Shot.ViewTime - RewoundTime) > RewindTolerance)
+		{
+			RewindAllVehicles(Shot.ViewTime);
+			RewoundTime = Shot.ViewTime;
+		}
+
+		FLagCompensatedHit BestHit;
+		int32 BestVehicleIndex = INDEX_NONE;
+		for (int32 VehicleIndex = 0; VehicleIndex < Histories.Num(); ++VehicleIndex)
+		{
+			AMilitaryVehicleBase* Vehicle = Histories[VehicleIndex].Vehicle.Get();
+			if (!RewoundValid[VehicleIndex] || Vehicle == Shot.Shooter)
+			{
+				continue;
+			}
+
+			float HitTime = 1.0f;
+			FVector HitLocation;
+			FVector HitNormal;
+			if (LagCompensation::SegmentHitsBox(RewoundHulls[VehicleIndex], Histories[VehicleIndex].HullBounds, Shot.Start, Shot.End, HitTime, HitLocation, HitNormal)
+				&& (BestHit.Vehicle == nullptr || HitTime < BestHit.Time))
+			{
+				BestHit = { ShotIndex, Vehicle, HitLocation, HitNormal, HitTime, false };
+				BestVehicleIndex = VehicleIndex;
+			}
+			if (LagCompensation::SegmentHitsBox(RewoundTurrets[VehicleIndex], Histories[VehicleIndex].TurretBounds, Shot.Start, Shot.End, HitTime, HitLocation, HitNormal)
+				&& (BestHit.Vehicle == nullptr || HitTime < BestHit.Time))
+			{
+				BestHit = { ShotIndex, Vehicle, HitLocation, HitNormal, HitTime, true };
+				BestVehicleIndex = VehicleIndex;
+			}
+		}
+
+		if (BestHit.Vehicle)
+		{
+			// Armor is resolved against the pose the shooter saw, not the vehicle's current one
+			const FTransform& Hull = RewoundHulls[BestVehicleIndex];
+			BestHit.ArmorHit.LocalLocation = Hull.InverseTransformPosition(BestHit.Location);
+			BestHit.ArmorHit.LocalDirection = Hull.InverseTransformVectorNoScale((Shot.End - Shot.Start).GetSafeNormal());
+			BestHit.ArmorHit.LocalNormal = Hull.InverseTransformVectorNoScale(BestHit.Normal);
+			BestHit.ArmorHit.bTurret = BestHit.bHitTurret;
+
+			OutHits.Add(BestHit);
+		}
+	}
+}
+
+void ULagCompensationSubsystem::TrackProjectile(AProjectileBase* Projectile, float RewindSeconds)
+{
+	if (Projectile)
+	{
+		TrackedProjectiles.Add({ Projectile, Projectile->GetActorLocation(), RewindSeconds });
+	}
+}
+
+void ULagCompensationSubsystem::UntrackProjectile(AProjectileBase* Projectile)
+{
+	const int32 Index = TrackedProjectiles.IndexOfByPredicate([Projectile](const FTrackedProjectile& Tracked)
+	{
+		return Tracked.Projectile.Get() == Projectile;
+	});
+
+	if (Index != INDEX_NONE)
+	{
+		TrackedProjectiles.RemoveAtSwap(Index, 1, false);
+	}
+}
+
+void ULagCompensationSubsystem::ValidateTrackedProjectiles(double Now)
+{
+	PendingShots.Reset();
+	for (int32 Index = TrackedProjectiles.Num() - 1; Index >= 0; --Index)
+	{
+		FTrackedProjectile& Tracked = TrackedProjectiles[Index];
+		const AProjectileBase* Projectile = Tracked.Projectile.Get();
+		if (!Projectile || !Projectile->IsInFlight())
+		{
+			TrackedProjectiles.RemoveAtSwap(Index, 1, false);
+		}
+	}
+
+	for (FTrackedProjectile& Tracked : TrackedProjectiles)
+	{
+		const AProjectileBase* Projectile = Tracked.Projectile.Get();
+		const FVector CurrentLocation = Projectile->GetActorLocation();
+		PendingShots.Add({ Tracked.LastLocation, CurrentLocation, Now - Tracked.RewindSeconds, Projectile->GetOwner() });
+		Tracked.LastLocation = CurrentLocation;
+	}
+
+	PendingHits.Reset();
+	ValidateShots(PendingShots, PendingHits);
+
+	// Resolve after the scan: impacts untrack their projectile and would reorder the array underneath us
+	struct FPendingImpact
+	{
+		TWeakObjectPtr<AProjectileBase> Projectile;
+		AMilitaryVehicleBase* Vehicle;
+		FVector Location;
+		FArmorHit ArmorHit;
+	};
+
+	TArray<FPendingImpact, TInlineAllocator<16>> Impacts;
+	for (const FLagCompensatedHit& Hit : PendingHits)
+	{
+		Impacts.Add({ TrackedProjectiles[Hit.ShotIndex].Projectile, Hit.Vehicle, Hit.Location, Hit.ArmorHit });
+	}
+	for (const FPendingImpact& Impact : Impacts)
+	{
+		if (AProjectileBase* Projectile = Impact.Projectile.Get())
+		{
+			Projectile->HandleLagCompensatedHit(Impact.Vehicle, Impact.Location, Impact.ArmorHit);
+		}
+	}
+}
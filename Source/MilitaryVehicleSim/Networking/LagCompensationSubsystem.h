@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MilitaryVehicleSim/Vehicles/VehicleArmorProfile.h"
+#include "LagCompensationSubsystem.generated.h"
+
+class AMilitaryVehicleBase;
+class AProjectileBase;
+
+/** One recorded pose of a vehicle. */
+struct FVehicleTransformSample
+{
+	double Time = 0.0;
+	FTransform HullTransform;
+	float TurretYaw = 0.0f;
+};
+
+/**
+ * Fixed-capacity ring buffer of vehicle poses plus the local boxes used to test shots against them.
+ * Storage is sized once on registration and never reallocated.
+ */
+struct FVehicleTransformHistory
+{
+	TWeakObjectPtr<AMilitaryVehicleBase> Vehicle;
+
+	FBox HullBounds = FBox(ForceInit);
+	FBox TurretBounds = FBox(ForceInit);
+	FTransform TurretRelativeTransform;
+
+	void Init(int32 Capacity);
+	void Record(double Time, const FTransform& HullTransform, float TurretYaw);
+
+	/** Interpolates the pose at the given time, clamped to the recorded window. */
+	bool Rewind(double Time, FTransform& OutHullTransform, float& OutTurretYaw) const;
+
+	double GetNewestTime() const { return Count > 0 ? GetByAge(0).Time : -DBL_MAX; }
+
+private:
+	/** Age 0 is the newest sample. */
+	const FVehicleTransformSample& GetByAge(int32 Age) const { return Samples[(Head - Age + Samples.Num()) % Samples.Num()]; }
+
+	TArray<FVehicleTransformSample> Samples;
+	int32 Head = INDEX_NONE;
+	int32 Count = 0;
+};
+
+/** A segment to test against vehicles as they were at ViewTime. */
+struct FLagCompensatedShot
+{
+	FVector Start = FVector::ZeroVector;
+	FVector End = FVector::ZeroVector;
+	double ViewTime = 0.0;
+	const AActor* Shooter = nullptr;
+};
+
+/** Nearest rewound vehicle hit along a shot's segment. */
+struct FLagCompensatedHit
+{
+	int32 ShotIndex = INDEX_NONE;
+	AMilitaryVehicleBase* Vehicle = nullptr;
+	FVector Location = FVector::ZeroVector;
+	FVector Normal = FVector::ZeroVector;
+	/** Fraction along the segment, comparable with FHitResult::Time. */
+	float Time = 1.0f;
+	bool bHitTurret = false;
+	/** The hit in hull mesh space at the rewound pose, for armor resolution. */
+	FArmorHit ArmorHit;
+};
+
+/**
+ * Server-side lag compensation for vehicle hits.
+ * Records hull and turret poses of every vehicle at a fixed rate and tests shots against
+ * the poses the shooter was seeing, rather than the current ones. Shots are validated in
+ * batches: all vehicles are rewound once per distinct view time, not once per shot.
+ */
+UCLASS()
+class MILITARYVEHICLESIM_API ULagCompensationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void RegisterVehicle(AMilitaryVehicleBase* Vehicle);
+	void UnregisterVehicle(AMilitaryVehicleBase* Vehicle);
+
+	/** How far back shots from this actor's controller should be tested. Zero when compensation is off or not needed. */
+	float GetRewindSeconds(const AActor* Shooter) const;
+
+	/** Tests every shot against rewound vehicles. Appends at most one (the nearest) hit per shot. */
+	void ValidateShots(TConstArrayView<FLagCompensatedShot> Shots, TArray<FLagCompensatedHit>& OutHits);
+
+	/** Tests the projectile's per-frame travel against rewound vehicles until it is untracked. */
+	void TrackProjectile(AProjectileBase* Projectile, float RewindSeconds);
+	void UntrackProjectile(AProjectileBase* Projectile);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	struct FTrackedProjectile
+	{
+		TWeakObjectPtr<AProjectileBase> Projectile;
+		FVector LastLocation;
+		float RewindSeconds;
+	};
+
+	void RecordVehicles(double Now);
+	void ValidateTrackedProjectiles(double Now);
+	void RewindAllVehicles(double ViewTime);
+
+	TArray<FVehicleTransformHistory> Histories;
+	TArray<FTrackedProjectile> TrackedProjectiles;
+	double LastRecordTime = -DBL_MAX;
+
+	// Scratch reused between frames
+	TArray<FTransform> RewoundHulls;
+	TArray<FTransform> RewoundTurrets;
+	TArray<bool> RewoundValid;
+	TArray<int32> ShotOrder;
+	TArray<FLagCompensatedShot> PendingShots;
+	TArray<FLagCompensatedHit> PendingHits;
+};
@@ -0,0 +1,214 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MilitaryVehicleReplicationGraph.h"
+
+#include "Engine/LevelScriptActor.h"
+#include "Engine/NetDriver.h"
+#include "GameFramework/Info.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "MilitaryVehicleSim/Projectiles/ProjectileBase.h"
+#include "MilitaryVehicleSim/Vehicles/MilitaryVehicleBase.h"
+#include "UObject/UObjectIterator.h"
+
+void UMilitaryVehicleReplicationGraphNode_AlwaysRelevant_ForConnection::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	ReplicationActorList.Reset();
+
+	for (const FNetViewer& Viewer : Params.Viewers)
+	{
+		ReplicationActorList.ConditionalAdd(Viewer.InViewer);
+		ReplicationActorList.ConditionalAdd(Viewer.ViewTarget);
+
+		if (const APlayerController* PlayerController = Viewer.InViewer)
+		{
+			ReplicationActorList.ConditionalAdd(PlayerController->GetPawn());
+		}
+	}
+
+	Params.OutGatheredReplicationLists.AddReplicationActorList(ReplicationActorList);
+}
+
+UMilitaryVehicleReplicationGraph::UMilitaryVehicleReplicationGraph()
+{
+	GridCellSize = 10000.0f;
+	GridSpatialBias = FVector2D(-200000.0f, -200000.0f);
+}
+
+void UMilitaryVehicleReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	// Routing for the classes that matter; everything else is derived from its CDO in GetMappingPolicy
+	ClassRepNodePolicies.Set(AMilitaryVehicleBase::StaticClass(), ERepNodeMapping::Spatialize_Dynamic);
+	ClassRepNodePolicies.Set(AProjectileBase::StaticClass(), ERepNodeMapping::Spatialize_Dormancy);
+	ClassRepNodePolicies.Set(AInfo::StaticClass(), ERepNodeMapping::RelevantAllConnections);
+	ClassRepNodePolicies.Set(ALevelScriptActor::StaticClass(), ERepNodeMapping::NotRouted);
+	ClassRepNodePolicies.Set(APlayerController::StaticClass(), ERepNodeMapping::NotRouted);
+
+	// Replicated projectile bits get their own row in CSV captures, for comparison with shot events
+	CSVTracker.SetExplicitClassTracking(AProjectileBase::StaticClass(), TEXT("Projectile"));
+
+	// Configured classes first, so their subclasses inherit the settings
+	TSet<UClass*> ConfiguredClasses;
+	for (const FMilitaryVehicleRepClassSettings& Settings : ClassSettings)
+	{
+		UClass* Class = Settings.ActorClass.TryLoadClass<AActor>();
+		if (!Class)
+		{
+			continue;
+		}
+
+		FClassReplicationInfo Info;
+		InitClassReplicationInfo(Info, GetDefault<AActor>(Class), Settings.CullDistance, Settings.NetUpdateFrequency);
+		GlobalActorReplicationInfoMap.SetClassInfo(Class, Info);
+		ConfiguredClasses.Add(Class);
+	}
+
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* Class = *It;
+		const AActor* ActorCDO = Cast<AActor>(Class->GetDefaultObject(false));
+		if (!ActorCDO || !ActorCDO->GetIsReplicated() || Class->HasAnyClassFlags(CLASS_Abstract | CLASS_Deprecated | CLASS_NewerVersionExists))
+		{
+			continue;
+		}
+
+		// Blueprint compile artifacts
+		if (Class->GetName().StartsWith(TEXT("SKEL_")) || Class->GetName().StartsWith(TEXT("REINST_")))
+		{
+			continue;
+		}
+
+		bool bConfigured = false;
+		for (const UClass* ConfiguredClass : ConfiguredClasses)
+		{
+			if (Class->IsChildOf(ConfiguredClass))
+			{
+				bConfigured = true;
+				break;
+			}
+		}
+
+		if (!bConfigured)
+		{
+			const ERepNodeMapping Mapping = GetMappingPolicy(Class);
+			const bool bSpatialized = Mapping == ERepNodeMapping::Spatialize_Static || Mapping == ERepNodeMapping::Spatialize_Dynamic
+				|| Mapping == ERepNodeMapping::Spatialize_Dormancy;
+
+			FClassReplicationInfo Info;
+			InitClassReplicationInfo(Info, ActorCDO, bSpatialized ? FMath::Sqrt(ActorCDO->NetCullDistanceSquared) : 0.0f, ActorCDO->NetUpdateFrequency);
+			GlobalActorReplicationInfoMap.SetClassInfo(Class, Info);
+		}
+	}
+}
+
+void UMilitaryVehicleReplicationGraph::InitClassReplicationInfo(FClassReplicationInfo& Info, const AActor* ActorCDO, float CullDistance,
+	float NetUpdateFrequency) const
+{
+	Info.SetCullDistanceSquared(FMath::Square(CullDistance));
+	Info.ReplicationPeriodFrame = GetReplicationPeriodFrame(NetUpdateFrequency);
+}
+
+uint32 UMilitaryVehicleReplicationGraph::GetReplicationPeriodFrame(float NetUpdateFrequency) const
+{
+	const float MaxTickRate = NetDriver ? static_cast<float>(NetDriver->GetNetServerMaxTickRate()) : 30.0f;
+	return FMath::Max<uint32>(static_cast<uint32>(FMath::RoundToFloat(MaxTickRate / FMath::Max(NetUpdateFrequency, 0.01f))), 1);
+}
+
+void UMilitaryVehicleReplicationGraph::SetActorNetUpdateFrequency(AActor* Actor, float NetUpdateFrequency)
+{
+	if (FGlobalActorReplicationInfo* Info = GlobalActorReplicationInfoMap.Find(Actor))
+	{
+		Info->Settings.ReplicationPeriodFrame = GetReplicationPeriodFrame(NetUpdateFrequency);
+	}
+}
+
+UMilitaryVehicleReplicationGraph::ERepNodeMapping UMilitaryVehicleReplicationGraph::GetMappingPolicy(UClass* Class)
+{
+	if (const ERepNodeMapping* Mapping = ClassRepNodePolicies.Get(Class))
+	{
+		return *Mapping;
+	}
+
+	const AActor* ActorCDO = GetDefault<AActor>(Class);
+	ERepNodeMapping Mapping = ERepNodeMapping::Spatialize_Static;
+	if (ActorCDO->bAlwaysRelevant)
+	{
+		Mapping = ERepNodeMapping::RelevantAllConnections;
+	}
+	else if (ActorCDO->bOnlyRelevantToOwner)
+	{
+		Mapping = ERepNodeMapping::NotRouted;
+	}
+	else if (ActorCDO->GetRootComponent() && ActorCDO->GetRootComponent()->Mobility == EComponentMobility::Movable)
+	{
+		Mapping = ERepNodeMapping::Spatialize_Dynamic;
+	}
+
+	ClassRepNodePolicies.Set(Class, Mapping);
+	return Mapping;
+}
+
+void UMilitaryVehicleReplicationGraph::InitGlobalGraphNodes()
+{
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = GridCellSize;
+	GridNode->SpatialBias = GridSpatialBias;
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+}
+
+void UMilitaryVehicleReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	UMilitaryVehicleReplicationGraphNode_AlwaysRelevant_ForConnection* ConnectionNode =
+		CreateNewNode<UMilitaryVehicleReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(ConnectionNode, RepGraphConnection);
+}
+
+void UMilitaryVehicleReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	switch (GetMappingPolicy(ActorInfo.Class))
+	{
+	case ERepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+	case ERepNodeMapping::Spatialize_Static:
+		GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+	case ERepNodeMapping::Spatialize_Dynamic:
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		break;
+	case ERepNodeMapping::Spatialize_Dormancy:
+		GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		break;
+	default:
+		break;
+	}
+}
+
+void UMilitaryVehicleReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	switch (GetMappingPolicy(ActorInfo.Class))
+	{
+	case ERepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+	case ERepNodeMapping::Spatialize_Static:
+		GridNode->RemoveActor_Static(ActorInfo);
+		break;
+	case ERepNodeMapping::Spatialize_Dynamic:
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		break;
+	case ERepNodeMapping::Spatialize_Dormancy:
+		GridNode->RemoveActor_Dormancy(ActorInfo);
+		break;
+	default:
+		break;
+	}
+}
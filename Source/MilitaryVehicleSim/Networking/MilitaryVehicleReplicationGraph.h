@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "MilitaryVehicleReplicationGraph.generated.h"
+
+class UReplicationGraphNode_ActorList;
+class UReplicationGraphNode_GridSpatialization2D;
+
+/** Replication settings for one actor class and its subclasses. */
+USTRUCT()
+struct FMilitaryVehicleRepClassSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category = "Replication")
+	FSoftClassPath ActorClass;
+
+	/** Distance beyond which the class is not replicated to a connection. Zero means never culled. */
+	UPROPERTY(EditAnywhere, Category = "Replication")
+	float CullDistance = 0.0f;
+
+	/** Times per second the class is considered for replication. */
+	UPROPERTY(EditAnywhere, Category = "Replication")
+	float NetUpdateFrequency = 10.0f;
+};
+
+/**
+ * Keeps the connection's own controller, possessed vehicle and view target relevant
+ * regardless of where they are on the grid.
+ */
+UCLASS()
+class MILITARYVEHICLESIM_API UMilitaryVehicleReplicationGraphNode_AlwaysRelevant_ForConnection : public UReplicationGraphNode
+{
+	GENERATED_BODY()
+
+public:
+	virtual void NotifyAddNetworkActor(const FNewReplicatedActorInfo& Actor) override {}
+	virtual bool NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound = true) override { return false; }
+	virtual void NotifyResetAllNetworkActors() override {}
+
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+
+private:
+	FActorRepListRefView ReplicationActorList;
+};
+
+/**
+ * Project replication graph, replacing the default per-connection relevancy checks.
+ * Vehicles and projectiles live on a 2D spatial grid so each connection only considers nearby cells;
+ * dormant pooled rounds stay on the grid without being re-evaluated. Always-relevant actors share one
+ * global list, and each connection keeps its possessed vehicle through a per-connection node.
+ * Compare with the default driver using "stat Net" and "Net.RepGraph.PrintGraph" on the server.
+ */
+UCLASS(Transient, Config = Engine)
+class MILITARYVEHICLESIM_API UMilitaryVehicleReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+	UMilitaryVehicleReplicationGraph();
+
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+
+	/** Overrides the class rate for one actor, e.g. as its significance changes. */
+	void SetActorNetUpdateFrequency(AActor* Actor, float NetUpdateFrequency);
+
+protected:
+	UPROPERTY(Config)
+	float GridCellSize;
+
+	/** Lowest world X/Y covered by the grid; actors below it are clamped into the edge cells. */
+	UPROPERTY(Config)
+	FVector2D GridSpatialBias;
+
+	UPROPERTY(Config)
+	TArray<FMilitaryVehicleRepClassSettings> ClassSettings;
+
+private:
+	enum class ERepNodeMapping : uint8
+	{
+		/** Handled by the per-connection node or not replicated through the graph at all. */
+		NotRouted,
+		RelevantAllConnections,
+		Spatialize_Static,
+		Spatialize_Dynamic,
+		/** Spatialized while awake, skipped while dormant (pooled rounds). */
+		Spatialize_Dormancy,
+	};
+
+	ERepNodeMapping GetMappingPolicy(UClass* Class);
+	void InitClassReplicationInfo(FClassReplicationInfo& Info, const AActor* ActorCDO, float CullDistance, float NetUpdateFrequency) const;
+	uint32 GetReplicationPeriodFrame(float NetUpdateFrequency) const;
+
+	UPROPERTY()
+	TObjectPtr<UReplicationGraphNode_GridSpatialization2D> GridNode;
+
+	UPROPERTY()
+	TObjectPtr<UReplicationGraphNode_ActorList> AlwaysRelevantNode;
+
+	TClassMap<ERepNodeMapping> ClassRepNodePolicies;
+};
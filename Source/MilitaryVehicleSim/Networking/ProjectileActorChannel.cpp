@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectileActorChannel.h"
+
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "Misc/CommandLine.h"
+#include "MilitaryVehicleSim/MilitaryVehicleSim.h"
+#include "MilitaryVehicleSim/Networking/ProjectileShotSubsystem.h"
+#include "MilitaryVehicleSim/Projectiles/ProjectileBase.h"
+#include "Net/DataBunch.h"
+#include "UObject/UObjectIterator.h"
+
+void UProjectileActorChannel::InstallIfRequested()
+{
+	static bool bChecked = false;
+	if (bChecked)
+	{
+		return;
+	}
+	bChecked = true;
+
+	if (!FParse::Param(FCommandLine::Get(), TEXT("ProjectileChannelStats")))
+	{
+		return;
+	}
+
+	// Matched by channel name rather than the whole definition, so engine changes to the other fields don't matter
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		if (!It->IsChildOf(UNetDriver::StaticClass()))
+		{
+			continue;
+		}
+
+		for (FChannelDefinition& Definition : It->GetDefaultObject<UNetDriver>()->ChannelDefinitions)
+		{
+			if (Definition.ChannelName == NAME_Actor)
+			{
+				Definition.ClassName = FName(*StaticClass()->GetPathName());
+				Definition.ChannelClass = StaticClass();
+			}
+		}
+	}
+	UE_LOG(LogMilitaryVehicle, Log, TEXT("Shot replication: counting projectile actor channel bits (-ProjectileChannelStats)"));
+}
+
+void UProjectileActorChannel::ReceivedBunch(FInBunch& Bunch)
+{
+	const int64 NumBits = Bunch.GetNumBits();
+
+	Super::ReceivedBunch(Bunch);
+
+	if (!Actor)
+	{
+		UnattributedBits += NumBits;
+		return;
+	}
+
+	if (Actor->IsA<AProjectileBase>())
+	{
+		if (UProjectileShotSubsystem* ShotSubsystem = Actor->GetWorld()->GetSubsystem<UProjectileShotSubsystem>())
+		{
+			ShotSubsystem->RecordReplicatedProjectileBits(UnattributedBits + NumBits);
+		}
+	}
+	UnattributedBits = 0;
+}
@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/ActorChannel.h"
+#include "ProjectileActorChannel.generated.h"
+
+/**
+ * Actor channel that reports every bunch received for a replicated projectile to UProjectileShotSubsystem, so the
+ * bytes-per-shot comparison covers movement and property updates as well as the channel open.
+ *
+ * Measurement only: installed in place of UActorChannel for every actor, so it is left out of normal runs. Start the
+ * client with -ProjectileChannelStats to install it. Without it, the replication graph's CSV class tracking and
+ * Networking Insights (-NetTrace=1 -trace=net) give the projectile bits on the server.
+ */
+UCLASS(Transient)
+class MILITARYVEHICLESIM_API UProjectileActorChannel : public UActorChannel
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * With -ProjectileChannelStats, makes every net driver class open actor channels as this class. Drivers created
+	 * afterwards pick it up from their class defaults. Call before connecting; later calls do nothing.
+	 */
+	static void InstallIfRequested();
+
+protected:
+	virtual void ReceivedBunch(FInBunch& Bunch) override;
+
+private:
+	/** Bits received while the actor was still unresolved, such as bunches queued on pending GUIDs. */
+	int64 UnattributedBits = 0;
+};
@@ -0,0 +1,416 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectileShotSubsystem.h"
+
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/PackageMapClient.h"
+#include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/Pawn.h"
+#include "HAL/IConsoleManager.h"
+#include "MilitaryVehicleSim/MilitaryVehicleSim.h"
+#include "MilitaryVehicleSim/Networking/ProjectileActorChannel.h"
+#include "MilitaryVehicleSim/Projectiles/ProjectileBase.h"
+#include "MilitaryVehicleSim/Vehicles/MilitaryVehicleBase.h"
+
+static TAutoConsoleVariable<float> CVarShotEventMaxCatchUp(
+	TEXT("mvs.ShotEvents.MaxCatchUpSeconds"),
+	0.5f,
+	TEXT("Upper bound on how far a received shot is fast-forwarded to make up for transit time."));
+
+static TAutoConsoleVariable<bool> CVarShotPredictionEnabled(
+	TEXT("mvs.ShotPrediction.Enabled"),
+	true,
+	TEXT("Let the owning client fly its own rounds as soon as it fires, handing them over to the server's rounds when those arrive."));
+
+static TAutoConsoleVariable<float> CVarShotPredictionClaimTimeout(
+	TEXT("mvs.ShotPrediction.ClaimTimeout"),
+	1.0f,
+	TEXT("Seconds a predicted round waits for the server's round before it is treated as a dropped shot and removed."));
+
+static FAutoConsoleCommandWithWorld ShotReplicationStatsCommand(
+	TEXT("mvs.ShotEvents.Stats"),
+	TEXT("Logs received bytes per shot for shot events versus replicated projectile actors."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UProjectileShotSubsystem* ShotSubsystem = World ? World->GetSubsystem<UProjectileShotSubsystem>() : nullptr)
+		{
+			ShotSubsystem->LogStats();
+		}
+	}));
+
+namespace ShotReplication
+{
+	static int64 GetPosBits(FArchive& Ar)
+	{
+		return Ar.IsLoading() && Ar.IsNetArchive() ? static_cast<FBitReader&>(Ar).GetPosBits() : 0;
+	}
+
+	/** Attributes the bits read for an event to the receiving world's counters. */
+	static void RecordReceivedBits(FArchive& Ar, UPackageMap* Map, int64 StartBits, bool bIsShot)
+	{
+		if (!Ar.IsLoading() || !Ar.IsNetArchive())
+		{
+			return;
+		}
+
+		UPackageMapClient* PackageMap = Cast<UPackageMapClient>(Map);
+		UNetConnection* Connection = PackageMap ? PackageMap->GetConnection() : nullptr;
+		UWorld* World = Connection && Connection->Driver ? Connection->Driver->GetWorld() : nullptr;
+		if (UProjectileShotSubsystem* ShotSubsystem = World ? World->GetSubsystem<UProjectileShotSubsystem>() : nullptr)
+		{
+			ShotSubsystem->RecordShotEventBits(GetPosBits(Ar) - StartBits, bIsShot);
+		}
+	}
+
+	/** Where a shot's round is after flying for Time seconds along its ballistic arc. */
+	static void EvaluateShot(const FProjectileShotEvent& Shot, const AProjectileBase* Defaults, float GravityZ, float Time,
+		FVector& OutLocation, FVector& OutVelocity)
+	{
+		const FVector Gravity(0.0f, 0.0f, GravityZ * Defaults->GetGravityScale());
+		const FVector Velocity = Shot.GetDirection() * Defaults->GetInitialSpeed();
+		OutLocation = FVector(Shot.MuzzleLocation) + Velocity * Time + 0.5f * Gravity * FMath::Square(Time);
+		OutVelocity = Velocity + Gravity * Time;
+	}
+}
+
+void FProjectileShotEvent::SetDirection(const FVector& Direction)
+{
+	const FRotator Rotation = Direction.Rotation();
+	DirectionPitch = FRotator::CompressAxisToShort(Rotation.Pitch);
+	DirectionYaw = FRotator::CompressAxisToShort(Rotation.Yaw);
+}
+
+FVector FProjectileShotEvent::GetDirection() const
+{
+	return FRotator(FRotator::DecompressAxisFromShort(DirectionPitch), FRotator::DecompressAxisFromShort(DirectionYaw), 0.0f).Vector();
+}
+
+bool FProjectileShotEvent::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	const int64 StartBits = ShotReplication::GetPosBits(Ar);
+
+	bOutSuccess = true;
+	MuzzleLocation.NetSerialize(Ar, Map, bOutSuccess);
+
+	Ar << DirectionPitch;
+	Ar << DirectionYaw;
+
+	// The class goes out as its NetGUID, which is a small packed integer once it has been exported
+	UObject* ClassObject = ProjectileClass.Get();
+	bOutSuccess &= Map->SerializeObject(Ar, UClass::StaticClass(), ClassObject);
+	if (Ar.IsLoading())
+	{
+		ProjectileClass = Cast<UClass>(ClassObject);
+	}
+
+	Ar << ShotId;
+	Ar << Seed;
+	Ar << ServerTime;
+
+	// Only the owning client uses the key, and most shots have none
+	bool bPredicted = PredictedShot.IsSet();
+	Ar.SerializeBits(&bPredicted, 1);
+	if (bPredicted)
+	{
+		Ar << PredictedShot.PredictionKey;
+		Ar << PredictedShot.ShotIndex;
+	}
+	else if (Ar.IsLoading())
+	{
+		PredictedShot = FPredictedShotKey();
+	}
+
+	ShotReplication::RecordReceivedBits(Ar, Map, StartBits, true);
+	return true;
+}
+
+bool FProjectileImpactEvent::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	const int64 StartBits = ShotReplication::GetPosBits(Ar);
+
+	bOutSuccess = true;
+	Ar << ShotId;
+	Location.NetSerialize(Ar, Map, bOutSuccess);
+
+	ShotReplication::RecordReceivedBits(Ar, Map, StartBits, false);
+	return true;
+}
+
+bool UProjectileShotSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UProjectileShotSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// The startup map's world exists before any connection is made
+	UProjectileActorChannel::InstallIfRequested();
+}
+
+void UProjectileShotSubsystem::Deinitialize()
+{
+	if (Stats.ShotEvents > 0 || Stats.ReplicatedProjectiles > 0)
+	{
+		LogStats();
+	}
+
+	CosmeticRounds.Empty();
+	PredictedRounds.Empty();
+	Super::Deinitialize();
+}
+
+bool UProjectileShotSubsystem::UsesShotEvents(const AProjectileBase* ProjectileDefaults)
+{
+	// Lightweight rounds have no actor to replicate, so events are their only client representation
+	return ProjectileDefaults && (ProjectileDefaults->ReplicatesAsShotEvent() || ProjectileDefaults->UsesLightweightSimulation());
+}
+
+bool UProjectileShotSubsystem::BeginShot(AActor* Shooter, TSubclassOf<AProjectileBase> ProjectileClass, const FVector& MuzzleLocation,
+	const FVector& Direction, FProjectileShotEvent& OutShot) const
+{
+	AMilitaryVehicleBase* Vehicle = Cast<AMilitaryVehicleBase>(Shooter);
+	if (!Vehicle || !ProjectileClass)
+	{
+		return false;
+	}
+
+	OutShot.ProjectileClass = ProjectileClass;
+	OutShot.ShotId = Vehicle->AllocateShotId();
+	OutShot.Seed = static_cast<uint16>(FMath::Rand() & 0xFFFF);
+
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	OutShot.ServerTime = GameState ? static_cast<float>(GameState->GetServerWorldTimeSeconds()) : GetWorld()->GetTimeSeconds();
+
+	FVector ShotDirection = Direction;
+	const float DispersionDegrees = GetDefault<AProjectileBase>(ProjectileClass)->GetDispersionDegrees();
+	if (DispersionDegrees > 0.0f)
+	{
+		const FRandomStream Stream(OutShot.Seed);
+		ShotDirection = Stream.VRandCone(Direction, FMath::DegreesToRadians(DispersionDegrees));
+	}
+	OutShot.SetDirection(ShotDirection);
+
+	// Snap the server's own round to the quantized values so both sides fly the same path
+	OutShot.MuzzleLocation = FVector(FMath::RoundToDouble(MuzzleLocation.X), FMath::RoundToDouble(MuzzleLocation.Y), FMath::RoundToDouble(MuzzleLocation.Z));
+	return true;
+}
+
+void UProjectileShotSubsystem::BroadcastShot(AActor* Shooter, const FProjectileShotEvent& Shot) const
+{
+	if (AMilitaryVehicleBase* Vehicle = Cast<AMilitaryVehicleBase>(Shooter))
+	{
+		Vehicle->Multicast_ShotFired(Shot);
+	}
+}
+
+void UProjectileShotSubsystem::BroadcastImpact(AActor* Shooter, uint16 ShotId, const FVector& ImpactLocation) const
+{
+	if (AMilitaryVehicleBase* Vehicle = Cast<AMilitaryVehicleBase>(Shooter))
+	{
+		FProjectileImpactEvent Impact;
+		Impact.ShotId = ShotId;
+		Impact.Location = ImpactLocation;
+		Vehicle->Multicast_ShotImpact(Impact);
+	}
+}
+
+void UProjectileShotSubsystem::SimulateShot(AMilitaryVehicleBase* Shooter, const FProjectileShotEvent& Shot)
+{
+	UWorld* World = GetWorld();
+	if (!World || !Shooter || !Shot.ProjectileClass)
+	{
+		return;
+	}
+
+	const AProjectileBase* Defaults = GetDefault<AProjectileBase>(Shot.ProjectileClass);
+	FVector Location;
+	FVector Velocity;
+
+	// Our own shot: the round predicted when we fired takes the server's place, moved onto its exact path at the
+	// predicted round's own age so it never jumps back in time
+	AProjectileBase* PredictedRound = nullptr;
+	float PredictedAge = 0.0f;
+	if (ClaimPredictedRound(Shooter, Shot.ProjectileClass, Shot.PredictedShot, PredictedRound, PredictedAge))
+	{
+		if (PredictedRound)
+		{
+			ShotReplication::EvaluateShot(Shot, Defaults, World->GetGravityZ(), PredictedAge, Location, Velocity);
+			PredictedRound->SetActorLocationAndRotation(Location, Velocity.Rotation(), false, nullptr, ETeleportType::TeleportPhysics);
+			PredictedRound->SetVelocity(Velocity);
+			CosmeticRounds.Add(MakeShotKey(Shooter, Shot.ShotId), PredictedRound);
+		}
+		return;
+	}
+
+	// Catch up on the time the event spent in transit along the same ballistic arc the server flies
+	const AGameStateBase* GameState = World->GetGameState();
+	const float ServerNow = GameState ? static_cast<float>(GameState->GetServerWorldTimeSeconds()) : Shot.ServerTime;
+	const float CatchUp = FMath::Clamp(ServerNow - Shot.ServerTime, 0.0f, CVarShotEventMaxCatchUp.GetValueOnGameThread());
+	ShotReplication::EvaluateShot(Shot, Defaults, World->GetGravityZ(), CatchUp, Location, Velocity);
+
+	const FTransform SpawnTransform(Velocity.Rotation(), Location);
+	AProjectileBase* Projectile = World->SpawnActorDeferred<AProjectileBase>(Shot.ProjectileClass, SpawnTransform, Shooter, nullptr,
+		ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	if (!Projectile)
+	{
+		return;
+	}
+
+	Projectile->MarkCosmetic();
+	Projectile->FinishSpawning(SpawnTransform);
+	Projectile->SetVelocity(Velocity);
+
+	// Drop entries whose rounds already ended on their own before the map grows unbounded
+	if (CosmeticRounds.Num() > 256)
+	{
+		for (auto It = CosmeticRounds.CreateIterator(); It; ++It)
+		{
+			if (!It.Value().IsValid())
+			{
+				It.RemoveCurrent();
+			}
+		}
+	}
+	CosmeticRounds.Add(MakeShotKey(Shooter, Shot.ShotId), Projectile);
+}
+
+void UProjectileShotSubsystem::HandleImpact(AMilitaryVehicleBase* Shooter, uint16 ShotId, const FVector& ImpactLocation)
+{
+	TWeakObjectPtr<AProjectileBase> Round;
+	if (!CosmeticRounds.RemoveAndCopyValue(MakeShotKey(Shooter, ShotId), Round))
+	{
+		return;
+	}
+
+	if (AProjectileBase* Projectile = Round.Get())
+	{
+		Projectile->SetActorLocation(ImpactLocation);
+		Projectile->Destroy();
+	}
+}
+
+void UProjectileShotSubsystem::PredictShot(AActor* Shooter, TSubclassOf<AProjectileBase> ProjectileClass, const FVector& MuzzleLocation,
+	const FVector& Direction, float ShotAge, const FPredictedShotKey& PredictedShot)
+{
+	UWorld* World = GetWorld();
+	if (!World || !Shooter || !ProjectileClass || !CVarShotPredictionEnabled.GetValueOnGameThread())
+	{
+		return;
+	}
+
+	PrunePredictedRounds();
+
+	// Dispersion is seeded by the server, so the prediction flies the undispersed line until the real shot arrives
+	const FTransform SpawnTransform(Direction.Rotation(), MuzzleLocation);
+	AProjectileBase* Projectile = World->SpawnActorDeferred<AProjectileBase>(ProjectileClass, SpawnTransform, Shooter, Cast<APawn>(Shooter),
+		ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	if (!Projectile)
+	{
+		return;
+	}
+
+	Projectile->MarkCosmetic();
+	Projectile->FinishSpawning(SpawnTransform);
+	Projectile->InitializeVelocity(Direction.GetSafeNormal());
+	Projectile->CatchUp(ShotAge);
+
+	FPredictedRound& Predicted = PredictedRounds.AddDefaulted_GetRef();
+	Predicted.Projectile = Projectile;
+	Predicted.Shooter = Shooter;
+	Predicted.ProjectileClass = ProjectileClass;
+	Predicted.FireTime = World->GetTimeSeconds() - ShotAge;
+	Predicted.Key = PredictedShot;
+}
+
+void UProjectileShotSubsystem::RejectPredictedShots(int16 PredictionKey)
+{
+	for (int32 Index = PredictedRounds.Num() - 1; Index >= 0; --Index)
+	{
+		if (PredictedRounds[Index].Key.PredictionKey == PredictionKey)
+		{
+			if (AProjectileBase* Projectile = PredictedRounds[Index].Projectile.Get())
+			{
+				Projectile->Destroy();
+			}
+			PredictedRounds.RemoveAt(Index, 1, false);
+		}
+	}
+}
+
+bool UProjectileShotSubsystem::ClaimPredictedRound(const AActor* Shooter, const UClass* ProjectileClass, const FPredictedShotKey& PredictedShot,
+	AProjectileBase*& OutRound, float& OutAge)
+{
+	OutRound = nullptr;
+	OutAge = 0.0f;
+
+	PrunePredictedRounds();
+
+	if (!PredictedShot.IsSet())
+	{
+		return false;
+	}
+
+	const int32 Index = PredictedRounds.IndexOfByPredicate([Shooter, ProjectileClass, &PredictedShot](const FPredictedRound& Predicted)
+	{
+		return Predicted.Key == PredictedShot && Predicted.Shooter.Get() == Shooter && Predicted.ProjectileClass == ProjectileClass;
+	});
+	if (Index == INDEX_NONE)
+	{
+		return false;
+	}
+
+	OutRound = PredictedRounds[Index].Projectile.Get();
+	OutAge = static_cast<float>(GetWorld()->GetTimeSeconds() - PredictedRounds[Index].FireTime);
+	PredictedRounds.RemoveAt(Index, 1, false);
+	return true;
+}
+
+void UProjectileShotSubsystem::PrunePredictedRounds()
+{
+	// Shots the server dropped, e.g. past its fire rate budget, never get a round to claim theirs
+	const double OldestFireTime = GetWorld()->GetTimeSeconds() - CVarShotPredictionClaimTimeout.GetValueOnGameThread();
+	int32 NumExpired = 0;
+	while (NumExpired < PredictedRounds.Num() && PredictedRounds[NumExpired].FireTime < OldestFireTime)
+	{
+		if (AProjectileBase* Projectile = PredictedRounds[NumExpired].Projectile.Get())
+		{
+			Projectile->Destroy();
+		}
+		++NumExpired;
+	}
+	PredictedRounds.RemoveAt(0, NumExpired, false);
+}
+
+uint64 UProjectileShotSubsystem::MakeShotKey(const AActor* Shooter, uint16 ShotId)
+{
+	return (static_cast<uint64>(Shooter ? Shooter->GetUniqueID() : 0) << 16) | ShotId;
+}
+
+void UProjectileShotSubsystem::RecordShotEventBits(int64 NumBits, bool bIsShot)
+{
+	Stats.ShotEventBits += NumBits;
+	if (bIsShot)
+	{
+		++Stats.ShotEvents;
+	}
+}
+
+void UProjectileShotSubsystem::LogStats() const
+{
+	UE_LOG(LogMilitaryVehicle, Log, TEXT("Shot events: %d shots, %.1f bytes/shot (shot + impact payload)"),
+		Stats.ShotEvents, Stats.GetShotEventBytesPerShot());
+	const float UpdatesPerShot = Stats.ReplicatedProjectiles > 0 ? static_cast<float>(Stats.ReplicatedProjectileUpdates) / Stats.ReplicatedProjectiles : 0.0f;
+	if (Stats.ReplicatedProjectiles > 0 && Stats.ReplicatedProjectileBits == 0)
+	{
+		UE_LOG(LogMilitaryVehicle, Log, TEXT("Replicated projectiles: %d rounds, %.1f further updates/shot (bytes need -ProjectileChannelStats)"),
+			Stats.ReplicatedProjectiles, UpdatesPerShot);
+		return;
+	}
+	UE_LOG(LogMilitaryVehicle, Log, TEXT("Replicated projectiles: %d rounds, %.1f bytes/shot (all bunches), %.1f further updates/shot"),
+		Stats.ReplicatedProjectiles, Stats.GetReplicatedBytesPerShot(), UpdatesPerShot);
+}
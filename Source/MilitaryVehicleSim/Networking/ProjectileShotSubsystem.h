@@ -0,0 +1,235 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ProjectileShotSubsystem.generated.h"
+
+class AMilitaryVehicleBase;
+class AProjectileBase;
+
+/**
+ * Identifies a shot the owning client predicted: the GAS prediction key of the fire activation and the shot's index
+ * within that batch. The server stamps its round for the shot with the same key, so the client hands over exactly
+ * the round it predicted for it, even when other shots of the batch were dropped or trimmed.
+ */
+USTRUCT()
+struct MILITARYVEHICLESIM_API FPredictedShotKey
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int16 PredictionKey = 0;
+
+	UPROPERTY()
+	uint8 ShotIndex = 0;
+
+	FPredictedShotKey() = default;
+	FPredictedShotKey(int16 InPredictionKey, uint8 InShotIndex) : PredictionKey(InPredictionKey), ShotIndex(InShotIndex) {}
+
+	/** Shots fired without a client prediction, e.g. by the server's own players or bots, have no key. */
+	bool IsSet() const { return PredictionKey != 0; }
+
+	bool operator==(const FPredictedShotKey& Other) const { return PredictionKey == Other.PredictionKey && ShotIndex == Other.ShotIndex; }
+};
+
+/**
+ * Everything a client needs to replay one shot locally.
+ * Serialized by hand: quantized muzzle, 16-bit pitch/yaw, the projectile class as its NetGUID,
+ * shot id, dispersion seed and server fire time.
+ */
+USTRUCT()
+struct MILITARYVEHICLESIM_API FProjectileShotEvent
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize MuzzleLocation = FVector::ZeroVector;
+
+	UPROPERTY()
+	uint16 DirectionPitch = 0;
+
+	UPROPERTY()
+	uint16 DirectionYaw = 0;
+
+	UPROPERTY()
+	TSubclassOf<AProjectileBase> ProjectileClass;
+
+	/** Per-shooter sequence number used to match the server's impact to the client's round. */
+	UPROPERTY()
+	uint16 ShotId = 0;
+
+	/** Seeds the dispersion cone so server and clients fire along the same direction. */
+	UPROPERTY()
+	uint16 Seed = 0;
+
+	/** Server world time the shot was fired, used by clients to catch up on latency. */
+	UPROPERTY()
+	float ServerTime = 0.0f;
+
+	/** The owning client's prediction of this shot, if it made one. One bit when unset. */
+	UPROPERTY()
+	FPredictedShotKey PredictedShot;
+
+	void SetDirection(const FVector& Direction);
+	FVector GetDirection() const;
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FProjectileShotEvent> : public TStructOpsTypeTraitsBase2<FProjectileShotEvent>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/** Server-decided end of a shot, sent so clients stop the matching cosmetic round. */
+USTRUCT()
+struct MILITARYVEHICLESIM_API FProjectileImpactEvent
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	uint16 ShotId = 0;
+
+	UPROPERTY()
+	FVector_NetQuantize Location = FVector::ZeroVector;
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FProjectileImpactEvent> : public TStructOpsTypeTraitsBase2<FProjectileImpactEvent>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/** Bytes-per-shot counters for both projectile replication modes, as received on this machine. */
+USTRUCT(BlueprintType)
+struct MILITARYVEHICLESIM_API FShotReplicationStats
+{
+	GENERATED_BODY()
+
+	/** Shot events received. Impact events are counted in the bits but not as shots. */
+	UPROPERTY(BlueprintReadOnly, Category = "Shot Replication")
+	int32 ShotEvents = 0;
+
+	/** Payload bits of received shot and impact events. */
+	UPROPERTY(BlueprintReadOnly, Category = "Shot Replication")
+	int64 ShotEventBits = 0;
+
+	/** Replicated projectile actors opened on this machine. */
+	UPROPERTY(BlueprintReadOnly, Category = "Shot Replication")
+	int32 ReplicatedProjectiles = 0;
+
+	/** Bits of every bunch received on replicated projectile actor channels; only counted with -ProjectileChannelStats. */
+	UPROPERTY(BlueprintReadOnly, Category = "Shot Replication")
+	int64 ReplicatedProjectileBits = 0;
+
+	/** Property updates received for replicated projectile actors after the channel opened. */
+	UPROPERTY(BlueprintReadOnly, Category = "Shot Replication")
+	int32 ReplicatedProjectileUpdates = 0;
+
+	float GetShotEventBytesPerShot() const { return ShotEvents > 0 ? ShotEventBits / 8.0f / ShotEvents : 0.0f; }
+	float GetReplicatedBytesPerShot() const { return ReplicatedProjectiles > 0 ? ReplicatedProjectileBits / 8.0f / ReplicatedProjectiles : 0.0f; }
+};
+
+/**
+ * Shot-event replication for projectile classes with bReplicateAsShotEvent (and all lightweight rounds).
+ * The server fires a non-replicated round and multicasts one FProjectileShotEvent through the shooting
+ * vehicle; clients spawn a local cosmetic round on the same path and drop it when the server's impact arrives.
+ *
+ * Also owns the owning client's predicted rounds. The fire ability spawns one per shot the moment the gunner
+ * fires, keyed by its FPredictedShotKey. The server's round for the same shot, arriving a round trip later as a
+ * shot event or a replicated actor, carries the same key and takes over that predicted round instead of showing a
+ * second one. Rounds are dropped if their prediction key is rejected or no server round claims them in time.
+ */
+UCLASS()
+class MILITARYVEHICLESIM_API UProjectileShotSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** True if shots of this class go out as events instead of replicated actors. */
+	static bool UsesShotEvents(const AProjectileBase* ProjectileDefaults);
+
+	/** Server: fills in a shot event, applying seeded dispersion. Fire along OutShot's muzzle and direction so clients match. */
+	bool BeginShot(AActor* Shooter, TSubclassOf<AProjectileBase> ProjectileClass, const FVector& MuzzleLocation, const FVector& Direction,
+		FProjectileShotEvent& OutShot) const;
+
+	/** Server: sends a shot prepared with BeginShot to clients. */
+	void BroadcastShot(AActor* Shooter, const FProjectileShotEvent& Shot) const;
+
+	/** Server: sends the authoritative impact of a shot to clients. */
+	void BroadcastImpact(AActor* Shooter, uint16 ShotId, const FVector& ImpactLocation) const;
+
+	/** Client: spawns the cosmetic round for a received shot, fast-forwarded by the time it spent in transit. */
+	void SimulateShot(AMilitaryVehicleBase* Shooter, const FProjectileShotEvent& Shot);
+
+	/** Client: ends the cosmetic round of a shot at the server's impact point. */
+	void HandleImpact(AMilitaryVehicleBase* Shooter, uint16 ShotId, const FVector& ImpactLocation);
+
+	/** Owning client: spawns a cosmetic round for a shot the server has not confirmed yet. ShotAge is as in UBallisticsSubsystem::FireRound. */
+	void PredictShot(AActor* Shooter, TSubclassOf<AProjectileBase> ProjectileClass, const FVector& MuzzleLocation, const FVector& Direction,
+		float ShotAge, const FPredictedShotKey& PredictedShot);
+
+	/** Owning client: removes every round predicted under a prediction key the server turned down. */
+	void RejectPredictedShots(int16 PredictionKey);
+
+	/**
+	 * Owning client: takes the round Shooter predicted for this class under PredictedShot, if any. Returns true when
+	 * there was one, even if it already ended on its own; OutRound is then null and OutAge is meaningless.
+	 * OutAge is how long the predicted round has been flying.
+	 */
+	bool ClaimPredictedRound(const AActor* Shooter, const UClass* ProjectileClass, const FPredictedShotKey& PredictedShot,
+		AProjectileBase*& OutRound, float& OutAge);
+
+	// Stats
+	void RecordShotEventBits(int64 NumBits, bool bIsShot);
+	void RecordReplicatedProjectileOpen() { ++Stats.ReplicatedProjectiles; }
+	void RecordReplicatedProjectileBits(int64 NumBits) { Stats.ReplicatedProjectileBits += NumBits; }
+	void RecordReplicatedProjectileUpdate() { ++Stats.ReplicatedProjectileUpdates; }
+
+	UFUNCTION(BlueprintCallable, Category = "Shot Replication")
+	FShotReplicationStats GetStats() const { return Stats; }
+
+	void LogStats() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	static uint64 MakeShotKey(const AActor* Shooter, uint16 ShotId);
+
+	/** Drops predicted rounds that no server round claimed within mvs.ShotPrediction.ClaimTimeout. */
+	void PrunePredictedRounds();
+
+	/** Cosmetic rounds in flight, by shooter and shot id. */
+	TMap<uint64, TWeakObjectPtr<AProjectileBase>> CosmeticRounds;
+
+	struct FPredictedRound
+	{
+		TWeakObjectPtr<AProjectileBase> Projectile;
+		TWeakObjectPtr<const AActor> Shooter;
+		const UClass* ProjectileClass = nullptr;
+		/** World time the shot was due, i.e. the spawn time minus its shot age. */
+		double FireTime = 0.0;
+		FPredictedShotKey Key;
+	};
+
+	/** Unclaimed predicted rounds, oldest first. */
+	TArray<FPredictedRound> PredictedRounds;
+
+	FShotReplicationStats Stats;
+};
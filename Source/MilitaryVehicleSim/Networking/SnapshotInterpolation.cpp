@@ -0,0 +1,214 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SnapshotInterpolation.h"
+
+#include "MilitaryVehicleSim/Vehicles/MilitaryVehicleBase.h"
+
+namespace
+{
+	/** Index of the newest sample at or before Time, or INDEX_NONE if all are newer. */
+	template<typename SampleType>
+	int32 FindSampleBefore(const TArray<SampleType>& Samples, double Time)
+	{
+		for (int32 Index = Samples.Num() - 1; Index >= 0; --Index)
+		{
+			if (Samples[Index].Time <= Time)
+			{
+				return Index;
+			}
+		}
+		return INDEX_NONE;
+	}
+
+	template<typename SampleType>
+	void AddSample(TArray<SampleType>& Samples, const SampleType& Sample)
+	{
+		if (Samples.Num() > 0 && Samples.Last().Time >= Sample.Time)
+		{
+			Samples.Last() = Sample;
+			return;
+		}
+
+		if (Samples.Num() >= SnapshotInterpolation::MaxSamples)
+		{
+			Samples.RemoveAt(0, 1, false);
+		}
+		Samples.Add(Sample);
+	}
+
+	template<typename SampleType>
+	void PruneSamples(TArray<SampleType>& Samples, double Time)
+	{
+		// Keep the sample just before Time as the start of the current segment
+		const int32 NumStale = FindSampleBefore(Samples, Time);
+		if (NumStale > 0)
+		{
+			Samples.RemoveAt(0, NumStale, false);
+		}
+	}
+}
+
+uint16 SnapshotInterpolation::WrapServerTimeMs(double ServerTime)
+{
+	return static_cast<uint16>(FMath::FloorToInt64(ServerTime * 1000.0) & 0xFFFF);
+}
+
+double SnapshotInterpolation::UnwrapServerTimeMs(uint16 TimeMs, double ServerNow)
+{
+	constexpr double Period = 65.536;
+	const double Time = ServerNow - FMath::Fmod(ServerNow, Period) + TimeMs / 1000.0;
+	if (Time > ServerNow + Period * 0.5)
+	{
+		return Time - Period;
+	}
+	return Time < ServerNow - Period * 0.5 ? Time + Period : Time;
+}
+
+void FVehicleInterpolationBuffer::AddHull(const FHullInterpolationSample& Sample, double ArrivalServerTime)
+{
+	using namespace SnapshotInterpolation;
+
+	if (HullSamples.Num() > 0 && Sample.Time > HullSamples.Last().Time)
+	{
+		const FHullInterpolationSample& Previous = HullSamples.Last();
+		const double Interval = Sample.Time - Previous.Time;
+
+		// A vehicle at rest isn't sent until it moves again; it stood still until about one interval before this
+		if (MeanInterval > 0.0 && Interval > 2.0 * MeanInterval && Previous.LinearVelocity.IsNearlyZero(1.0))
+		{
+			FHullInterpolationSample Hold = Previous;
+			Hold.Time = Sample.Time - MeanInterval;
+			AddSample(HullSamples, Hold);
+		}
+
+		if (Interval <= MaxMeasuredInterval)
+		{
+			MeanInterval = MeanInterval > 0.0 ? FMath::Lerp(MeanInterval, Interval, StatsSmoothing) : Interval;
+		}
+	}
+
+	const double Transit = ArrivalServerTime - Sample.Time;
+	if (bHasTransit)
+	{
+		TransitJitter = FMath::Lerp(TransitJitter, FMath::Abs(Transit - MeanTransit), StatsSmoothing);
+		MeanTransit = FMath::Lerp(MeanTransit, Transit, StatsSmoothing);
+	}
+	else
+	{
+		MeanTransit = Transit;
+		bHasTransit = true;
+	}
+
+	AddSample(HullSamples, Sample);
+}
+
+double FVehicleInterpolationBuffer::UpdateDelay(float DeltaTime, float IntervalMultiple, float MinDelay, float MaxDelay)
+{
+	if (MeanInterval <= 0.0)
+	{
+		return FMath::Max(Delay, static_cast<double>(MinDelay));
+	}
+
+	const double TargetDelay = FMath::Clamp(MeanInterval * IntervalMultiple + 2.0 * TransitJitter, static_cast<double>(MinDelay),
+		static_cast<double>(FMath::Max(MinDelay, MaxDelay)));
+	Delay = Delay > 0.0 ? FMath::FInterpConstantTo(Delay, TargetDelay, static_cast<double>(DeltaTime), SnapshotInterpolation::DelayChangeRate) : TargetDelay;
+	return Delay;
+}
+
+void FVehicleInterpolationBuffer::AddTurretYaw(double Time, float Yaw)
+{
+	FTurretInterpolationSample Sample;
+	Sample.Time = Time;
+	Sample.Yaw = Yaw;
+	AddSample(TurretSamples, Sample);
+}
+
+bool FVehicleInterpolationBuffer::SampleHull(double RenderTime, float MaxExtrapolation, FVector& OutLocation, FQuat& OutRotation) const
+{
+	if (HullSamples.Num() == 0)
+	{
+		return false;
+	}
+
+	// Still waiting for the delay to catch up with the first state
+	const int32 Index = FindSampleBefore(HullSamples, RenderTime);
+	if (Index == INDEX_NONE)
+	{
+		OutLocation = HullSamples[0].Location;
+		OutRotation = HullSamples[0].Rotation;
+		return true;
+	}
+
+	const FHullInterpolationSample& From = HullSamples[Index];
+	if (Index == HullSamples.Num() - 1)
+	{
+		// Ran past the newest state: carry on along its velocities for a while, then hold
+		const float ExtrapolationTime = FMath::Min(static_cast<float>(RenderTime - From.Time), FMath::Max(MaxExtrapolation, 0.0f));
+		OutLocation = From.Location + From.LinearVelocity * ExtrapolationTime;
+
+		const float AngularSpeed = FMath::DegreesToRadians(From.AngularVelocity.Size());
+		OutRotation = AngularSpeed > UE_KINDA_SMALL_NUMBER
+			? FQuat(From.AngularVelocity / From.AngularVelocity.Size(), AngularSpeed * ExtrapolationTime) * From.Rotation
+			: From.Rotation;
+		OutRotation.Normalize();
+		return true;
+	}
+
+	const FHullInterpolationSample& To = HullSamples[Index + 1];
+	const double Interval = To.Time - From.Time;
+	const float Alpha = static_cast<float>((RenderTime - From.Time) / Interval);
+	if (Interval <= SnapshotInterpolation::MaxHermiteInterval)
+	{
+		// Velocities are per second; the curve's tangents are per segment
+		OutLocation = FMath::CubicInterp(From.Location, From.LinearVelocity * Interval, To.Location, To.LinearVelocity * Interval, Alpha);
+	}
+	else
+	{
+		OutLocation = FMath::Lerp(From.Location, To.Location, Alpha);
+	}
+	OutRotation = FQuat::Slerp(From.Rotation, To.Rotation, Alpha);
+	return true;
+}
+
+bool FVehicleInterpolationBuffer::SampleTurretYaw(double RenderTime, float& OutYaw) const
+{
+	if (TurretSamples.Num() == 0)
+	{
+		return false;
+	}
+
+	const int32 Index = FindSampleBefore(TurretSamples, RenderTime);
+	if (Index == INDEX_NONE || Index == TurretSamples.Num() - 1)
+	{
+		// Turret yaw only replicates when it changes, so past the newest sample it has stopped
+		OutYaw = TurretSamples[Index == INDEX_NONE ? 0 : Index].Yaw;
+		return true;
+	}
+
+	const FTurretInterpolationSample& From = TurretSamples[Index];
+	const FTurretInterpolationSample& To = TurretSamples[Index + 1];
+	const float Alpha = static_cast<float>((RenderTime - From.Time) / (To.Time - From.Time));
+	OutYaw = FRotator::NormalizeAxis(From.Yaw + FMath::FindDeltaAngleDegrees(From.Yaw, To.Yaw) * Alpha);
+	return true;
+}
+
+void FVehicleInterpolationBuffer::Prune(double RenderTime)
+{
+	PruneSamples(HullSamples, RenderTime);
+	PruneSamples(TurretSamples, RenderTime);
+}
+
+void FVehicleInterpolationBuffer::Reset()
+{
+	*this = FVehicleInterpolationBuffer();
+}
+
+void FVehicleInterpolationTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread,
+	const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Target && IsValid(Target))
+	{
+		Target->TickInterpolation(DeltaTime);
+	}
+}
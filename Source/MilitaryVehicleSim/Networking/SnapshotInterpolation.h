@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+
+class AMilitaryVehicleBase;
+
+namespace SnapshotInterpolation
+{
+	/** Samples kept per buffer; the oldest are dropped beyond this even if still inside the delay. */
+	static constexpr int32 MaxSamples = 32;
+
+	/**
+	 * Gaps longer than this, e.g. after the vehicle was out of relevancy, are blended linearly instead of along the
+	 * velocities. Covers the slowest significance tier's update interval.
+	 */
+	static constexpr double MaxHermiteInterval = 1.0;
+
+	/** Weight of each new measurement in a buffer's running update interval and transit time. */
+	static constexpr double StatsSmoothing = 0.1;
+
+	/** Send intervals longer than this are gaps, not the update rate, and are left out of the running interval. */
+	static constexpr double MaxMeasuredInterval = 2.0;
+
+	/** Seconds per second the render delay may change by, so the render time never jumps. */
+	static constexpr double DelayChangeRate = 0.1;
+
+	/** Server time as sent with each state: milliseconds, modulo 2^16. */
+	uint16 WrapServerTimeMs(double ServerTime);
+
+	/** Full server time of a wrapped stamp, taking the one nearest the client's estimate of the server time now. */
+	double UnwrapServerTimeMs(uint16 TimeMs, double ServerNow);
+}
+
+/** One received hull state, stamped with the server time it was captured. */
+struct FHullInterpolationSample
+{
+	double Time = 0.0;
+	FVector Location = FVector::ZeroVector;
+	FQuat Rotation = FQuat::Identity;
+	FVector LinearVelocity = FVector::ZeroVector;
+	/** World space, degrees per second. */
+	FVector AngularVelocity = FVector::ZeroVector;
+};
+
+/** One received turret yaw, stamped with the server time it was most likely sent. */
+struct FTurretInterpolationSample
+{
+	double Time = 0.0;
+	float Yaw = 0.0f;
+};
+
+/**
+ * Jitter buffer for a simulated proxy's hull and turret. Received states are kept on the server's timeline and
+ * sampled a delay behind the client's estimate of server time, so there is almost always a state on either side of
+ * the render time: the hull moves along a Hermite curve through both positions and their velocities, the turret
+ * turns along the shorter arc. When updates run late the hull is extrapolated from the newest state for a capped
+ * time and then held.
+ *
+ * The delay follows this proxy's own update rate, which significance tiers lower with distance, plus the jitter
+ * measured in its transit times.
+ */
+class MILITARYVEHICLESIM_API FVehicleInterpolationBuffer
+{
+public:
+	/**
+	 * Adds a state stamped with its server capture time, which arrived at ArrivalServerTime by the client's estimate.
+	 * Samples must arrive in time order; a repeated stamp replaces the last sample.
+	 */
+	void AddHull(const FHullInterpolationSample& Sample, double ArrivalServerTime);
+	void AddTurretYaw(double Time, float Yaw);
+
+	/** Server time an update arriving at ArrivalServerTime was most likely sent, for updates that carry no stamp. */
+	double EstimateSendTime(double ArrivalServerTime) const { return ArrivalServerTime - MeanTransit; }
+
+	/**
+	 * Eases the render delay towards IntervalMultiple update intervals plus twice the transit jitter, clamped to
+	 * [MinDelay, MaxDelay], and returns it.
+	 */
+	double UpdateDelay(float DeltaTime, float IntervalMultiple, float MinDelay, float MaxDelay);
+
+	/** Hull pose at RenderTime; false if nothing was received yet. */
+	bool SampleHull(double RenderTime, float MaxExtrapolation, FVector& OutLocation, FQuat& OutRotation) const;
+
+	/** Turret yaw at RenderTime; false if nothing was received yet. */
+	bool SampleTurretYaw(double RenderTime, float& OutYaw) const;
+
+	/** Drops samples that sampling at RenderTime or later no longer needs. */
+	void Prune(double RenderTime);
+
+	void Reset();
+
+	int32 NumHullSamples() const { return HullSamples.Num(); }
+
+private:
+	TArray<FHullInterpolationSample> HullSamples;
+	TArray<FTurretInterpolationSample> TurretSamples;
+
+	// Running averages over received hull states, in seconds
+	double MeanInterval = 0.0;
+	double MeanTransit = 0.0;
+	double TransitJitter = 0.0;
+	bool bHasTransit = false;
+
+	/** Delay in use; zero until the first interval has been measured. */
+	double Delay = 0.0;
+};
+
+/** Drives a simulated proxy's interpolation every frame, whatever actor tick interval significance has given it. */
+struct FVehicleInterpolationTickFunction : public FTickFunction
+{
+	AMilitaryVehicleBase* Target = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override { return TEXT("VehicleInterpolation"); }
+};
@@ -0,0 +1,22 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TurretAimStream.h"
+
+bool FTurretAimPacket::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	Ar.SerializeBits(&Epoch, TurretAim::EpochBits);
+	Ar << LatestSequence;
+
+	uint32 Count = NumSamples;
+	Ar.SerializeInt(Count, TurretAim::RedundantSamples + 1);
+	NumSamples = static_cast<uint8>(Count);
+
+	for (int32 Index = 0; Index < NumSamples; ++Index)
+	{
+		Ar << Yaws[Index];
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TurretAimStream.generated.h"
+
+namespace TurretAim
+{
+	/** Number of most recent samples repeated in every aim packet to ride out packet loss. */
+	static constexpr int32 RedundantSamples = 3;
+
+	inline uint16 QuantizeYaw(float Yaw) { return FRotator::CompressAxisToShort(Yaw); }
+	inline float DequantizeYaw(uint16 Yaw) { return FRotator::NormalizeAxis(FRotator::DecompressAxisFromShort(Yaw)); }
+
+	/** Bits of the aim stream epoch, which the server bumps whenever control of the turret changes hands. */
+	static constexpr uint32 EpochBits = 4;
+	static constexpr uint8 EpochMask = (1 << EpochBits) - 1;
+
+	/** Wrap-aware comparison of 16-bit sequence numbers. */
+	inline bool IsNewerSequence(uint16 A, uint16 B) { return static_cast<int16>(A - B) > 0; }
+}
+
+/** One quantized turret yaw the owning client aimed at. */
+struct FTurretAimSample
+{
+	uint16 Sequence = 0;
+	uint16 Yaw = 0;
+};
+
+/**
+ * Unreliable client-to-server aim update.
+ * Carries the newest samples with consecutive sequence numbers ending at LatestSequence, newest first,
+ * so one lost packet never loses a sample.
+ */
+USTRUCT()
+struct MILITARYVEHICLESIM_API FTurretAimPacket
+{
+	GENERATED_BODY()
+
+	/** FTurretAimAck::Epoch the stream was started in; packets from an older stream are ignored. */
+	UPROPERTY()
+	uint8 Epoch = 0;
+
+	UPROPERTY()
+	uint16 LatestSequence = 0;
+
+	UPROPERTY()
+	uint8 NumSamples = 0;
+
+	UPROPERTY()
+	uint16 Yaws[TurretAim::RedundantSamples] = {};
+
+	uint16 GetSequence(int32 Index) const { return static_cast<uint16>(LatestSequence - Index); }
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FTurretAimPacket> : public TStructOpsTypeTraitsBase2<FTurretAimPacket>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/** Server's answer to the owning client: the last aim sequence it applied and the yaw that resulted. */
+USTRUCT()
+struct MILITARYVEHICLESIM_API FTurretAimAck
+{
+	GENERATED_BODY()
+
+	/** Current stream; a client seeing a new one restarts its sequence numbers from zero. */
+	UPROPERTY()
+	uint8 Epoch = 0;
+
+	UPROPERTY()
+	uint16 Sequence = 0;
+
+	UPROPERTY()
+	uint16 Yaw = 0;
+};
@@ -0,0 +1,552 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VehicleMovementReplication.h"
+
+#include "ChaosVehicleWheel.h"
+#include "ChaosWheeledVehicleMovementComponent.h"
+#include "Engine/ReplicatedState.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "MilitaryVehicleSim/MilitaryVehicleSim.h"
+#include "MilitaryVehicleSim/Networking/SnapshotInterpolation.h"
+#include "MilitaryVehicleSim/Vehicles/MilitaryVehicleBase.h"
+
+static TAutoConsoleVariable<float> CVarVehicleMovementPositionThreshold(
+	TEXT("mvs.VehicleMovement.PositionThreshold"),
+	1.0f,
+	TEXT("Centimetres a vehicle must move from a connection's last acknowledged state before it is sent again."));
+
+static TAutoConsoleVariable<float> CVarVehicleMovementRotationThreshold(
+	TEXT("mvs.VehicleMovement.RotationThreshold"),
+	0.25f,
+	TEXT("Degrees a vehicle must turn from a connection's last acknowledged state before it is sent again."));
+
+static TAutoConsoleVariable<float> CVarVehicleMovementVelocityThreshold(
+	TEXT("mvs.VehicleMovement.VelocityThreshold"),
+	5.0f,
+	TEXT("Change in linear velocity, in cm/s, that triggers a send on its own."));
+
+static TAutoConsoleVariable<float> CVarVehicleMovementAngularVelocityThreshold(
+	TEXT("mvs.VehicleMovement.AngularVelocityThreshold"),
+	1.0f,
+	TEXT("Change in angular velocity, in deg/s, that triggers a send on its own."));
+
+static FAutoConsoleCommandWithWorldAndArgs VehicleMovementStatsCommand(
+	TEXT("mvs.VehicleMovement.Stats"),
+	TEXT("Logs received bytes per vehicle per second for compact and stock (FRepMovement) vehicle movement. 'reset' restarts the counters."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (!World)
+		{
+			return;
+		}
+
+		const bool bReset = Args.Num() > 0 && Args[0] == TEXT("reset");
+		const double Now = World->GetTimeSeconds();
+		int32 NumVehicles = 0;
+		float StockBytesPerSecond = 0.0f;
+		float CompactBytesPerSecond = 0.0f;
+		for (TActorIterator<AMilitaryVehicleBase> It(World); It; ++It)
+		{
+			if (bReset)
+			{
+				It->ResetMovementNetStats();
+				continue;
+			}
+
+			const FVehicleMovementNetStats& Stats = It->GetMovementNetStats();
+			StockBytesPerSecond += Stats.GetStockBytesPerSecond(Now);
+			CompactBytesPerSecond += Stats.GetCompactBytesPerSecond(Now);
+			++NumVehicles;
+
+			UE_LOG(LogMilitaryVehicle, Log, TEXT("%s: stock %d updates, %.1f B/s; compact %d updates, %.1f B/s"), *It->GetName(),
+				Stats.StockUpdates, Stats.GetStockBytesPerSecond(Now), Stats.CompactUpdates, Stats.GetCompactBytesPerSecond(Now));
+		}
+
+		if (NumVehicles > 0)
+		{
+			UE_LOG(LogMilitaryVehicle, Log, TEXT("Vehicle movement, mean per vehicle: stock %.1f B/s, compact %.1f B/s"),
+				StockBytesPerSecond / NumVehicles, CompactBytesPerSecond / NumVehicles);
+		}
+	}));
+
+namespace VehicleMovement
+{
+	static constexpr double PositionScale = 4.0;
+	static constexpr int32 CellBits = 14;
+	static constexpr int32 CellSize = 1 << CellBits;
+	static constexpr int32 RotationBits = 11;
+	static constexpr int32 RotationMax = (1 << RotationBits) - 1;
+	static constexpr float LinearVelocityStep = 2.0f;
+	static constexpr float AngularVelocityScale = 4.0f;
+	static constexpr float WheelSpeedScale = 16.0f;
+
+	static int16 QuantizeInt16(float Value)
+	{
+		return static_cast<int16>(FMath::Clamp(FMath::RoundToInt32(Value), -MAX_int16, MAX_int16));
+	}
+
+	static uint32 ZigZag(int32 Value)
+	{
+		return (static_cast<uint32>(Value) << 1) ^ static_cast<uint32>(Value >> 31);
+	}
+
+	static int32 UnZigZag(uint32 Value)
+	{
+		return static_cast<int32>(Value >> 1) ^ -static_cast<int32>(Value & 1);
+	}
+
+	static bool SerializeFlag(FArchive& Ar, bool bValue)
+	{
+		uint8 Bit = bValue ? 1 : 0;
+		Ar.SerializeBits(&Bit, 1);
+		return Bit != 0;
+	}
+
+	/** Small changes pack into a byte or two; the base supplies the rest. */
+	template<typename T>
+	static void SerializeDelta(FArchive& Ar, T& Value, T BaseValue)
+	{
+		uint32 Packed = Ar.IsSaving() ? ZigZag(static_cast<int32>(Value) - static_cast<int32>(BaseValue)) : 0;
+		Ar.SerializeIntPacked(Packed);
+		if (Ar.IsLoading())
+		{
+			Value = static_cast<T>(BaseValue + UnZigZag(Packed));
+		}
+	}
+
+	static void SerializeSigned(FArchive& Ar, int32& Value)
+	{
+		uint32 Packed = Ar.IsSaving() ? ZigZag(Value) : 0;
+		Ar.SerializeIntPacked(Packed);
+		if (Ar.IsLoading())
+		{
+			Value = UnZigZag(Packed);
+		}
+	}
+}
+
+/** Per-connection base: the state a connection was last sent, as tracked by the engine's custom delta replication. */
+class FVehicleMovementDeltaState : public INetDeltaBaseState
+{
+public:
+	explicit FVehicleMovementDeltaState(const FVehicleNetState& InState)
+		: State(InState)
+	{
+	}
+
+	virtual bool IsStateEqual(INetDeltaBaseState* OtherState) override
+	{
+		return State.Revision == static_cast<FVehicleMovementDeltaState*>(OtherState)->State.Revision;
+	}
+
+	FVehicleNetState State;
+};
+
+void FVehicleNetState::Capture(const FRigidBodyState& BodyState, const UChaosWheeledVehicleMovementComponent* Movement)
+{
+	using namespace VehicleMovement;
+
+	Position = FIntVector(
+		FMath::RoundToInt32(BodyState.Position.X * PositionScale),
+		FMath::RoundToInt32(BodyState.Position.Y * PositionScale),
+		FMath::RoundToInt32(BodyState.Position.Z * PositionScale));
+
+	// Smallest three: drop the largest component, which the other three determine, and flip the sign so it is positive
+	const FQuat Quat = BodyState.Quaternion.GetNormalized();
+	const double Components[4] = { Quat.X, Quat.Y, Quat.Z, Quat.W };
+	int32 Largest = 0;
+	for (int32 Index = 1; Index < 4; ++Index)
+	{
+		if (FMath::Abs(Components[Index]) > FMath::Abs(Components[Largest]))
+		{
+			Largest = Index;
+		}
+	}
+	const double Sign = Components[Largest] < 0.0 ? -1.0 : 1.0;
+	RotationLargest = static_cast<uint8>(Largest);
+	for (int32 Index = 0, Out = 0; Index < 4; ++Index)
+	{
+		if (Index != Largest)
+		{
+			const double Normalized = Components[Index] * Sign * UE_DOUBLE_HALF_SQRT_2 + 0.5;
+			Rotation[Out++] = static_cast<uint16>(FMath::Clamp(FMath::RoundToInt32(Normalized * RotationMax), 0, RotationMax));
+		}
+	}
+
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		LinearVelocity[Axis] = QuantizeInt16(BodyState.LinVel[Axis] / LinearVelocityStep);
+		AngularVelocity[Axis] = QuantizeInt16(BodyState.AngVel[Axis] * AngularVelocityScale);
+	}
+	bAsleep = (BodyState.Flags & ERigidBodyFlags::Sleeping) != 0;
+
+	NumWheels = 0;
+	WheelSpeed = 0;
+	if (Movement)
+	{
+		NumWheels = static_cast<uint8>(FMath::Min(Movement->Wheels.Num(), MaxWheels));
+		float WheelSpeedSum = 0.0f;
+		for (int32 Index = 0; Index < NumWheels; ++Index)
+		{
+			const UChaosVehicleWheel* Wheel = Movement->Wheels[Index];
+			const float Travel = Wheel ? Wheel->SuspensionMaxRaise + Wheel->SuspensionMaxDrop : 0.0f;
+			Suspension[Index] = Travel > 0.0f
+				? static_cast<uint8>(FMath::RoundToInt32(FMath::Clamp((Wheel->GetSuspensionOffset() + Wheel->SuspensionMaxDrop) / Travel, 0.0f, 1.0f) * 255.0f))
+				: 0;
+			WheelSpeedSum += Wheel ? Wheel->GetWheelAngularVelocity() : 0.0f;
+		}
+		WheelSpeed = NumWheels > 0 ? QuantizeInt16(WheelSpeedSum / NumWheels * WheelSpeedScale) : 0;
+	}
+}
+
+FVector FVehicleNetState::GetLocation() const
+{
+	return FVector(Position) / VehicleMovement::PositionScale;
+}
+
+FQuat FVehicleNetState::GetRotation() const
+{
+	using namespace VehicleMovement;
+
+	double Components[4];
+	double SumSquares = 0.0;
+	for (int32 Index = 0, In = 0; Index < 4; ++Index)
+	{
+		if (Index != RotationLargest)
+		{
+			Components[Index] = (Rotation[In++] / static_cast<double>(RotationMax) - 0.5) * UE_DOUBLE_SQRT_2;
+			SumSquares += FMath::Square(Components[Index]);
+		}
+	}
+	Components[RotationLargest] = FMath::Sqrt(FMath::Max(0.0, 1.0 - SumSquares));
+
+	return FQuat(Components[0], Components[1], Components[2], Components[3]).GetNormalized();
+}
+
+void FVehicleNetState::ToRepMovement(FRepMovement& OutMovement) const
+{
+	using namespace VehicleMovement;
+
+	OutMovement.Location = GetLocation();
+	OutMovement.Rotation = GetRotation().Rotator();
+	OutMovement.LinearVelocity = FVector(LinearVelocity[0], LinearVelocity[1], LinearVelocity[2]) * LinearVelocityStep;
+	OutMovement.AngularVelocity = FVector(AngularVelocity[0], AngularVelocity[1], AngularVelocity[2]) / AngularVelocityScale;
+	OutMovement.bSimulatedPhysicSleep = bAsleep;
+	OutMovement.bRepPhysics = true;
+}
+
+bool FVehicleNetState::HasSameValues(const FVehicleNetState& Other) const
+{
+	return Position == Other.Position
+		&& RotationLargest == Other.RotationLargest
+		&& FMemory::Memcmp(Rotation, Other.Rotation, sizeof(Rotation)) == 0
+		&& FMemory::Memcmp(LinearVelocity, Other.LinearVelocity, sizeof(LinearVelocity)) == 0
+		&& FMemory::Memcmp(AngularVelocity, Other.AngularVelocity, sizeof(AngularVelocity)) == 0
+		&& bAsleep == Other.bAsleep
+		&& NumWheels == Other.NumWheels
+		&& FMemory::Memcmp(Suspension, Other.Suspension, NumWheels) == 0
+		&& WheelSpeed == Other.WheelSpeed;
+}
+
+bool FVehicleNetState::ExceedsThresholds(const FVehicleNetState& Base) const
+{
+	using namespace VehicleMovement;
+
+	// Settling onto or waking from rest always goes out, so resting proxies get the exact final pose
+	if (bAsleep != Base.bAsleep || NumWheels != Base.NumWheels)
+	{
+		return true;
+	}
+
+	const FIntVector Moved = Position - Base.Position;
+	const int32 MaxMoved = FMath::Max3(FMath::Abs(Moved.X), FMath::Abs(Moved.Y), FMath::Abs(Moved.Z));
+	if (MaxMoved > CVarVehicleMovementPositionThreshold.GetValueOnGameThread() * PositionScale)
+	{
+		return true;
+	}
+
+	if (FMath::RadiansToDegrees(GetRotation().AngularDistance(Base.GetRotation())) > CVarVehicleMovementRotationThreshold.GetValueOnGameThread())
+	{
+		return true;
+	}
+
+	int32 MaxLinearChange = 0;
+	int32 MaxAngularChange = 0;
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		MaxLinearChange = FMath::Max(MaxLinearChange, FMath::Abs(LinearVelocity[Axis] - Base.LinearVelocity[Axis]));
+		MaxAngularChange = FMath::Max(MaxAngularChange, FMath::Abs(AngularVelocity[Axis] - Base.AngularVelocity[Axis]));
+	}
+	return MaxLinearChange * LinearVelocityStep > CVarVehicleMovementVelocityThreshold.GetValueOnGameThread()
+		|| MaxAngularChange / AngularVelocityScale > CVarVehicleMovementAngularVelocityThreshold.GetValueOnGameThread();
+}
+
+void FVehicleNetState::Serialize(FArchive& Ar, const FVehicleNetState* Base)
+{
+	using namespace VehicleMovement;
+
+	auto SerializeRotation = [this, &Ar]()
+	{
+		uint32 Largest = RotationLargest;
+		Ar.SerializeInt(Largest, 4);
+		RotationLargest = static_cast<uint8>(Largest);
+		for (int32 Index = 0; Index < 3; ++Index)
+		{
+			uint32 Component = Rotation[Index];
+			Ar.SerializeInt(Component, RotationMax + 1);
+			Rotation[Index] = static_cast<uint16>(Component);
+		}
+	};
+
+	if (!Base)
+	{
+		// Full state: grid cell plus a fixed-size offset inside it
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			int32 Cell = Position[Axis] >> CellBits;
+			uint32 Offset = static_cast<uint32>(Position[Axis] & (CellSize - 1));
+			SerializeSigned(Ar, Cell);
+			Ar.SerializeInt(Offset, CellSize);
+			Position[Axis] = Cell * CellSize + static_cast<int32>(Offset);
+		}
+		SerializeRotation();
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			Ar << LinearVelocity[Axis];
+			Ar << AngularVelocity[Axis];
+		}
+		bAsleep = SerializeFlag(Ar, bAsleep);
+
+		uint32 Wheels = NumWheels;
+		Ar.SerializeInt(Wheels, MaxWheels + 1);
+		NumWheels = static_cast<uint8>(Wheels);
+		for (int32 Index = 0; Index < NumWheels; ++Index)
+		{
+			Ar << Suspension[Index];
+		}
+		Ar << WheelSpeed;
+		return;
+	}
+
+	// Delta: one bit per group that did not change, packed differences for those that did
+	if (SerializeFlag(Ar, Position != Base->Position))
+	{
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			SerializeDelta(Ar, Position[Axis], Base->Position[Axis]);
+		}
+	}
+	else
+	{
+		Position = Base->Position;
+	}
+
+	const bool bRotationChanged = RotationLargest != Base->RotationLargest || FMemory::Memcmp(Rotation, Base->Rotation, sizeof(Rotation)) != 0;
+	if (SerializeFlag(Ar, bRotationChanged))
+	{
+		SerializeRotation();
+	}
+	else
+	{
+		RotationLargest = Base->RotationLargest;
+		FMemory::Memcpy(Rotation, Base->Rotation, sizeof(Rotation));
+	}
+
+	if (SerializeFlag(Ar, FMemory::Memcmp(LinearVelocity, Base->LinearVelocity, sizeof(LinearVelocity)) != 0))
+	{
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			SerializeDelta(Ar, LinearVelocity[Axis], Base->LinearVelocity[Axis]);
+		}
+	}
+	else
+	{
+		FMemory::Memcpy(LinearVelocity, Base->LinearVelocity, sizeof(LinearVelocity));
+	}
+
+	if (SerializeFlag(Ar, FMemory::Memcmp(AngularVelocity, Base->AngularVelocity, sizeof(AngularVelocity)) != 0))
+	{
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			SerializeDelta(Ar, AngularVelocity[Axis], Base->AngularVelocity[Axis]);
+		}
+	}
+	else
+	{
+		FMemory::Memcpy(AngularVelocity, Base->AngularVelocity, sizeof(AngularVelocity));
+	}
+
+	bAsleep = SerializeFlag(Ar, bAsleep);
+
+	// The wheel count never changes in a delta; the server sends a full state instead
+	NumWheels = Base->NumWheels;
+	if (SerializeFlag(Ar, FMemory::Memcmp(Suspension, Base->Suspension, NumWheels) != 0))
+	{
+		for (int32 Index = 0; Index < NumWheels; ++Index)
+		{
+			SerializeDelta(Ar, Suspension[Index], Base->Suspension[Index]);
+		}
+	}
+	else
+	{
+		FMemory::Memcpy(Suspension, Base->Suspension, NumWheels);
+	}
+
+	if (SerializeFlag(Ar, WheelSpeed != Base->WheelSpeed))
+	{
+		SerializeDelta(Ar, WheelSpeed, Base->WheelSpeed);
+	}
+	else
+	{
+		WheelSpeed = Base->WheelSpeed;
+	}
+}
+
+bool FVehicleMovementSnapshot::Capture(const FRigidBodyState& BodyState, const UChaosWheeledVehicleMovementComponent* Movement, double ServerTime)
+{
+	FVehicleNetState State;
+	State.Capture(BodyState, Movement);
+	if (bHasState && State.HasSameValues(Latest))
+	{
+		return false;
+	}
+
+	State.Revision = Latest.Revision + 1;
+	State.TimeMs = SnapshotInterpolation::WrapServerTimeMs(ServerTime);
+	Latest = State;
+	bHasState = true;
+	return true;
+}
+
+bool FVehicleMovementSnapshot::ConsumeReceived(FVehicleNetState& OutState, int64& OutBits)
+{
+	OutBits = PendingBits;
+	PendingBits = 0;
+
+	if (!bHasPendingState)
+	{
+		return false;
+	}
+	bHasPendingState = false;
+	OutState = Latest;
+	return true;
+}
+
+bool FVehicleMovementSnapshot::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+	// No object references in here, so there is nothing to gather or remap
+	if (DeltaParms.GatherGuidReferences || DeltaParms.MoveGuidToUnmapped || DeltaParms.bUpdateUnmappedObjects)
+	{
+		return false;
+	}
+
+	if (DeltaParms.Writer)
+	{
+		return WriteDelta(DeltaParms);
+	}
+	if (DeltaParms.Reader)
+	{
+		return ReadDelta(DeltaParms);
+	}
+	return false;
+}
+
+bool FVehicleMovementSnapshot::WriteDelta(FNetDeltaSerializeInfo& DeltaParms) const
+{
+	using namespace VehicleMovement;
+
+	if (!bHasState)
+	{
+		return false;
+	}
+
+	const FVehicleMovementDeltaState* OldState = DeltaParms.bInternalAck ? nullptr : static_cast<const FVehicleMovementDeltaState*>(DeltaParms.OldState);
+	const FVehicleNetState* Base = OldState ? &OldState->State : nullptr;
+	if (Base && (Base->Revision == Latest.Revision || !Latest.ExceedsThresholds(*Base)))
+	{
+		return false;
+	}
+
+	// Bases the client may no longer hold, or with another wheel count, get a full state instead of a delta
+	if (Base && (Latest.Revision - Base->Revision >= static_cast<uint32>(MaxBaseAge) || Base->NumWheels != Latest.NumWheels))
+	{
+		Base = nullptr;
+	}
+
+	FBitWriter& Writer = *DeltaParms.Writer;
+	SerializeFlag(Writer, Base == nullptr);
+
+	uint16 Revision = static_cast<uint16>(Latest.Revision);
+	Writer << Revision;
+	uint16 TimeMs = Latest.TimeMs;
+	Writer << TimeMs;
+	if (Base)
+	{
+		uint32 BaseAge = Latest.Revision - Base->Revision;
+		Writer.SerializeInt(BaseAge, MaxBaseAge);
+	}
+
+	FVehicleNetState State = Latest;
+	State.Serialize(Writer, Base);
+
+	*DeltaParms.NewState = MakeShared<FVehicleMovementDeltaState>(Latest);
+	return true;
+}
+
+bool FVehicleMovementSnapshot::ReadDelta(FNetDeltaSerializeInfo& DeltaParms)
+{
+	using namespace VehicleMovement;
+
+	FBitReader& Reader = *DeltaParms.Reader;
+	const int64 StartBits = Reader.GetPosBits();
+
+	const bool bFull = SerializeFlag(Reader, false);
+	uint16 Revision = 0;
+	Reader << Revision;
+	uint16 TimeMs = 0;
+	Reader << TimeMs;
+
+	const FVehicleNetState* Base = nullptr;
+	if (!bFull)
+	{
+		uint32 BaseAge = 0;
+		Reader.SerializeInt(BaseAge, MaxBaseAge);
+
+		const uint16 BaseRevision = static_cast<uint16>(Revision - BaseAge);
+		const int32 Slot = BaseRevision % HistorySize;
+		if ((HistoryValid & (1u << Slot)) != 0 && static_cast<uint16>(History[Slot].Revision) == BaseRevision)
+		{
+			Base = &History[Slot];
+		}
+	}
+
+	// A delta against a state that never arrived is still read through, then dropped. The server moves its base
+	// back to an acknowledged state once it learns of the loss, and sends full states past MaxBaseAge regardless.
+	static const FVehicleNetState MissingBase;
+	FVehicleNetState State;
+	State.Serialize(Reader, bFull ? nullptr : (Base ? Base : &MissingBase));
+	State.Revision = Revision;
+	State.TimeMs = TimeMs;
+	PendingBits += Reader.GetPosBits() - StartBits;
+
+	if (Reader.IsError())
+	{
+		return false;
+	}
+
+	if (bFull || Base)
+	{
+		History.SetNum(HistorySize);
+		const int32 Slot = Revision % HistorySize;
+		History[Slot] = State;
+		HistoryValid |= 1u << Slot;
+
+		Latest = State;
+		bHasState = true;
+		bHasPendingState = true;
+	}
+	return true;
+}
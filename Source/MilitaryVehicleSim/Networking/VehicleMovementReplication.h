@@ -0,0 +1,148 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "Engine/NetSerialization.h"
+#include "VehicleMovementReplication.generated.h"
+
+class UChaosWheeledVehicleMovementComponent;
+struct FRepMovement;
+
+namespace VehicleMovement
+{
+	/** Wheels carried in the suspension summary; any beyond this are left out. */
+	static constexpr int32 MaxWheels = 16;
+
+	/** Deltas are only encoded against states at most this many revisions old, so the client's history always has them. */
+	static constexpr int32 MaxBaseAge = 16;
+	static constexpr int32 HistorySize = 32;
+}
+
+/** A vehicle's hull state, quantized; what goes over the wire is exactly this. */
+struct FVehicleNetState
+{
+	/** World position in quarter centimetres. Sent as a 14-bit offset inside its grid cell, or as a delta. */
+	FIntVector Position = FIntVector::ZeroValue;
+
+	/** Smallest-three quaternion: index of the dropped component and the other three at 11 bits each. */
+	uint8 RotationLargest = 3;
+	uint16 Rotation[3] = {};
+
+	/** Linear velocity in 2 cm/s steps. */
+	int16 LinearVelocity[3] = {};
+
+	/** Angular velocity in quarter degrees per second. */
+	int16 AngularVelocity[3] = {};
+
+	bool bAsleep = false;
+
+	/** Normalized suspension length per wheel, 0-255. */
+	uint8 NumWheels = 0;
+	uint8 Suspension[VehicleMovement::MaxWheels] = {};
+
+	/** Mean wheel angular velocity, in sixteenths. */
+	int16 WheelSpeed = 0;
+
+	/** Server: bumped whenever the quantized state changes. Only the low 16 bits are sent. */
+	uint32 Revision = 0;
+
+	/** Server time of the capture, as SnapshotInterpolation::WrapServerTimeMs. Sent with every state. */
+	uint16 TimeMs = 0;
+
+	void Capture(const FRigidBodyState& BodyState, const UChaosWheeledVehicleMovementComponent* Movement);
+	void ToRepMovement(FRepMovement& OutMovement) const;
+
+	FVector GetLocation() const;
+	FQuat GetRotation() const;
+	float GetSuspension(int32 WheelIndex) const { return WheelIndex < NumWheels ? Suspension[WheelIndex] / 255.0f : 0.0f; }
+	float GetWheelSpeed() const { return WheelSpeed / 16.0f; }
+
+	/** Same quantized values, ignoring the revision and time. */
+	bool HasSameValues(const FVehicleNetState& Other) const;
+
+	/** True if this state moved far enough from Base, by mvs.VehicleMovement.* thresholds, to be worth sending. */
+	bool ExceedsThresholds(const FVehicleNetState& Base) const;
+
+	/** Writes or reads this state, delta-coded against Base when there is one. */
+	void Serialize(FArchive& Ar, const FVehicleNetState* Base);
+};
+
+/**
+ * Compact replacement for FRepMovement on vehicles. The server captures the hull once per replication into a
+ * quantized FVehicleNetState, and each connection is sent a delta against the last state it acknowledged, which
+ * the engine tracks per connection through the delta base state. Nothing is sent until the vehicle has moved past
+ * the mvs.VehicleMovement.* thresholds from that base. Clients keep a short history of received states to decode
+ * deltas against and apply each one through the engine's replicated movement path.
+ */
+USTRUCT()
+struct MILITARYVEHICLESIM_API FVehicleMovementSnapshot
+{
+	GENERATED_BODY()
+
+	/**
+	 * Server: quantizes the current hull state, stamped with ServerTime; returns true if it differs from the last
+	 * capture. An unchanged state keeps its original stamp.
+	 */
+	bool Capture(const FRigidBodyState& BodyState, const UChaosWheeledVehicleMovementComponent* Movement, double ServerTime);
+
+	/** Client: takes the newest state received since the last call and the bits it took. */
+	bool ConsumeReceived(FVehicleNetState& OutState, int64& OutBits);
+
+	/** Newest state captured on the server, or received on a client. */
+	const FVehicleNetState& GetLatest() const { return Latest; }
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms);
+
+private:
+	bool WriteDelta(FNetDeltaSerializeInfo& DeltaParms) const;
+	bool ReadDelta(FNetDeltaSerializeInfo& DeltaParms);
+
+	FVehicleNetState Latest;
+	bool bHasState = false;
+
+	// Client: received states by revision, to decode deltas against
+	TArray<FVehicleNetState> History;
+	uint32 HistoryValid = 0;
+	bool bHasPendingState = false;
+	int64 PendingBits = 0;
+};
+
+template<>
+struct TStructOpsTypeTraits<FVehicleMovementSnapshot> : public TStructOpsTypeTraitsBase2<FVehicleMovementSnapshot>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+/** Received movement bytes for both vehicle movement replication paths, on this machine. */
+USTRUCT(BlueprintType)
+struct MILITARYVEHICLESIM_API FVehicleMovementNetStats
+{
+	GENERATED_BODY()
+
+	/** FRepMovement updates received, and their payload bits under the engine's own encoding. */
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle Movement Replication")
+	int32 StockUpdates = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle Movement Replication")
+	int64 StockBits = 0;
+
+	/** FVehicleMovementSnapshot updates received, and their payload bits. */
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle Movement Replication")
+	int32 CompactUpdates = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle Movement Replication")
+	int64 CompactBits = 0;
+
+	/** World time the counters started from. */
+	double StartTime = 0.0;
+
+	void Reset(double Now) { *this = FVehicleMovementNetStats(); StartTime = Now; }
+
+	float GetStockBytesPerSecond(double Now) const { return Now > StartTime ? StockBits / 8.0f / static_cast<float>(Now - StartTime) : 0.0f; }
+	float GetCompactBytesPerSecond(double Now) const { return Now > StartTime ? CompactBits / 8.0f / static_cast<float>(Now - StartTime) : 0.0f; }
+};
@@ -0,0 +1,489 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BallisticsSubsystem.h"
+
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/AutomationTest.h"
+#include "Tests/AutomationCommon.h"
+#include "MilitaryVehicleSim/MilitaryVehicleSim.h"
+#include "MilitaryVehicleSim/Components/DamageQueueSubsystem.h"
+#include "MilitaryVehicleSim/Components/DamageReceiverRegistry.h"
+#include "MilitaryVehicleSim/Components/HealthComponent.h"
+#include "MilitaryVehicleSim/Diagnostics/CombatStats.h"
+#include "MilitaryVehicleSim/Networking/ProjectileShotSubsystem.h"
+#include "MilitaryVehicleSim/Projectiles/ProjectileBase.h"
+#include "MilitaryVehicleSim/Vehicles/MilitaryVehicleBase.h"
+
+static TAutoConsoleVariable<int32> CVarBallisticsMaxRounds(
+	TEXT("mvs.Ballistics.MaxRounds"),
+	16384,
+	TEXT("Maximum number of lightweight rounds simulated at once. New rounds are dropped past this budget."));
+
+static TAutoConsoleVariable<int32> CVarBallisticsTraceBatchSize(
+	TEXT("mvs.Ballistics.TraceBatchSize"),
+	128,
+	TEXT("Number of round segments traced per worker task."));
+
+static FAutoConsoleCommandWithWorldAndArgs BallisticsBenchmarkCommand(
+	TEXT("mvs.Ballistics.Benchmark"),
+	TEXT("Steps N zero-damage rounds through integration and segment traces and logs the cost per frame. Optional arg: count (default 10000)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UBallisticsSubsystem* Ballistics = World ? World->GetSubsystem<UBallisticsSubsystem>() : nullptr)
+		{
+			Ballistics->RunBenchmark(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10000);
+		}
+	}));
+
+void FBallisticRoundBuffers::Add(const FVector& Position, const FVector& Velocity, float InGravityScale, float InDamage, float InPenetration, float InLifeSpan, float InRewindSeconds, AActor* InOwner, uint16 InShotId, float InCatchUpTime, int32 InSplashType)
+{
+	PosX.Add(Position.X);
+	PosY.Add(Position.Y);
+	PosZ.Add(Position.Z);
+	VelX.Add(Velocity.X);
+	VelY.Add(Velocity.Y);
+	VelZ.Add(Velocity.Z);
+	GravityScale.Add(InGravityScale);
+	Damage.Add(InDamage);
+	Penetration.Add(InPenetration);
+	TimeRemaining.Add(InLifeSpan);
+	RewindSeconds.Add(InRewindSeconds);
+	Owner.Add(InOwner);
+	ShotId.Add(InShotId);
+	CatchUpTime.Add(InCatchUpTime);
+	SplashType.Add(InSplashType);
+}
+
+void FBallisticRoundBuffers::RemoveAtSwap(int32 Index)
+{
+	PosX.RemoveAtSwap(Index, 1, false);
+	PosY.RemoveAtSwap(Index, 1, false);
+	PosZ.RemoveAtSwap(Index, 1, false);
+	VelX.RemoveAtSwap(Index, 1, false);
+	VelY.RemoveAtSwap(Index, 1, false);
+	VelZ.RemoveAtSwap(Index, 1, false);
+	GravityScale.RemoveAtSwap(Index, 1, false);
+	Damage.RemoveAtSwap(Index, 1, false);
+	Penetration.RemoveAtSwap(Index, 1, false);
+	TimeRemaining.RemoveAtSwap(Index, 1, false);
+	RewindSeconds.RemoveAtSwap(Index, 1, false);
+	Owner.RemoveAtSwap(Index, 1, false);
+	ShotId.RemoveAtSwap(Index, 1, false);
+	CatchUpTime.RemoveAtSwap(Index, 1, false);
+	SplashType.RemoveAtSwap(Index, 1, false);
+}
+
+void FBallisticRoundBuffers::Reserve(int32 Count)
+{
+	PosX.Reserve(Count);
+	PosY.Reserve(Count);
+	PosZ.Reserve(Count);
+	VelX.Reserve(Count);
+	VelY.Reserve(Count);
+	VelZ.Reserve(Count);
+	GravityScale.Reserve(Count);
+	Damage.Reserve(Count);
+	Penetration.Reserve(Count);
+	TimeRemaining.Reserve(Count);
+	RewindSeconds.Reserve(Count);
+	Owner.Reserve(Count);
+	ShotId.Reserve(Count);
+	CatchUpTime.Reserve(Count);
+	SplashType.Reserve(Count);
+}
+
+void FBallisticRoundBuffers::Reset()
+{
+	PosX.Reset();
+	PosY.Reset();
+	PosZ.Reset();
+	VelX.Reset();
+	VelY.Reset();
+	VelZ.Reset();
+	GravityScale.Reset();
+	Damage.Reset();
+	Penetration.Reset();
+	TimeRemaining.Reset();
+	RewindSeconds.Reset();
+	Owner.Reset();
+	ShotId.Reset();
+	CatchUpTime.Reset();
+	SplashType.Reset();
+}
+
+bool UBallisticsSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UBallisticsSubsystem::Deinitialize()
+{
+	Rounds.Reset();
+	SplashTypes.Reset();
+	SplashTypeByClass.Reset();
+	Super::Deinitialize();
+}
+
+TStatId UBallisticsSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UBallisticsSubsystem, STATGROUP_Tickables);
+}
+
+bool UBallisticsSubsystem::FireRound(const AProjectileBase* ProjectileDefaults, const FVector& Location, const FVector& Direction, float Damage, AActor* Owner, uint16 ShotId, float ShotAge)
+{
+	if (!ProjectileDefaults)
+	{
+		return false;
+	}
+
+	const int32 MaxRounds = CVarBallisticsMaxRounds.GetValueOnGameThread();
+	if (Rounds.Num() >= MaxRounds)
+	{
+		UE_LOG(LogMilitaryVehicle, Verbose, TEXT("Ballistics round budget (%d) exhausted, dropping round"), MaxRounds);
+		return false;
+	}
+
+	if (Rounds.Num() == 0)
+	{
+		// Size for a sustained engagement up front instead of growing shot by shot
+		Rounds.Reserve(FMath::Min(MaxRounds, 1024));
+	}
+
+	float RewindSeconds = 0.0f;
+	if (const ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+	{
+		RewindSeconds = LagCompensation->GetRewindSeconds(Owner);
+	}
+
+	Rounds.Add(Location, Direction.GetSafeNormal() * ProjectileDefaults->GetInitialSpeed(), ProjectileDefaults->GetGravityScale(),
+		Damage, ProjectileDefaults->GetPenetration(), ProjectileDefaults->GetProjectileLifeSpan(), RewindSeconds, Owner, ShotId, FMath::Max(ShotAge, 0.0f), FindOrAddSplashType(ProjectileDefaults));
+	return true;
+}
+
+int32 UBallisticsSubsystem::FindOrAddSplashType(const AProjectileBase* ProjectileDefaults)
+{
+	if (!ProjectileDefaults->HasSplashDamage())
+	{
+		return INDEX_NONE;
+	}
+
+	if (const int32* Existing = SplashTypeByClass.Find(ProjectileDefaults->GetClass()))
+	{
+		return *Existing;
+	}
+
+	FSplashType& Type = SplashTypes.AddDefaulted_GetRef();
+	Type.Params = ProjectileDefaults->GetSplashDamage();
+	Type.bAirburst = ProjectileDefaults->IsAirburst();
+	return SplashTypeByClass.Add(ProjectileDefaults->GetClass(), SplashTypes.Num() - 1);
+}
+
+void UBallisticsSubsystem::Detonate(int32 Index, const FVector& Location) const
+{
+	if (UDamageQueueSubsystem* DamageQueue = GetWorld()->GetSubsystem<UDamageQueueSubsystem>())
+	{
+		DamageQueue->QueueRadialDamage(Location, SplashTypes[Rounds.SplashType[Index]].Params, Rounds.Owner[Index].Get());
+	}
+}
+
+void UBallisticsSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	CombatStats::SetLiveRounds(Rounds.Num());
+	if (Rounds.Num() == 0 || DeltaTime <= 0.0f)
+	{
+		return;
+	}
+
+	Integrate(DeltaTime);
+	TraceSegments();
+	ValidateLagCompensatedSegments();
+	ResolveImpacts();
+}
+
+void UBallisticsSubsystem::Integrate(float DeltaTime)
+{
+	const int32 NumRounds = Rounds.Num();
+	const float GravityZ = GetWorld()->GetGravityZ();
+
+	SegmentStarts.SetNumUninitialized(NumRounds, false);
+	for (int32 Index = 0; Index < NumRounds; ++Index)
+	{
+		SegmentStarts[Index] = FVector(Rounds.PosX[Index], Rounds.PosY[Index], Rounds.PosZ[Index]);
+	}
+
+	// Rounds fired this frame also make up for the time they were due before it
+	StepTimes.SetNumUninitialized(NumRounds, false);
+	float* RESTRICT Steps = StepTimes.GetData();
+	float* RESTRICT CatchUp = Rounds.CatchUpTime.GetData();
+	for (int32 Index = 0; Index < NumRounds; ++Index)
+	{
+		Steps[Index] = DeltaTime + CatchUp[Index];
+		CatchUp[Index] = 0.0f;
+	}
+
+	// Semi-implicit Euler, one flat loop per component so the compiler can vectorize each of them
+	float* RESTRICT VelZ = Rounds.VelZ.GetData();
+	const float* RESTRICT Gravity = Rounds.GravityScale.GetData();
+	for (int32 Index = 0; Index < NumRounds; ++Index)
+	{
+		VelZ[Index] += GravityZ * Gravity[Index] * Steps[Index];
+	}
+
+	double* RESTRICT PosX = Rounds.PosX.GetData();
+	double* RESTRICT PosY = Rounds.PosY.GetData();
+	double* RESTRICT PosZ = Rounds.PosZ.GetData();
+	const float* RESTRICT VelX = Rounds.VelX.GetData();
+	const float* RESTRICT VelY = Rounds.VelY.GetData();
+	for (int32 Index = 0; Index < NumRounds; ++Index)
+	{
+		PosX[Index] += VelX[Index] * Steps[Index];
+		PosY[Index] += VelY[Index] * Steps[Index];
+		PosZ[Index] += VelZ[Index] * Steps[Index];
+	}
+
+	float* RESTRICT TimeRemaining = Rounds.TimeRemaining.GetData();
+	for (int32 Index = 0; Index < NumRounds; ++Index)
+	{
+		TimeRemaining[Index] -= Steps[Index];
+	}
+}
+
+void UBallisticsSubsystem::TraceSegments()
+{
+	const int32 NumRounds = Rounds.Num();
+	const int32 BatchSize = FMath::Max(1, CVarBallisticsTraceBatchSize.GetValueOnGameThread());
+	const int32 NumBatches = FMath::DivideAndRoundUp(NumRounds, BatchSize);
+
+	HitResults.SetNum(NumRounds, false);
+	HitFlags.SetNumUninitialized(NumRounds, false);
+
+	const UWorld* World = GetWorld();
+
+	IgnoredOwners.SetNumUninitialized(NumRounds, false);
+	for (int32 Index = 0; Index < NumRounds; ++Index)
+	{
+		IgnoredOwners[Index] = Rounds.Owner[Index].Get();
+	}
+
+	// Compensated rounds skip vehicles here; those hits come from the rewound poses instead
+	FCollisionResponseParams CompensatedResponse;
+	CompensatedResponse.CollisionResponse.SetResponse(ECC_Vehicle, ECR_Ignore);
+
+	// Scene queries are read-only, so batches can be traced on worker threads like the engine's async traces
+	ParallelFor(NumBatches, [this, World, NumRounds, BatchSize, &CompensatedResponse](int32 BatchIndex)
+	{
+		const int32 First = BatchIndex * BatchSize;
+		const int32 Last = FMath::Min(First + BatchSize, NumRounds);
+
+		FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(BallisticsSegmentTrace), false);
+		for (int32 Index = First; Index < Last; ++Index)
+		{
+			QueryParams.ClearIgnoredActors();
+			QueryParams.AddIgnoredActor(IgnoredOwners[Index]);
+
+			const FVector End(Rounds.PosX[Index], Rounds.PosY[Index], Rounds.PosZ[Index]);
+			const FCollisionResponseParams& ResponseParams = Rounds.RewindSeconds[Index] > 0.0f ? CompensatedResponse : FCollisionResponseParams::DefaultResponseParam;
+			HitFlags[Index] = World->LineTraceSingleByChannel(HitResults[Index], SegmentStarts[Index], End, ECC_Projectile, QueryParams, ResponseParams);
+		}
+	});
+}
+
+void UBallisticsSubsystem::ValidateLagCompensatedSegments()
+{
+	const int32 NumRounds = Rounds.Num();
+	CompensatedHitIndex.Init(INDEX_NONE, NumRounds);
+	CompensatedRounds.Reset();
+	CompensatedShots.Reset();
+	CompensatedHits.Reset();
+
+	ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>();
+	if (!LagCompensation)
+	{
+		return;
+	}
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	for (int32 Index = 0; Index < NumRounds; ++Index)
+	{
+		if (Rounds.RewindSeconds[Index] > 0.0f)
+		{
+			const FVector End(Rounds.PosX[Index], Rounds.PosY[Index], Rounds.PosZ[Index]);
+			CompensatedShots.Add({ SegmentStarts[Index], End, Now - Rounds.RewindSeconds[Index], Rounds.Owner[Index].Get() });
+			CompensatedRounds.Add(Index);
+		}
+	}
+
+	LagCompensation->ValidateShots(CompensatedShots, CompensatedHits);
+
+	for (int32 HitIndex = 0; HitIndex < CompensatedHits.Num(); ++HitIndex)
+	{
+		CompensatedHitIndex[CompensatedRounds[CompensatedHits[HitIndex].ShotIndex]] = HitIndex;
+	}
+}
+
+void UBallisticsSubsystem::ResolveImpacts()
+{
+	const UProjectileShotSubsystem* ShotSubsystem = GetWorld()->GetSubsystem<UProjectileShotSubsystem>();
+	const UDamageReceiverRegistry* Registry = GetWorld()->GetSubsystem<UDamageReceiverRegistry>();
+
+	// Walk backwards so RemoveAtSwap only ever pulls in rounds that were already handled
+	for (int32 Index = Rounds.Num() - 1; Index >= 0; --Index)
+	{
+		// A rewound vehicle hit wins when it is closer along the segment than the world hit
+		AActor* HitActor = HitFlags[Index] ? HitResults[Index].GetActor() : nullptr;
+		FVector ImpactLocation = HitResults[Index].ImpactPoint;
+		const FLagCompensatedHit* CompensatedHit = nullptr;
+		if (CompensatedHitIndex[Index] != INDEX_NONE)
+		{
+			const FLagCompensatedHit& Candidate = CompensatedHits[CompensatedHitIndex[Index]];
+			if (!HitFlags[Index] || Candidate.Time <= HitResults[Index].Time)
+			{
+				CompensatedHit = &Candidate;
+				HitActor = Candidate.Vehicle;
+				ImpactLocation = Candidate.Location;
+				HitFlags[Index] = true;
+			}
+		}
+
+		if (HitFlags[Index])
+		{
+			CombatStats::Count(this, CombatStats::EEvent::Hit);
+			AActor* OwnerActor = Rounds.Owner[Index].Get();
+			if (HitActor && HitActor != OwnerActor)
+			{
+				if (UHealthComponent* HealthComp = Registry ? Registry->FindHealthComponent(HitActor) : nullptr)
+				{
+					float Damage = Rounds.Damage[Index];
+					if (const AMilitaryVehicleBase* Vehicle = Cast<AMilitaryVehicleBase>(HitActor))
+					{
+						// Compensated hits were already expressed against the rewound hull
+						const FVector Velocity(Rounds.VelX[Index], Rounds.VelY[Index], Rounds.VelZ[Index]);
+						const FArmorHit ArmorHit = CompensatedHit ? CompensatedHit->ArmorHit
+							: Vehicle->MakeArmorHit(ImpactLocation, Velocity, HitResults[Index].ImpactNormal, HitResults[Index].GetComponent());
+						Damage = Vehicle->ResolveArmorDamage(ArmorHit, Damage, Rounds.Penetration[Index]);
+					}
+					HealthComp->ApplyDamage(Damage, OwnerActor);
+				}
+			}
+			if (Rounds.SplashType[Index] != INDEX_NONE)
+			{
+				Detonate(Index, ImpactLocation);
+			}
+			if (ShotSubsystem)
+			{
+				ShotSubsystem->BroadcastImpact(OwnerActor, Rounds.ShotId[Index], ImpactLocation);
+			}
+			Rounds.RemoveAtSwap(Index);
+		}
+		else if (Rounds.TimeRemaining[Index] <= 0.0f)
+		{
+			const int32 SplashType = Rounds.SplashType[Index];
+			if (SplashType != INDEX_NONE && SplashTypes[SplashType].bAirburst)
+			{
+				const FVector Location(Rounds.PosX[Index], Rounds.PosY[Index], Rounds.PosZ[Index]);
+				Detonate(Index, Location);
+				if (ShotSubsystem)
+				{
+					ShotSubsystem->BroadcastImpact(Rounds.Owner[Index].Get(), Rounds.ShotId[Index], Location);
+				}
+			}
+			Rounds.RemoveAtSwap(Index);
+		}
+	}
+}
+
+double UBallisticsSubsystem::RunBenchmark(int32 Count)
+{
+	static constexpr int32 NumFrames = 10;
+	static constexpr float FrameTime = 1.0f / 30.0f;
+
+	// Rounds from all over a 400 m square at typical cannon speed, angled down so some of them reach the ground
+	Count = FMath::Max(1, Count);
+	FBallisticRoundBuffers BenchmarkRounds;
+	BenchmarkRounds.Reserve(Count);
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		const FVector Location(FMath::FRandRange(-20000.0f, 20000.0f), FMath::FRandRange(-20000.0f, 20000.0f), FMath::FRandRange(200.0f, 2000.0f));
+		const FVector Direction = FVector(FMath::FRandRange(-1.0f, 1.0f), FMath::FRandRange(-1.0f, 1.0f), FMath::FRandRange(-0.3f, 0.05f)).GetSafeNormal();
+		BenchmarkRounds.Add(Location, Direction * 80000.0f, 1.0f, 0.0f, 0.0f, NumFrames * FrameTime * 2.0f, 0.0f, nullptr, 0, 0.0f, INDEX_NONE);
+	}
+
+	// The live rounds sit the benchmark out and come back untouched
+	Swap(Rounds, BenchmarkRounds);
+	int32 NumHits = 0;
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		Integrate(FrameTime);
+		TraceSegments();
+		for (const bool bHit : HitFlags)
+		{
+			NumHits += bHit ? 1 : 0;
+		}
+	}
+	const double MsPerFrame = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumFrames;
+	Swap(Rounds, BenchmarkRounds);
+
+	UE_LOG(LogMilitaryVehicle, Log, TEXT("Ballistics benchmark: %d rounds, %d frames, %d segment hits, %.3f ms per frame"),
+		Count, NumFrames, NumHits, MsPerFrame);
+	return MsPerFrame;
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	/** Runs the ballistics benchmark on the loaded game world and fails when a frame of rounds exceeds the budget. */
+	class FBallisticsBenchmarkCommand : public IAutomationLatentCommand
+	{
+	public:
+		FBallisticsBenchmarkCommand(int32 InNumRounds, double InBudgetMs, FAutomationTestBase* InTest)
+			: NumRounds(InNumRounds)
+			, BudgetMs(InBudgetMs)
+			, Test(InTest)
+		{
+		}
+
+		virtual bool Update() override
+		{
+			UWorld* World = AutomationCommon::GetAnyGameWorld();
+			UBallisticsSubsystem* Ballistics = World ? World->GetSubsystem<UBallisticsSubsystem>() : nullptr;
+			if (!Ballistics)
+			{
+				Test->AddError(TEXT("No game world with a ballistics subsystem"));
+				return true;
+			}
+
+			const double MsPerFrame = Ballistics->RunBenchmark(NumRounds);
+			if (MsPerFrame > BudgetMs)
+			{
+				Test->AddError(FString::Printf(TEXT("%d rounds took %.3f ms per frame, over the %.1f ms budget"), NumRounds, MsPerFrame, BudgetMs));
+			}
+			return true;
+		}
+
+	private:
+		int32 NumRounds;
+		double BudgetMs;
+		FAutomationTestBase* Test;
+	};
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBallisticsBenchmarkTest, "MilitaryVehicleSim.Perf.Ballistics",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FBallisticsBenchmarkTest::RunTest(const FString& Parameters)
+{
+	// The lightweight round goal: 10k rounds in flight within 2 ms of server frame
+	AutomationOpenMap(TEXT("/Game/NewMap"), true);
+	ADD_LATENT_AUTOMATION_COMMAND(FBallisticsBenchmarkCommand(10000, 2.0, this));
+	return true;
+}
+
+#endif
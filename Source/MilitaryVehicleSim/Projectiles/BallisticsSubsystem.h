@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "MilitaryVehicleSim/Networking/LagCompensationSubsystem.h"
+#include "BallisticsSubsystem.generated.h"
+
+class AProjectileBase;
+
+/**
+ * Struct-of-arrays storage for lightweight rounds.
+ * Every array holds one entry per live round at the same index.
+ */
+struct FBallisticRoundBuffers
+{
+	TArray<double> PosX;
+	TArray<double> PosY;
+	TArray<double> PosZ;
+	TArray<float> VelX;
+	TArray<float> VelY;
+	TArray<float> VelZ;
+	TArray<float> GravityScale;
+	TArray<float> Damage;
+	/** Armor penetration in millimetres, see AProjectileBase::Penetration. */
+	TArray<float> Penetration;
+	TArray<float> TimeRemaining;
+	/** Lag compensation for the shooter at fire time; zero when vehicles are hit at their current pose. */
+	TArray<float> RewindSeconds;
+	TArray<TWeakObjectPtr<AActor>> Owner;
+	/** Shot event id, echoed back to clients in the impact event. */
+	TArray<uint16> ShotId;
+	/** Time the round was due before it was fired, added to its first integration step. Zero afterwards. */
+	TArray<float> CatchUpTime;
+	/** Index into UBallisticsSubsystem's splash types, or INDEX_NONE for purely kinetic rounds. */
+	TArray<int32> SplashType;
+
+	int32 Num() const { return PosX.Num(); }
+
+	void Add(const FVector& Position, const FVector& Velocity, float InGravityScale, float InDamage, float InPenetration, float InLifeSpan, float InRewindSeconds, AActor* InOwner, uint16 InShotId, float InCatchUpTime, int32 InSplashType);
+	void RemoveAtSwap(int32 Index);
+	void Reserve(int32 Count);
+	void Reset();
+};
+
+/**
+ * Simulates rounds of projectile classes flagged bUseLightweightSimulation without spawning actors.
+ * Each frame integrates all rounds in one pass over the SoA buffers, traces every travelled segment
+ * in parallel batches, then applies impacts through UHealthComponent::ApplyDamage on the game thread,
+ * which queues them for UDamageQueueSubsystem to resolve after all actors and tickables. Vehicle hits are first
+ * scaled by the vehicle's armor zones. Splash rounds also
+ * queue a detonation there on impact, and airburst rounds when their lifespan runs out.
+ * Rounds from lagged shooters test vehicles through ULagCompensationSubsystem in one batch per frame.
+ * Clients only ever see these rounds through UProjectileShotSubsystem's shot and impact events.
+ * Server only.
+ */
+UCLASS()
+class MILITARYVEHICLESIM_API UBallisticsSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/**
+	 * Adds a round using the speed, gravity and lifespan of the given projectile defaults. Returns false if the round budget is full.
+	 * ShotAge is how long ago the shot was due; the round covers that distance, with traces, on its first step.
+	 */
+	bool FireRound(const AProjectileBase* ProjectileDefaults, const FVector& Location, const FVector& Direction, float Damage, AActor* Owner, uint16 ShotId = 0, float ShotAge = 0.0f);
+
+	UFUNCTION(BlueprintCallable, Category = "Ballistics")
+	int32 GetNumActiveRounds() const { return Rounds.Num(); }
+
+	/**
+	 * Steps Count harmless rounds, in place of the live ones, through integration and the segment traces for a few
+	 * frames, logs the cost and returns the mean milliseconds per frame. Impacts are not resolved.
+	 */
+	double RunBenchmark(int32 Count);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	void Integrate(float DeltaTime);
+	void TraceSegments();
+	void ValidateLagCompensatedSegments();
+	void ResolveImpacts();
+
+	/** Splash settings of a projectile class, shared by all of its rounds. */
+	struct FSplashType
+	{
+		FRadialDamageParams Params;
+		bool bAirburst = false;
+	};
+
+	int32 FindOrAddSplashType(const AProjectileBase* ProjectileDefaults);
+	void Detonate(int32 Index, const FVector& Location) const;
+
+	FBallisticRoundBuffers Rounds;
+
+	TArray<FSplashType> SplashTypes;
+	TMap<TObjectKey<UClass>, int32> SplashTypeByClass;
+
+	// Per-frame scratch, kept to avoid reallocating every tick
+	TArray<FVector> SegmentStarts;
+	/** Owners resolved on the game thread, so the worker traces never touch the weak pointers. */
+	TArray<const AActor*> IgnoredOwners;
+	TArray<float> StepTimes;
+	TArray<FHitResult> HitResults;
+	TArray<bool> HitFlags;
+	TArray<int32> CompensatedRounds;
+	TArray<FLagCompensatedShot> CompensatedShots;
+	TArray<FLagCompensatedHit> CompensatedHits;
+	/** Index into CompensatedHits per round, or INDEX_NONE. */
+	TArray<int32> CompensatedHitIndex;
+};
@@ -2,8 +2,20 @@
 #include "Components/SphereComponent.h"
 #include "Components/StaticMeshComponent.h"
 #include "GameFramework/ProjectileMovementComponent.h"
+#include "MilitaryVehicleSim/Components/DamageQueueSubsystem.h"
+#include "MilitaryVehicleSim/Components/DamageReceiverRegistry.h"
 #include "MilitaryVehicleSim/Components/HealthComponent.h"
+#include "MilitaryVehicleSim/Diagnostics/CombatStats.h"
+#include "MilitaryVehicleSim/Networking/LagCompensationSubsystem.h"
+#include "MilitaryVehicleSim/Networking/ProjectileShotSubsystem.h"
+#include "MilitaryVehicleSim/Projectiles/ProjectilePoolSubsystem.h"
+#include "MilitaryVehicleSim/Projectiles/ProjectileVisualSubsystem.h"
+#include "MilitaryVehicleSim/Vehicles/MilitaryVehicleBase.h"
+#include "Net/DataBunch.h"
 #include "Net/UnrealNetwork.h"
+#include "TimerManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Projectile OnProjectileHit"), STAT_MVS_OnProjectileHit, STATGROUP_MilitaryVehicle);
 
 AProjectileBase::AProjectileBase()
 {
@@ -37,6 +49,21 @@ AProjectileBase::AProjectileBase()
 	GravityScale = 1.0f;
 	Damage = 30.0f;
 	LifeSpan = 10.0f;
+	Penetration = 0.0f;
+
+	bUseLightweightSimulation = false;
+	bReplicateAsShotEvent = false;
+	bAirburst = false;
+	bUseInstancedVisuals = false;
+	DispersionDegrees = 0.0f;
+	PoolPrewarmCount = 16;
+	PoolMaxSize = 128;
+	bInFlight = false;
+	bIsPooled = false;
+	bCosmeticOnly = false;
+	ShotId = 0;
+	bLagCompensated = false;
+	VehicleResponseBeforeCompensation = ECR_Block;
 }
 
 void AProjectileBase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
@@ -44,37 +71,44 @@ void AProjectileBase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutL
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
 	DOREPLIFETIME(AProjectileBase, Damage);
+	DOREPLIFETIME(AProjectileBase, bInFlight);
+	DOREPLIFETIME_CONDITION(AProjectileBase, PredictedShot, COND_OwnerOnly);
 }
 
-void AProjectileBase::BeginPlay()
+void AProjectileBase::PostInitProperties()
 {
-	Super::BeginPlay();
+	Super::PostInitProperties();
 
-	// Set up collision ignore for owner immediately on server
-	if (HasAuthority())
+	// Shot-event rounds are simulated separately on each machine
+	if (bReplicateAsShotEvent)
 	{
-		if (AActor* OwnerActor = GetOwner())
-		{
-			if (UPrimitiveComponent* ProjectileRoot = Cast<UPrimitiveComponent>(GetRootComponent()))
-			{
-				TArray<UPrimitiveComponent*> OwnerComponents;
-				OwnerActor->GetComponents<UPrimitiveComponent*>(OwnerComponents);
-				for (UPrimitiveComponent* Comp : OwnerComponents)
-				{
-					ProjectileRoot->IgnoreComponentWhenMoving(Comp, true);
-				}
-			}
-		}
+		bReplicates = false;
 	}
+}
 
-	// Set lifespan for cleanup
-	SetLifeSpan(LifeSpan);
+void AProjectileBase::BeginPlay()
+{
+	Super::BeginPlay();
 
-	// Apply gravity scale
-	if (ProjectileMovement)
+	SetupInstancedVisuals();
+
+	// Pooled rounds are spawned parked and only start flying when the pool launches them.
+	// Client copies follow the replicated flight state instead.
+	if (bIsPooled || (!HasAuthority() && !bInFlight))
 	{
-		ProjectileMovement->ProjectileGravityScale = GravityScale;
+		StopFlight();
+		return;
 	}
+
+	StartFlight();
+}
+
+void AProjectileBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	SetCountedAsLive(false);
+	ReleasePredictedRound();
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void AProjectileBase::PostNetInit()
@@ -84,34 +118,278 @@ void AProjectileBase::PostNetInit()
 	// On client, PostNetInit is called after properties like Owner have been replicated
 	if (!HasAuthority())
 	{
-		if (AActor* OwnerActor = GetOwner())
+		IgnoreOwnerWhenMoving(GetOwner());
+	}
+}
+
+void AProjectileBase::PostNetReceive()
+{
+	Super::PostNetReceive();
+
+	if (UProjectileShotSubsystem* ShotSubsystem = GetWorld()->GetSubsystem<UProjectileShotSubsystem>())
+	{
+		ShotSubsystem->RecordReplicatedProjectileUpdate();
+	}
+}
+
+void AProjectileBase::OnActorChannelOpen(FInBunch& InBunch, UNetConnection* Connection)
+{
+	Super::OnActorChannelOpen(InBunch, Connection);
+
+	if (UProjectileShotSubsystem* ShotSubsystem = GetWorld()->GetSubsystem<UProjectileShotSubsystem>())
+	{
+		ShotSubsystem->RecordReplicatedProjectileOpen();
+	}
+}
+
+void AProjectileBase::PostNetReceiveVelocity(const FVector& NewVelocity)
+{
+	Super::PostNetReceiveVelocity(NewVelocity);
+
+	if (ProjectileMovement)
+	{
+		ProjectileMovement->Velocity = NewVelocity;
+	}
+}
+
+void AProjectileBase::InitializeVelocity(const FVector& Direction)
+{
+	if (ProjectileMovement)
+	{
+		ProjectileMovement->Velocity = Direction * InitialSpeed;
+	}
+}
+
+void AProjectileBase::CatchUp(float Seconds)
+{
+	// A hit during the catch-up ends the round through OnProjectileHit like any other
+	if (ProjectileMovement && bInFlight && Seconds > 0.0f)
+	{
+		ProjectileMovement->TickComponent(Seconds, LEVELTICK_All, nullptr);
+	}
+}
+
+void AProjectileBase::SetVelocity(const FVector& NewVelocity)
+{
+	if (ProjectileMovement)
+	{
+		ProjectileMovement->Velocity = NewVelocity;
+	}
+}
+
+void AProjectileBase::ActivateFromPool(const FVector& Location, const FRotator& Rotation, AActor* NewOwner, APawn* NewInstigator)
+{
+	SetOwner(NewOwner);
+	SetInstigator(NewInstigator);
+	SetActorLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::ResetPhysics);
+
+	// Restore per-class defaults; the firing ability overrides damage right after launch
+	Damage = GetDefault<AProjectileBase>(GetClass())->Damage;
+
+	SetNetDormancy(DORM_Awake);
+	StartFlight();
+}
+
+void AProjectileBase::DeactivateToPool()
+{
+	StopFlight();
+	SetInstigator(nullptr);
+
+	// Parked rounds don't need an open channel; the client copy stays around hidden for reuse
+	SetNetDormancy(DORM_DormantAll);
+}
+
+void AProjectileBase::StartFlight()
+{
+	bInFlight = true;
+	SetCountedAsLive(true);
+
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+	IgnoreOwnerWhenMoving(GetOwner());
+
+	if (ProjectileMovement)
+	{
+		ProjectileMovement->ProjectileGravityScale = GravityScale;
+		ProjectileMovement->SetUpdatedComponent(CollisionComponent);
+		ProjectileMovement->SetComponentTickEnabled(true);
+
+		// Client copies relaunched without a velocity update fall back to the muzzle direction
+		if (!HasAuthority() && ProjectileMovement->Velocity.IsNearlyZero())
+		{
+			ProjectileMovement->Velocity = GetActorForwardVector() * InitialSpeed;
+		}
+	}
+
+	if (!HasAuthority())
+	{
+		ClaimPredictedRound();
+	}
+
+	// Skipped while hidden, so a copy hiding behind its predicted round isn't drawn either
+	if (bInstancedVisuals)
+	{
+		if (UProjectileVisualSubsystem* Visuals = GetWorld()->GetSubsystem<UProjectileVisualSubsystem>())
 		{
-			if (UPrimitiveComponent* ProjectileRoot = Cast<UPrimitiveComponent>(GetRootComponent()))
+			Visuals->AddRound(this);
+		}
+	}
+
+	// Lifespan is server-driven; expiry goes through the same path as an impact
+	if (HasAuthority() && LifeSpan > 0.0f)
+	{
+		GetWorldTimerManager().SetTimer(LifeSpanTimerHandle, this, &AProjectileBase::OnLifeSpanExpired, LifeSpan, false);
+	}
+
+	// Rounds from lagged shooters hit vehicles where the shooter saw them, not where they are now
+	if (HasAuthority() && !bCosmeticOnly && !bLagCompensated)
+	{
+		if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+		{
+			const float RewindSeconds = LagCompensation->GetRewindSeconds(GetOwner());
+			if (RewindSeconds > 0.0f)
 			{
-				TArray<UPrimitiveComponent*> OwnerComponents;
-				OwnerActor->GetComponents<UPrimitiveComponent*>(OwnerComponents);
-				for (UPrimitiveComponent* Comp : OwnerComponents)
-				{
-					ProjectileRoot->IgnoreComponentWhenMoving(Comp, true);
-				}
+				bLagCompensated = true;
+				VehicleResponseBeforeCompensation = CollisionComponent->GetCollisionResponseToChannel(ECC_Vehicle);
+				CollisionComponent->SetCollisionResponseToChannel(ECC_Vehicle, ECR_Ignore);
+				LagCompensation->TrackProjectile(this, RewindSeconds);
 			}
 		}
 	}
 }
 
-void AProjectileBase::InitializeVelocity(const FVector& Direction)
+void AProjectileBase::StopFlight()
 {
+	bInFlight = false;
+	SetCountedAsLive(false);
+	ReleasePredictedRound();
+
+	GetWorldTimerManager().ClearTimer(LifeSpanTimerHandle);
+
+	if (bLagCompensated)
+	{
+		bLagCompensated = false;
+		CollisionComponent->SetCollisionResponseToChannel(ECC_Vehicle, VehicleResponseBeforeCompensation);
+		if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+		{
+			LagCompensation->UntrackProjectile(this);
+		}
+	}
+
 	if (ProjectileMovement)
 	{
-		ProjectileMovement->Velocity = Direction * InitialSpeed;
+		ProjectileMovement->StopMovementImmediately();
+		ProjectileMovement->SetComponentTickEnabled(false);
+	}
+
+	SetActorEnableCollision(false);
+	SetActorHiddenInGame(true);
+}
+
+void AProjectileBase::IgnoreOwnerWhenMoving(AActor* OwnerActor)
+{
+	if (!CollisionComponent || IgnoredOwner.Get() == OwnerActor)
+	{
+		return;
+	}
+
+	// Ignoring the owner actor as a whole avoids collecting its primitive components for every shot
+	CollisionComponent->ClearMoveIgnoreActors();
+	if (OwnerActor)
+	{
+		CollisionComponent->IgnoreActorWhenMoving(OwnerActor, true);
+	}
+	IgnoredOwner = OwnerActor;
+}
+
+void AProjectileBase::SetCountedAsLive(bool bLive)
+{
+	// Tracked separately from bInFlight, which replication sets before OnRep_InFlight runs
+	if (bCountedAsLive != bLive)
+	{
+		bCountedAsLive = bLive;
+		CombatStats::AddLiveProjectiles(bLive ? 1 : -1);
+	}
+}
+
+void AProjectileBase::SetupInstancedVisuals()
+{
+	if (!bUseInstancedVisuals || !MeshComponent || !MeshComponent->GetStaticMesh() || !UProjectileVisualSubsystem::IsInstancingEnabled()
+		|| !GetWorld()->GetSubsystem<UProjectileVisualSubsystem>())
+	{
+		return;
+	}
+
+	// The shared instances draw this round. Its own mesh leaves the scene, and made absolute it is no longer
+	// updated when the round moves; its relative transform stays as the instance offset.
+	bInstancedVisuals = true;
+	MeshComponent->SetVisibility(false);
+	MeshComponent->SetUsingAbsoluteLocation(true);
+	MeshComponent->SetUsingAbsoluteRotation(true);
+	MeshComponent->SetUsingAbsoluteScale(true);
+}
+
+void AProjectileBase::ClaimPredictedRound()
+{
+	UProjectileShotSubsystem* ShotSubsystem = GetWorld()->GetSubsystem<UProjectileShotSubsystem>();
+	AProjectileBase* Predicted = nullptr;
+	float PredictedAge = 0.0f;
+	if (!ShotSubsystem || !ShotSubsystem->ClaimPredictedRound(GetOwner(), GetClass(), PredictedShot, Predicted, PredictedAge))
+	{
+		return;
+	}
+
+	// The predicted round is a round trip ahead of this copy, so it stays the visible one. If it already landed
+	// locally, the shot has been shown and this copy stays hidden too.
+	PredictedRound = Predicted;
+	SetActorHiddenInGame(true);
+
+	// Move it onto this copy's arc, which carries the server's dispersion, at the distance it has already flown
+	// down-range so it never jumps back
+	if (Predicted && ProjectileMovement)
+	{
+		const FVector Velocity = ProjectileMovement->Velocity;
+		const float Speed = Velocity.Size();
+		if (Speed > UE_KINDA_SMALL_NUMBER)
+		{
+			const float Lead = FMath::Max(FVector::DotProduct(Predicted->GetActorLocation() - GetActorLocation(), Velocity / Speed) / Speed, 0.0f);
+			const FVector Gravity(0.0f, 0.0f, GetWorld()->GetGravityZ() * ProjectileMovement->ProjectileGravityScale);
+			const FVector LeadVelocity = Velocity + Gravity * Lead;
+			Predicted->SetActorLocationAndRotation(GetActorLocation() + Velocity * Lead + 0.5f * Gravity * FMath::Square(Lead),
+				LeadVelocity.Rotation(), false, nullptr, ETeleportType::TeleportPhysics);
+			Predicted->SetVelocity(LeadVelocity);
+		}
+	}
+}
+
+void AProjectileBase::ReleasePredictedRound()
+{
+	if (AProjectileBase* Predicted = PredictedRound.Get())
+	{
+		Predicted->Destroy();
+	}
+	PredictedRound.Reset();
+}
+
+void AProjectileBase::OnRep_InFlight()
+{
+	if (bInFlight)
+	{
+		StartFlight();
+	}
+	else
+	{
+		StopFlight();
 	}
 }
 
 void AProjectileBase::OnProjectileHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp,
 	FVector NormalImpulse, const FHitResult& Hit)
 {
+	SCOPE_CYCLE_COUNTER(STAT_MVS_OnProjectileHit);
+
 	// Only process on server
-	if (!HasAuthority())
+	if (!HasAuthority() || !bInFlight)
 	{
 		return;
 	}
@@ -122,17 +400,88 @@ void AProjectileBase::OnProjectileHit(UPrimitiveComponent* HitComponent, AActor*
 		return;
 	}
 
-	// Apply damage to hit actor
-	if (OtherActor)
+	// Cosmetic copies just end where they land; the server's impact event is what counts
+	if (bCosmeticOnly)
 	{
-		ApplyDamageToActor(OtherActor);
+		DestroyProjectile();
+		return;
 	}
 
+	CombatStats::Count(this, CombatStats::EEvent::Hit);
+
+	// Apply damage to hit actor, through its armor if it has any
+	if (const AMilitaryVehicleBase* Vehicle = Cast<AMilitaryVehicleBase>(OtherActor))
+	{
+		const FVector Direction = ProjectileMovement && !ProjectileMovement->Velocity.IsNearlyZero() ? ProjectileMovement->Velocity : GetActorForwardVector();
+		const FArmorHit ArmorHit = Vehicle->MakeArmorHit(Hit.ImpactPoint, Direction, Hit.ImpactNormal, OtherComp);
+		ApplyDamageToActor(OtherActor, &ArmorHit);
+	}
+	else if (OtherActor)
+	{
+		ApplyDamageToActor(OtherActor, nullptr);
+	}
+
+	Detonate(Hit.ImpactPoint);
+	NotifyShotImpact(Hit.ImpactPoint);
+
 	// Destroy projectile
 	DestroyProjectile();
 }
 
-void AProjectileBase::ApplyDamageToActor(AActor* DamagedActor)
+void AProjectileBase::HandleLagCompensatedHit(AActor* HitActor, const FVector& ImpactLocation, const FArmorHit& ArmorHit)
+{
+	if (!HasAuthority() || !bInFlight || HitActor == GetOwner())
+	{
+		return;
+	}
+
+	CombatStats::Count(this, CombatStats::EEvent::Hit);
+	ApplyDamageToActor(HitActor, &ArmorHit);
+	Detonate(ImpactLocation);
+	NotifyShotImpact(ImpactLocation);
+	DestroyProjectile();
+}
+
+void AProjectileBase::Detonate(const FVector& Location)
+{
+	if (!HasAuthority() || bCosmeticOnly || !HasSplashDamage())
+	{
+		return;
+	}
+
+	if (UDamageQueueSubsystem* DamageQueue = GetWorld()->GetSubsystem<UDamageQueueSubsystem>())
+	{
+		DamageQueue->QueueRadialDamage(Location, SplashDamage, GetOwner());
+	}
+}
+
+void AProjectileBase::OnLifeSpanExpired()
+{
+	// Airbursts end like an impact, just in mid-air
+	if (bAirburst && bInFlight)
+	{
+		const FVector Location = GetActorLocation();
+		Detonate(Location);
+		NotifyShotImpact(Location);
+	}
+
+	DestroyProjectile();
+}
+
+void AProjectileBase::NotifyShotImpact(const FVector& ImpactLocation) const
+{
+	if (!bReplicateAsShotEvent)
+	{
+		return;
+	}
+
+	if (const UProjectileShotSubsystem* ShotSubsystem = GetWorld()->GetSubsystem<UProjectileShotSubsystem>())
+	{
+		ShotSubsystem->BroadcastImpact(GetOwner(), ShotId, ImpactLocation);
+	}
+}
+
+void AProjectileBase::ApplyDamageToActor(AActor* DamagedActor, const FArmorHit* ArmorHit)
 {
 	if (!DamagedActor || !HasAuthority())
 	{
@@ -140,15 +489,25 @@ void AProjectileBase::ApplyDamageToActor(AActor* DamagedActor)
 	}
 
 	// Try to find health component
-	UHealthComponent* HealthComp = Cast<UHealthComponent>(DamagedActor->GetComponentByClass(UHealthComponent::StaticClass()));
-	if (HealthComp)
+	const UDamageReceiverRegistry* Registry = UDamageReceiverRegistry::Get(this);
+	if (UHealthComponent* HealthComp = Registry ? Registry->FindHealthComponent(DamagedActor) : nullptr)
 	{
-		HealthComp->ApplyDamage(Damage, GetOwner());
+		const AMilitaryVehicleBase* Vehicle = ArmorHit ? Cast<AMilitaryVehicleBase>(DamagedActor) : nullptr;
+		HealthComp->ApplyDamage(Vehicle ? Vehicle->ResolveArmorDamage(*ArmorHit, Damage, Penetration) : Damage, GetOwner());
 	}
 }
 
 void AProjectileBase::DestroyProjectile()
 {
 	// TODO: Add explosion effect or particle system here if needed
+	if (bIsPooled)
+	{
+		if (UProjectilePoolSubsystem* Pool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>())
+		{
+			Pool->ReleaseProjectile(this);
+			return;
+		}
+	}
+
 	Destroy();
 }
@@ -3,7 +3,10 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
 #include "GameFramework/Actor.h"
+#include "MilitaryVehicleSim/Networking/ProjectileShotSubsystem.h"
+#include "MilitaryVehicleSim/Vehicles/VehicleArmorProfile.h"
 #include "ProjectileBase.generated.h"
 
 class UProjectileMovementComponent;
@@ -13,7 +16,7 @@ UCLASS()
 class MILITARYVEHICLESIM_API AProjectileBase : public AActor
 {
 	GENERATED_BODY()
-	
+
 public:
 	AProjectileBase();
 
@@ -27,15 +30,73 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Projectile")
 	float GetDamage() const { return Damage; }
 
+	float GetInitialSpeed() const { return InitialSpeed; }
+	float GetGravityScale() const { return GravityScale; }
+	float GetProjectileLifeSpan() const { return LifeSpan; }
+	float GetPenetration() const { return Penetration; }
+
+	/** True if rounds of this class are simulated in bulk by UBallisticsSubsystem instead of as actors. */
+	bool UsesLightweightSimulation() const { return bUseLightweightSimulation; }
+
+	/** True if rounds of this class are announced to clients as shot events instead of being replicated. */
+	bool ReplicatesAsShotEvent() const { return bReplicateAsShotEvent; }
+
+	float GetDispersionDegrees() const { return DispersionDegrees; }
+
+	bool HasSplashDamage() const { return SplashDamage.OuterRadius > 0.0f && SplashDamage.BaseDamage > 0.0f; }
+	const FRadialDamageParams& GetSplashDamage() const { return SplashDamage; }
+	bool IsAirburst() const { return bAirburst; }
+
+	void SetVelocity(const FVector& NewVelocity);
+
+	/** Moves a just-launched round, with collision, by the time since its shot was due. */
+	void CatchUp(float Seconds);
+
+	// Shot events (see UProjectileShotSubsystem)
+	void SetShotId(uint16 NewShotId) { ShotId = NewShotId; }
+	void MarkCosmetic() { bCosmeticOnly = true; }
+	void SetPredictedShot(const FPredictedShotKey& NewPredictedShot) { PredictedShot = NewPredictedShot; }
+
+	virtual void PostInitProperties() override;
 	virtual void PostNetInit() override;
+	virtual void PostNetReceive() override;
+	virtual void PostNetReceiveVelocity(const FVector& NewVelocity) override;
+	virtual void OnActorChannelOpen(class FInBunch& InBunch, class UNetConnection* Connection) override;
+
+	// Pooling (see UProjectilePoolSubsystem)
+	void MarkPooled() { bIsPooled = true; }
+	bool IsPooled() const { return bIsPooled; }
+	bool IsInFlight() const { return bInFlight; }
+
+	int32 GetPoolPrewarmCount() const { return PoolPrewarmCount; }
+	int32 GetPoolMaxSize() const { return PoolMaxSize; }
+
+	/** Launches a parked pooled instance from the given transform. Called by the pool only. */
+	void ActivateFromPool(const FVector& Location, const FRotator& Rotation, AActor* NewOwner, APawn* NewInstigator);
+
+	/** Stops, hides and disables collision so the instance can be reused. Called by the pool only. */
+	void DeactivateToPool();
+
+	// Instanced visuals (see UProjectileVisualSubsystem)
+	bool UsesInstancedVisuals() const { return bInstancedVisuals; }
+	UStaticMeshComponent* GetMeshComponent() const { return MeshComponent; }
+	void SetInVisualBatch(bool bInBatch) { bInVisualBatch = bInBatch; }
+	bool IsInVisualBatch() const { return bInVisualBatch; }
+
+	/** Impact decided against a rewound vehicle pose by ULagCompensationSubsystem. */
+	void HandleLagCompensatedHit(AActor* HitActor, const FVector& ImpactLocation, const FArmorHit& ArmorHit);
 
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	UFUNCTION()
 	void OnProjectileHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp,
 		FVector NormalImpulse, const FHitResult& Hit);
 
+	UFUNCTION()
+	void OnRep_InFlight();
+
 	// Components
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
 	TObjectPtr<USphereComponent> CollisionComponent;
@@ -59,7 +120,100 @@ protected:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Projectile")
 	float LifeSpan;
 
+	/** Armor this round defeats at normal incidence, in millimetres. Zero ignores armor and always deals Damage. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Projectile", meta = (ClampMin = "0.0"))
+	float Penetration;
+
+	/**
+	 * Fire rounds of this class as lightweight entries in UBallisticsSubsystem rather than spawning actors.
+	 * Only speed, gravity scale, damage and lifespan are used in that mode; the components are ignored.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Projectile|Ballistics")
+	bool bUseLightweightSimulation;
+
+	/**
+	 * Don't replicate rounds of this class. The server multicasts one compact shot event through the firing
+	 * vehicle instead, clients fly a local cosmetic copy, and only the server's impacts are sent afterwards.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Projectile|Replication")
+	bool bReplicateAsShotEvent;
+
+	/** Splash damage around every detonation, resolved in batches by UDamageQueueSubsystem. Off while OuterRadius is zero. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Projectile|Splash")
+	FRadialDamageParams SplashDamage;
+
+	/** Detonate in the air when LifeSpan runs out instead of just disappearing. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Projectile|Splash")
+	bool bAirburst;
+
+	/** Half-angle of the random dispersion cone, in degrees. Seeded per shot so shot events reproduce it exactly. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Projectile", meta = (ClampMin = "0.0"))
+	float DispersionDegrees;
+
+	/**
+	 * Draw in-flight rounds of this class through one instanced mesh shared by the class, updated once per frame,
+	 * instead of through each round's own mesh component. Uses the mesh, materials and relative transform of
+	 * MeshComponent. See UProjectileVisualSubsystem.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Projectile|Rendering")
+	bool bUseInstancedVisuals;
+
+	/** Number of instances of this class created up front when a weapon firing it is granted. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Projectile|Pooling", meta = (ClampMin = "0"))
+	int32 PoolPrewarmCount;
+
+	/** Upper bound on pooled instances of this class. Shots past the cap spawn throwaway actors. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Projectile|Pooling", meta = (ClampMin = "0"))
+	int32 PoolMaxSize;
+
+	/** True while the round is simulating. Replicated so client copies of pooled rounds park and relaunch with the server. */
+	UPROPERTY(ReplicatedUsing = OnRep_InFlight)
+	bool bInFlight;
+
+	/** The owning client's prediction of the shot this round was fired for, so it can hand over the right round. */
+	UPROPERTY(Replicated)
+	FPredictedShotKey PredictedShot;
+
 private:
-	void ApplyDamageToActor(AActor* DamagedActor);
+	/** ArmorHit, when known, lets vehicles scale the damage by the armor zone that was struck. */
+	void ApplyDamageToActor(AActor* DamagedActor, const FArmorHit* ArmorHit);
+	void Detonate(const FVector& Location);
+	void OnLifeSpanExpired();
 	void DestroyProjectile();
+	void NotifyShotImpact(const FVector& ImpactLocation) const;
+
+	void StartFlight();
+	void StopFlight();
+	void IgnoreOwnerWhenMoving(AActor* OwnerActor);
+	void SetCountedAsLive(bool bLive);
+	void SetupInstancedVisuals();
+
+	/** Client copies of our own shots: hide behind the round predicted at fire time instead of showing twice. */
+	void ClaimPredictedRound();
+	void ReleasePredictedRound();
+
+	bool bIsPooled;
+
+	/** Client-side replay of a shot event; never deals damage. */
+	bool bCosmeticOnly;
+
+	uint16 ShotId;
+
+	/** Set while vehicle hits come from rewound poses instead of this round's own collision. */
+	bool bLagCompensated;
+	ECollisionResponse VehicleResponseBeforeCompensation;
+
+	FTimerHandle LifeSpanTimerHandle;
+
+	TWeakObjectPtr<AActor> IgnoredOwner;
+
+	/** Whether this round is included in the live projectile counter. */
+	bool bCountedAsLive = false;
+
+	/** Drawn by UProjectileVisualSubsystem; decided once at begin play. */
+	bool bInstancedVisuals = false;
+	bool bInVisualBatch = false;
+
+	/** Local round that stands in for this replicated copy; ends when the copy does. */
+	TWeakObjectPtr<AProjectileBase> PredictedRound;
 };
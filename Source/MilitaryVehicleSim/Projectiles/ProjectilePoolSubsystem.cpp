@@ -0,0 +1,196 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectilePoolSubsystem.h"
+
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "MilitaryVehicleSim/MilitaryVehicleSim.h"
+#include "MilitaryVehicleSim/Projectiles/ProjectileBase.h"
+
+static TAutoConsoleVariable<bool> CVarProjectilePoolEnabled(
+	TEXT("mvs.ProjectilePool.Enabled"),
+	true,
+	TEXT("When disabled, projectiles are spawned and destroyed per shot instead of being recycled."));
+
+static FAutoConsoleCommandWithWorld ProjectilePoolStatsCommand(
+	TEXT("mvs.ProjectilePool.Stats"),
+	TEXT("Logs projectile pool hit/miss counters for the current world."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UProjectilePoolSubsystem* Pool = World ? World->GetSubsystem<UProjectilePoolSubsystem>() : nullptr)
+		{
+			Pool->LogStats();
+		}
+	}));
+
+bool UProjectilePoolSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UProjectilePoolSubsystem::Deinitialize()
+{
+	if (Stats.Hits + Stats.Misses > 0)
+	{
+		LogStats();
+	}
+
+	// Actors themselves are torn down with the world
+	Buckets.Empty();
+
+	Super::Deinitialize();
+}
+
+void UProjectilePoolSubsystem::Prewarm(TSubclassOf<AProjectileBase> ProjectileClass)
+{
+	UWorld* World = GetWorld();
+	if (!ProjectileClass || !World || World->GetNetMode() == NM_Client || !CVarProjectilePoolEnabled.GetValueOnGameThread())
+	{
+		return;
+	}
+
+	// Lightweight rounds never spawn actors
+	const AProjectileBase* Defaults = GetDefault<AProjectileBase>(ProjectileClass);
+	if (Defaults->UsesLightweightSimulation())
+	{
+		return;
+	}
+
+	const int32 TargetCount = FMath::Min(Defaults->GetPoolPrewarmCount(), Defaults->GetPoolMaxSize());
+
+	FProjectilePoolBucket& Bucket = Buckets.FindOrAdd(ProjectileClass.Get());
+	while (Bucket.NumOwned < TargetCount)
+	{
+		if (AProjectileBase* Projectile = SpawnPooledProjectile(ProjectileClass, Bucket))
+		{
+			Bucket.Available.Add(Projectile);
+		}
+		else
+		{
+			break;
+		}
+	}
+}
+
+AProjectileBase* UProjectilePoolSubsystem::AcquireProjectile(TSubclassOf<AProjectileBase> ProjectileClass, const FVector& Location,
+	const FRotator& Rotation, AActor* Owner, APawn* Instigator)
+{
+	if (!ProjectileClass)
+	{
+		return nullptr;
+	}
+
+	if (!CVarProjectilePoolEnabled.GetValueOnGameThread())
+	{
+		return SpawnUnpooledProjectile(ProjectileClass, Location, Rotation, Owner, Instigator);
+	}
+
+	FProjectilePoolBucket& Bucket = Buckets.FindOrAdd(ProjectileClass.Get());
+
+	// Skip entries torn down behind our back (e.g. level streaming)
+	while (Bucket.Available.Num() > 0)
+	{
+		AProjectileBase* Projectile = Bucket.Available.Pop(false);
+		if (IsValid(Projectile))
+		{
+			++Stats.Hits;
+			Projectile->ActivateFromPool(Location, Rotation, Owner, Instigator);
+			return Projectile;
+		}
+		--Bucket.NumOwned;
+	}
+
+	++Stats.Misses;
+
+	if (Bucket.NumOwned >= GetDefault<AProjectileBase>(ProjectileClass)->GetPoolMaxSize())
+	{
+		++Stats.Overflows;
+		return SpawnUnpooledProjectile(ProjectileClass, Location, Rotation, Owner, Instigator);
+	}
+
+	AProjectileBase* Projectile = SpawnPooledProjectile(ProjectileClass, Bucket);
+	if (Projectile)
+	{
+		Projectile->ActivateFromPool(Location, Rotation, Owner, Instigator);
+	}
+	return Projectile;
+}
+
+void UProjectilePoolSubsystem::ReleaseProjectile(AProjectileBase* Projectile)
+{
+	if (!IsValid(Projectile) || !Projectile->IsPooled() || !Projectile->IsInFlight())
+	{
+		return;
+	}
+
+	Projectile->DeactivateToPool();
+
+	FProjectilePoolBucket& Bucket = Buckets.FindOrAdd(Projectile->GetClass());
+	Bucket.Available.Add(Projectile);
+	++Stats.Releases;
+}
+
+FProjectilePoolStats UProjectilePoolSubsystem::GetStats() const
+{
+	FProjectilePoolStats Result = Stats;
+	Result.NumPooled = 0;
+	Result.NumAvailable = 0;
+	for (const TPair<TObjectPtr<UClass>, FProjectilePoolBucket>& Pair : Buckets)
+	{
+		Result.NumPooled += Pair.Value.NumOwned;
+		Result.NumAvailable += Pair.Value.Available.Num();
+	}
+	return Result;
+}
+
+void UProjectilePoolSubsystem::LogStats() const
+{
+	const FProjectilePoolStats Current = GetStats();
+	const int32 Requests = Current.Hits + Current.Misses;
+	const float HitRate = Requests > 0 ? 100.0f * Current.Hits / Requests : 0.0f;
+
+	UE_LOG(LogMilitaryVehicle, Log, TEXT("Projectile pool: %d hits, %d misses (%d over cap), %.1f%% hit rate, %d releases, %d pooled (%d idle)"),
+		Current.Hits, Current.Misses, Current.Overflows, HitRate, Current.Releases, Current.NumPooled, Current.NumAvailable);
+}
+
+AProjectileBase* UProjectilePoolSubsystem::SpawnPooledProjectile(UClass* ProjectileClass, FProjectilePoolBucket& Bucket)
+{
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return nullptr;
+	}
+
+	// Deferred so the instance knows it's pooled before BeginPlay and comes up parked
+	AProjectileBase* Projectile = World->SpawnActorDeferred<AProjectileBase>(ProjectileClass, FTransform::Identity, nullptr, nullptr,
+		ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	if (!Projectile)
+	{
+		return nullptr;
+	}
+
+	Projectile->MarkPooled();
+	Projectile->FinishSpawning(FTransform::Identity);
+	Projectile->DeactivateToPool();
+
+	++Bucket.NumOwned;
+	return Projectile;
+}
+
+AProjectileBase* UProjectilePoolSubsystem::SpawnUnpooledProjectile(UClass* ProjectileClass, const FVector& Location, const FRotator& Rotation,
+	AActor* Owner, APawn* Instigator)
+{
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return nullptr;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.Owner = Owner;
+	SpawnParams.Instigator = Instigator;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	return World->SpawnActor<AProjectileBase>(ProjectileClass, Location, Rotation, SpawnParams);
+}
@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ProjectilePoolSubsystem.generated.h"
+
+class AProjectileBase;
+
+/** Pool usage counters, accumulated over the lifetime of the world. */
+USTRUCT(BlueprintType)
+struct MILITARYVEHICLESIM_API FProjectilePoolStats
+{
+	GENERATED_BODY()
+
+	/** Acquisitions served from an idle pooled instance. */
+	UPROPERTY(BlueprintReadOnly, Category = "Projectile Pool")
+	int32 Hits = 0;
+
+	/** Acquisitions that had to spawn a new actor (pool growth or overflow). */
+	UPROPERTY(BlueprintReadOnly, Category = "Projectile Pool")
+	int32 Misses = 0;
+
+	/** Misses that happened with the class already at its pool cap; those actors are destroyed on impact. */
+	UPROPERTY(BlueprintReadOnly, Category = "Projectile Pool")
+	int32 Overflows = 0;
+
+	/** Instances returned to the pool after impact or lifespan expiry. */
+	UPROPERTY(BlueprintReadOnly, Category = "Projectile Pool")
+	int32 Releases = 0;
+
+	/** Pooled instances currently owned across all classes, in flight or idle. */
+	UPROPERTY(BlueprintReadOnly, Category = "Projectile Pool")
+	int32 NumPooled = 0;
+
+	/** Pooled instances currently idle and ready for reuse. */
+	UPROPERTY(BlueprintReadOnly, Category = "Projectile Pool")
+	int32 NumAvailable = 0;
+};
+
+/** Per-class pool storage. */
+USTRUCT()
+struct FProjectilePoolBucket
+{
+	GENERATED_BODY()
+
+	/** Idle instances ready to be launched. */
+	UPROPERTY()
+	TArray<TObjectPtr<AProjectileBase>> Available;
+
+	/** Total instances owned by this bucket. */
+	int32 NumOwned = 0;
+};
+
+/**
+ * Server-side pool of projectile actors, keyed by projectile class.
+ * Replaces SpawnActor/Destroy per shot with park/relaunch of long-lived actors.
+ * Parked rounds go dormant, so their client copies are kept and reused as well.
+ */
+UCLASS()
+class MILITARYVEHICLESIM_API UProjectilePoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	/** Fills the pool for a class up to its PoolPrewarmCount. */
+	void Prewarm(TSubclassOf<AProjectileBase> ProjectileClass);
+
+	/**
+	 * Returns a launched projectile at the given transform, reusing an idle instance when possible.
+	 * Falls back to a plain spawn when pooling is disabled or the class is at its cap, so firing never spawns
+	 * projectile actors any other way.
+	 */
+	AProjectileBase* AcquireProjectile(TSubclassOf<AProjectileBase> ProjectileClass, const FVector& Location, const FRotator& Rotation,
+		AActor* Owner, APawn* Instigator);
+
+	/** Parks a pooled projectile for reuse. */
+	void ReleaseProjectile(AProjectileBase* Projectile);
+
+	UFUNCTION(BlueprintCallable, Category = "Projectile Pool")
+	FProjectilePoolStats GetStats() const;
+
+	void LogStats() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	AProjectileBase* SpawnPooledProjectile(UClass* ProjectileClass, FProjectilePoolBucket& Bucket);
+	AProjectileBase* SpawnUnpooledProjectile(UClass* ProjectileClass, const FVector& Location, const FRotator& Rotation,
+		AActor* Owner, APawn* Instigator);
+
+	UPROPERTY()
+	TMap<TObjectPtr<UClass>, FProjectilePoolBucket> Buckets;
+
+	FProjectilePoolStats Stats;
+};
@@ -0,0 +1,296 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectileVisualSubsystem.h"
+
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/AutomationTest.h"
+#include "MilitaryVehicleSim/MilitaryVehicleSim.h"
+#include "MilitaryVehicleSim/Projectiles/ProjectileBase.h"
+
+DECLARE_CYCLE_STAT(TEXT("Projectile instanced visuals"), STAT_MVS_ProjectileVisuals, STATGROUP_MilitaryVehicle);
+
+static TAutoConsoleVariable<bool> CVarProjectileInstancedVisuals(
+	TEXT("mvs.Projectiles.InstancedVisuals"),
+	true,
+	TEXT("Draw rounds of classes with bUseInstancedVisuals through one instanced mesh per class. Read when a round begins play."));
+
+static FAutoConsoleCommandWithWorld ProjectileVisualsStatsCommand(
+	TEXT("mvs.Projectiles.Visuals.Stats"),
+	TEXT("Logs instanced projectile visuals per class, and instances whose transform differs from their round."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UProjectileVisualSubsystem* Visuals = World ? World->GetSubsystem<UProjectileVisualSubsystem>() : nullptr)
+		{
+			Visuals->LogStats();
+		}
+	}));
+
+void FProjectileInstanceBatch::Add(AProjectileBase* Round)
+{
+	if (Round && !Round->IsInVisualBatch())
+	{
+		Round->SetInVisualBatch(true);
+		Rounds.Add(Round);
+	}
+}
+
+void FProjectileInstanceBatch::Gather()
+{
+	GetRoundStates(RoundTransforms, RoundInFlight, RoundHidden);
+	BuildInstanceTransforms(RoundTransforms, RoundInFlight, RoundHidden, MeshTransform, Transforms);
+
+	// Backwards, so a removal swaps in a round that has already been visited
+	for (int32 Index = Rounds.Num() - 1; Index >= 0; --Index)
+	{
+		if (!RoundInFlight[Index])
+		{
+			if (AProjectileBase* Round = Rounds[Index].Get())
+			{
+				Round->SetInVisualBatch(false);
+			}
+			Rounds.RemoveAtSwap(Index, 1, false);
+		}
+	}
+}
+
+void FProjectileInstanceBatch::GetRoundStates(TArray<FTransform>& OutTransforms, TArray<bool>& OutInFlight, TArray<bool>& OutHidden) const
+{
+	OutTransforms.Reset(Rounds.Num());
+	OutInFlight.Reset(Rounds.Num());
+	OutHidden.Reset(Rounds.Num());
+
+	for (const TWeakObjectPtr<AProjectileBase>& RoundPtr : Rounds)
+	{
+		const AProjectileBase* Round = RoundPtr.Get();
+		OutTransforms.Add(Round ? Round->GetActorTransform() : FTransform::Identity);
+		OutInFlight.Add(Round && Round->IsInFlight());
+		OutHidden.Add(Round && Round->IsHidden());
+	}
+}
+
+void FProjectileInstanceBatch::BuildInstanceTransforms(TConstArrayView<FTransform> RoundTransforms, TConstArrayView<bool> InFlight,
+	TConstArrayView<bool> Hidden, const FTransform& MeshTransform, TArray<FTransform>& OutTransforms)
+{
+	check(InFlight.Num() == RoundTransforms.Num() && Hidden.Num() == RoundTransforms.Num());
+
+	OutTransforms.Reset(RoundTransforms.Num());
+	for (int32 Index = 0; Index < RoundTransforms.Num(); ++Index)
+	{
+		if (InFlight[Index] && !Hidden[Index])
+		{
+			OutTransforms.Add(MeshTransform * RoundTransforms[Index]);
+		}
+	}
+}
+
+bool UProjectileVisualSubsystem::IsInstancingEnabled()
+{
+	return CVarProjectileInstancedVisuals.GetValueOnGameThread();
+}
+
+bool UProjectileVisualSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+bool UProjectileVisualSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return !IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UProjectileVisualSubsystem::Deinitialize()
+{
+	// The components go with the visuals actor when the world is torn down
+	Visuals.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId UProjectileVisualSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UProjectileVisualSubsystem, STATGROUP_Tickables);
+}
+
+void UProjectileVisualSubsystem::AddRound(AProjectileBase* Round)
+{
+	if (!Round || !Round->UsesInstancedVisuals() || Round->IsInVisualBatch())
+	{
+		return;
+	}
+
+	FClassVisuals& ClassVisuals = Visuals.FindOrAdd(Round->GetClass());
+	if (!ClassVisuals.Instances.IsValid())
+	{
+		const UStaticMeshComponent* Template = Round->GetMeshComponent();
+		ClassVisuals.Batch.MeshTransform = Template->GetRelativeTransform();
+		ClassVisuals.Instances = CreateInstances(Template);
+	}
+
+	ClassVisuals.Batch.Add(Round);
+}
+
+void UProjectileVisualSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MVS_ProjectileVisuals);
+
+	// Tickable objects run after the actor tick groups, so every round has already moved this frame
+	for (TPair<TObjectKey<UClass>, FClassVisuals>& Pair : Visuals)
+	{
+		FClassVisuals& ClassVisuals = Pair.Value;
+		ClassVisuals.Batch.Gather();
+
+		if (UInstancedStaticMeshComponent* Instances = ClassVisuals.Instances.Get())
+		{
+			ApplyTransforms(*Instances, ClassVisuals.Batch.Transforms);
+		}
+	}
+}
+
+UInstancedStaticMeshComponent* UProjectileVisualSubsystem::CreateInstances(const UStaticMeshComponent* Template)
+{
+	AActor* Owner = VisualsActor.Get();
+	if (!Owner)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		Owner = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+		if (!Owner)
+		{
+			return nullptr;
+		}
+		VisualsActor = Owner;
+	}
+
+	UInstancedStaticMeshComponent* Instances = NewObject<UInstancedStaticMeshComponent>(Owner, NAME_None, RF_Transient);
+	Instances->SetMobility(EComponentMobility::Movable);
+	Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Instances->SetCanEverAffectNavigation(false);
+	Instances->SetStaticMesh(Template->GetStaticMesh());
+	for (int32 MaterialIndex = 0; MaterialIndex < Template->GetNumMaterials(); ++MaterialIndex)
+	{
+		Instances->SetMaterial(MaterialIndex, Template->GetMaterial(MaterialIndex));
+	}
+	Instances->SetCastShadow(Template->CastShadow);
+
+	if (USceneComponent* Root = Owner->GetRootComponent())
+	{
+		Instances->SetupAttachment(Root);
+	}
+	else
+	{
+		Owner->SetRootComponent(Instances);
+	}
+	Owner->AddInstanceComponent(Instances);
+	Instances->RegisterComponent();
+
+	return Instances;
+}
+
+void UProjectileVisualSubsystem::ApplyTransforms(UInstancedStaticMeshComponent& Instances, const TArray<FTransform>& Transforms)
+{
+	const int32 NumInstances = Instances.GetInstanceCount();
+	const int32 NumNeeded = Transforms.Num();
+
+	// Instances only ever come off the end, so the remaining indices stay put
+	if (NumNeeded < NumInstances)
+	{
+		TArray<int32> Trailing;
+		Trailing.Reserve(NumInstances - NumNeeded);
+		for (int32 Index = NumInstances - 1; Index >= NumNeeded; --Index)
+		{
+			Trailing.Add(Index);
+		}
+		Instances.RemoveInstances(Trailing);
+	}
+	else if (NumNeeded > NumInstances)
+	{
+		Instances.AddInstances(TArray<FTransform>(Transforms.GetData() + NumInstances, NumNeeded - NumInstances), false, true);
+	}
+
+	// One render state update for the whole class
+	const int32 NumUpdated = FMath::Min(NumInstances, NumNeeded);
+	if (NumUpdated > 0)
+	{
+		Instances.BatchUpdateInstancesTransforms(0, MakeArrayView(Transforms.GetData(), NumUpdated), true, true, true);
+	}
+}
+
+void UProjectileVisualSubsystem::LogStats() const
+{
+	TArray<FTransform> RoundTransforms;
+	TArray<bool> InFlight;
+	TArray<bool> Hidden;
+	TArray<FTransform> Transforms;
+
+	for (const TPair<TObjectKey<UClass>, FClassVisuals>& Pair : Visuals)
+	{
+		const FClassVisuals& ClassVisuals = Pair.Value;
+		const UClass* ProjectileClass = Pair.Key.ResolveObjectPtr();
+		const UInstancedStaticMeshComponent* Instances = ClassVisuals.Instances.Get();
+
+		// What the rounds' state now maps to, checked against what the instanced mesh actually holds
+		ClassVisuals.Batch.GetRoundStates(RoundTransforms, InFlight, Hidden);
+		FProjectileInstanceBatch::BuildInstanceTransforms(RoundTransforms, InFlight, Hidden, ClassVisuals.Batch.MeshTransform, Transforms);
+
+		int32 NumInstances = 0;
+		int32 Mismatches = 0;
+		if (Instances)
+		{
+			NumInstances = Instances->GetInstanceCount();
+			for (int32 Index = 0; Index < FMath::Min(NumInstances, Transforms.Num()); ++Index)
+			{
+				FTransform InstanceTransform;
+				if (!Instances->GetInstanceTransform(Index, InstanceTransform, true) || !InstanceTransform.Equals(Transforms[Index], 0.01))
+				{
+					++Mismatches;
+				}
+			}
+		}
+
+		UE_LOG(LogMilitaryVehicle, Log, TEXT("Visuals: %s rounds=%d visible=%d instances=%d mismatched=%d"),
+			ProjectileClass ? *ProjectileClass->GetName() : TEXT("<unloaded>"), ClassVisuals.Batch.Rounds.Num(),
+			Transforms.Num(), NumInstances, Mismatches + FMath::Abs(NumInstances - Transforms.Num()));
+	}
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FProjectileInstanceTransformsTest, "MilitaryVehicleSim.Projectiles.InstanceTransforms",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FProjectileInstanceTransformsTest::RunTest(const FString& Parameters)
+{
+	const FTransform MeshTransform(FRotator::ZeroRotator, FVector(10.0, 0.0, 0.0));
+	const FTransform RoundTransforms[] = {
+		FTransform(FRotator::ZeroRotator, FVector(100.0, 0.0, 0.0)),
+		FTransform(FRotator::ZeroRotator, FVector(200.0, 0.0, 0.0)),
+		FTransform(FRotator::ZeroRotator, FVector(300.0, 0.0, 0.0)),
+		FTransform(FRotator(0.0, 90.0, 0.0), FVector(0.0, 400.0, 0.0)),
+	};
+	const bool InFlight[] = { true, true, false, true };
+	const bool Hidden[] = { false, true, false, false };
+
+	TArray<FTransform> Transforms;
+	FProjectileInstanceBatch::BuildInstanceTransforms(RoundTransforms, InFlight, Hidden, MeshTransform, Transforms);
+
+	// Hidden and landed rounds get no instance; the rest keep their order
+	if (!TestEqual(TEXT("Instance count"), Transforms.Num(), 2))
+	{
+		return false;
+	}
+	TestTrue(TEXT("First instance is the first round's mesh"), Transforms[0].GetLocation().Equals(FVector(110.0, 0.0, 0.0)));
+
+	// The mesh offset is in the round's space, so it turns with the round
+	TestTrue(TEXT("Mesh offset turns with the round"), Transforms[1].GetLocation().Equals(FVector(0.0, 410.0, 0.0)));
+	TestTrue(TEXT("Instance takes the round's rotation"), Transforms[1].GetRotation().Equals(RoundTransforms[3].GetRotation()));
+
+	FProjectileInstanceBatch::BuildInstanceTransforms({}, {}, {}, MeshTransform, Transforms);
+	TestEqual(TEXT("No rounds, no instances"), Transforms.Num(), 0);
+	return true;
+}
+
+#endif
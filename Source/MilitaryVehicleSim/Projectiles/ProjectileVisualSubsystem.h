@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "ProjectileVisualSubsystem.generated.h"
+
+class AProjectileBase;
+class UInstancedStaticMeshComponent;
+class UStaticMeshComponent;
+
+/**
+ * The rounds of one projectile class drawn by a shared instanced mesh, and the instance transforms rebuilt from them
+ * every frame. Holds no rendering state, so the transform update runs the same headless (-nullrhi) as with a renderer.
+ */
+struct MILITARYVEHICLESIM_API FProjectileInstanceBatch
+{
+	/** Mesh transform relative to the round, taken from the first round of the class. */
+	FTransform MeshTransform = FTransform::Identity;
+
+	/** Rounds added since they started flying. Landed and destroyed ones are dropped by Gather. */
+	TArray<TWeakObjectPtr<AProjectileBase>> Rounds;
+
+	/** One world transform per visible round in flight, in the order of Rounds as it was before Gather dropped any. */
+	TArray<FTransform> Transforms;
+
+	void Add(AProjectileBase* Round);
+
+	/** Rebuilds Transforms from the rounds, then drops rounds no longer in flight. */
+	void Gather();
+
+	/** Current transform and flags of every round; destroyed rounds count as not in flight. */
+	void GetRoundStates(TArray<FTransform>& OutTransforms, TArray<bool>& OutInFlight, TArray<bool>& OutHidden) const;
+
+	/**
+	 * Instance transforms for rounds with the given transforms and flags, all the same length: MeshTransform placed on
+	 * each round in flight and not hidden, in round order.
+	 */
+	static void BuildInstanceTransforms(TConstArrayView<FTransform> RoundTransforms, TConstArrayView<bool> InFlight, TConstArrayView<bool> Hidden,
+		const FTransform& MeshTransform, TArray<FTransform>& OutTransforms);
+
+private:
+	// Gather's per-frame round states, kept to reuse their allocations
+	TArray<FTransform> RoundTransforms;
+	TArray<bool> RoundInFlight;
+	TArray<bool> RoundHidden;
+};
+
+/**
+ * Draws the in-flight rounds of classes with bUseInstancedVisuals through one UInstancedStaticMeshComponent per class
+ * instead of a static mesh component per round. Once per frame, after the rounds have moved, the instance transforms
+ * of each class are rebuilt and sent in one bulk update. The game thread and render thread then pay for one
+ * primitive per class, whatever the number of rounds.
+ *
+ * Not created on dedicated servers, which draw nothing.
+ * Console: mvs.Projectiles.InstancedVisuals, mvs.Projectiles.Visuals.Stats
+ */
+UCLASS()
+class MILITARYVEHICLESIM_API UProjectileVisualSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** True if rounds beginning play now should be drawn through this subsystem. */
+	static bool IsInstancingEnabled();
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** Starts drawing a round that just started flying. Repeated calls while it stays in flight do nothing. */
+	void AddRound(AProjectileBase* Round);
+
+	/** Logs rounds and instances per class, and instances that differ from what their rounds' current state maps to. */
+	void LogStats() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	struct FClassVisuals
+	{
+		FProjectileInstanceBatch Batch;
+		TWeakObjectPtr<UInstancedStaticMeshComponent> Instances;
+	};
+
+	UInstancedStaticMeshComponent* CreateInstances(const UStaticMeshComponent* Template);
+	static void ApplyTransforms(UInstancedStaticMeshComponent& Instances, const TArray<FTransform>& Transforms);
+
+	TMap<TObjectKey<UClass>, FClassVisuals> Visuals;
+
+	/** Owns the instanced mesh components; spawned with the first batch. */
+	TWeakObjectPtr<AActor> VisualsActor;
+};
@@ -4,21 +4,80 @@
 #include "MilitaryVehicleBase.h"
 
 #include "MilitaryVehicleSim/Components/TurretComponent.h"
+#include "MilitaryVehicleSim/Abilities/MilitaryVehicleTags.h"
 #include "AbilitySystemBlueprintLibrary.h"
 #include "AbilitySystemGlobals.h"
 #include "AbilitySystemComponent.h"
 
 #include "GameFramework/SpringArmComponent.h"
 #include "Camera/CameraComponent.h"
+#include "HAL/IConsoleManager.h"
 #include "Net/UnrealNetwork.h"
+#include "Engine/ReplicatedState.h"
+#include "GameFramework/GameStateBase.h"
 #include "ChaosWheeledVehicleMovementComponent.h"
 #include "MilitaryVehicleSim/Components/HealthComponent.h"
+#include "MilitaryVehicleSim/Diagnostics/CombatStats.h"
+#include "MilitaryVehicleSim/Diagnostics/InputRecordingSubsystem.h"
+#include "MilitaryVehicleSim/Networking/LagCompensationSubsystem.h"
+#include "MilitaryVehicleSim/Vehicles/MilitaryVehicleMovementComponent.h"
+#include "MilitaryVehicleSim/Vehicles/VehicleSignificanceSubsystem.h"
 #include "EnhancedInputComponent.h"
 #include "EnhancedInputSubsystems.h"
 #include "InputMappingContext.h"
 #include "InputAction.h"
 
-AMilitaryVehicleBase::AMilitaryVehicleBase()
+DECLARE_CYCLE_STAT(TEXT("Vehicle OnFire"), STAT_MVS_OnFire, STATGROUP_MilitaryVehicle);
+DECLARE_CYCLE_STAT(TEXT("Vehicle Server_TurretAim"), STAT_MVS_ServerTurretAim, STATGROUP_MilitaryVehicle);
+
+static TAutoConsoleVariable<float> CVarTurretAimSendRate(
+	TEXT("mvs.TurretAim.SendRate"),
+	30.0f,
+	TEXT("Aim samples per second the owning gunner streams to the server."));
+
+static TAutoConsoleVariable<float> CVarTurretAimBudgetWindow(
+	TEXT("mvs.TurretAim.BudgetWindow"),
+	0.25f,
+	TEXT("Seconds of turret traverse the server lets remote aim bank up, absorbing packets that arrive together."));
+
+static TAutoConsoleVariable<bool> CVarCompactMovement(
+	TEXT("mvs.VehicleMovement.Compact"),
+	true,
+	TEXT("Replicate vehicle hulls as quantized, delta-compressed snapshots instead of the engine's FRepMovement. Server only."));
+
+static TAutoConsoleVariable<float> CVarTurretAimTolerance(
+	TEXT("mvs.TurretAim.ReconcileTolerance"),
+	0.05f,
+	TEXT("Degrees the owning client's predicted turret yaw may differ from the server's before it is corrected."));
+
+static TAutoConsoleVariable<bool> CVarInterpolationEnabled(
+	TEXT("mvs.Interpolation.Enabled"),
+	true,
+	TEXT("Render simulated-proxy vehicles from a buffer of received hull and turret states instead of replicated physics."));
+
+static TAutoConsoleVariable<float> CVarInterpolationDelayIntervals(
+	TEXT("mvs.Interpolation.DelayIntervals"),
+	2.0f,
+	TEXT("Update intervals, as measured per vehicle, that simulated-proxy vehicles are rendered behind server time, on top of ")
+	TEXT("twice the measured transit jitter."));
+
+static TAutoConsoleVariable<float> CVarInterpolationMinDelay(
+	TEXT("mvs.Interpolation.MinDelay"),
+	0.05f,
+	TEXT("Shortest render delay in seconds for simulated-proxy vehicles."));
+
+static TAutoConsoleVariable<float> CVarInterpolationMaxDelay(
+	TEXT("mvs.Interpolation.MaxDelay"),
+	1.25f,
+	TEXT("Longest render delay in seconds for simulated-proxy vehicles, whatever their update rate."));
+
+static TAutoConsoleVariable<float> CVarInterpolationMaxExtrapolation(
+	TEXT("mvs.Interpolation.MaxExtrapolation"),
+	0.25f,
+	TEXT("Seconds a simulated-proxy vehicle keeps moving past its newest state when updates are late, before it holds."));
+
+AMilitaryVehicleBase::AMilitaryVehicleBase(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UMilitaryVehicleMovementComponent>(AWheeledVehiclePawn::VehicleMovementComponentName))
 {
 	PrimaryActorTick.bCanEverTick = true;
 	bReplicates = true;
@@ -69,8 +128,19 @@ AMilitaryVehicleBase::AMilitaryVehicleBase()
 		
 	// Default state
 	bIsDriverRole = true;
+	ShotSequence = 0;
+	bTurretVisualDirty = false;
+	bInterpolatingMovement = false;
+	ReplicatedMovementTimeMs = 0;
 	bIsThirdPersonCamera = true;
 	TurretYaw = -90.0f; // Initialize to match the TurretComponent's relative rotation
+	ReplicatedTurretYaw = TurretAim::QuantizeYaw(TurretYaw);
+	TurretAimAck.Yaw = ReplicatedTurretYaw;
+	AimSequence = 0;
+	AimStreamEpoch = 0;
+	AimSendAccumulator = 0.0f;
+	LastAppliedAimSequence = 0;
+	AimBudgetDegrees = 0.0f;
 }
 
 void AMilitaryVehicleBase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
@@ -79,7 +149,149 @@ void AMilitaryVehicleBase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>&
 
 	DOREPLIFETIME(AMilitaryVehicleBase, bIsDriverRole);
 	DOREPLIFETIME(AMilitaryVehicleBase, bIsThirdPersonCamera);
-	DOREPLIFETIME(AMilitaryVehicleBase, TurretYaw);
+	// The owner predicts its own turret and is corrected through the ack instead
+	DOREPLIFETIME_CONDITION(AMilitaryVehicleBase, ReplicatedTurretYaw, COND_SkipOwner);
+	DOREPLIFETIME_CONDITION(AMilitaryVehicleBase, TurretAimAck, COND_OwnerOnly);
+	DOREPLIFETIME(AMilitaryVehicleBase, MovementSnapshot);
+	DOREPLIFETIME_CONDITION(AMilitaryVehicleBase, ReplicatedMovementTimeMs, COND_SimulatedOnly);
+}
+
+void AMilitaryVehicleBase::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	// Exactly one of the two paths carries the hull
+	const bool bCompactMovement = IsReplicatingMovement() && CVarCompactMovement.GetValueOnGameThread();
+	if (bCompactMovement)
+	{
+		FRigidBodyState BodyState;
+		if (GetMesh()->GetRigidBodyState(BodyState))
+		{
+			MovementSnapshot.Capture(BodyState, GetChaosVehicleMovement(), GetWorld()->GetTimeSeconds());
+		}
+	}
+	else if (IsReplicatingMovement())
+	{
+		// Only a changed state is stamped, so the stamp alone never makes an otherwise idle vehicle send
+		const FRepMovement& Movement = GetReplicatedMovement();
+		if (!Movement.Location.Equals(LastStampedMovement.Location, 0.0) || !Movement.Rotation.Equals(LastStampedMovement.Rotation, 0.0f)
+			|| !Movement.LinearVelocity.Equals(LastStampedMovement.LinearVelocity, 0.0) || !Movement.AngularVelocity.Equals(LastStampedMovement.AngularVelocity, 0.0))
+		{
+			LastStampedMovement = Movement;
+			ReplicatedMovementTimeMs = SnapshotInterpolation::WrapServerTimeMs(GetWorld()->GetTimeSeconds());
+		}
+	}
+
+	DOREPLIFETIME_ACTIVE_OVERRIDE_FAST(AActor, ReplicatedMovement, IsReplicatingMovement() && !bCompactMovement);
+	DOREPLIFETIME_ACTIVE_OVERRIDE_FAST(AMilitaryVehicleBase, ReplicatedMovementTimeMs, IsReplicatingMovement() && !bCompactMovement);
+	DOREPLIFETIME_ACTIVE_OVERRIDE_FAST(AMilitaryVehicleBase, MovementSnapshot, bCompactMovement);
+}
+
+void AMilitaryVehicleBase::OnRep_ReplicatedMovement()
+{
+	// What the engine's own encoding of this update cost, for comparison with the compact path
+	FNetBitWriter Writer(1024);
+	bool bSuccess = true;
+	FRepMovement Movement = GetReplicatedMovement();
+	Movement.NetSerialize(Writer, nullptr, bSuccess);
+	++MovementNetStats.StockUpdates;
+	MovementNetStats.StockBits += Writer.GetNumBits();
+
+	if (UpdateInterpolatingMovement())
+	{
+		AddInterpolationSample(GetReplicatedMovement(), ReplicatedMovementTimeMs);
+		return;
+	}
+	Super::OnRep_ReplicatedMovement();
+}
+
+void AMilitaryVehicleBase::OnRep_MovementSnapshot()
+{
+	FVehicleNetState State;
+	int64 NumBits = 0;
+	const bool bHasState = MovementSnapshot.ConsumeReceived(State, NumBits);
+	++MovementNetStats.CompactUpdates;
+	MovementNetStats.CompactBits += NumBits;
+	if (!bHasState)
+	{
+		return;
+	}
+
+	State.ToRepMovement(GetReplicatedMovement_Mutable());
+	if (UpdateInterpolatingMovement())
+	{
+		AddInterpolationSample(GetReplicatedMovement(), State.TimeMs);
+		return;
+	}
+
+	// Otherwise hand the decoded state to the engine's physics replication, which smooths proxies towards it
+	Super::OnRep_ReplicatedMovement();
+}
+
+bool AMilitaryVehicleBase::UpdateInterpolatingMovement()
+{
+	const bool bInterpolate = GetLocalRole() == ROLE_SimulatedProxy && IsReplicatingMovement() && CVarInterpolationEnabled.GetValueOnGameThread();
+	if (bInterpolate != bInterpolatingMovement)
+	{
+		bInterpolatingMovement = bInterpolate;
+		InterpolationBuffer.Reset();
+
+		// The buffer places the hull kinematically; physics only runs while the engine's replication drives it
+		GetMesh()->SetSimulatePhysics(!bInterpolate);
+	}
+	return bInterpolate;
+}
+
+void AMilitaryVehicleBase::AddInterpolationSample(const FRepMovement& Movement, uint16 TimeMs)
+{
+	const double ServerNow = GetServerWorldTime();
+
+	FHullInterpolationSample Sample;
+	Sample.Time = SnapshotInterpolation::UnwrapServerTimeMs(TimeMs, ServerNow);
+	Sample.Location = Movement.Location;
+	Sample.Rotation = Movement.Rotation.Quaternion();
+	Sample.LinearVelocity = Movement.LinearVelocity;
+	Sample.AngularVelocity = Movement.AngularVelocity;
+	InterpolationBuffer.AddHull(Sample, ServerNow);
+}
+
+double AMilitaryVehicleBase::GetServerWorldTime() const
+{
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	return GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+}
+
+void AMilitaryVehicleBase::TickInterpolation(float DeltaTime)
+{
+	if (!UpdateInterpolatingMovement())
+	{
+		return;
+	}
+
+	const double Delay = InterpolationBuffer.UpdateDelay(DeltaTime, CVarInterpolationDelayIntervals.GetValueOnGameThread(),
+		CVarInterpolationMinDelay.GetValueOnGameThread(), CVarInterpolationMaxDelay.GetValueOnGameThread());
+	const double RenderTime = GetServerWorldTime() - Delay;
+
+	FVector Location;
+	FQuat Rotation;
+	if (InterpolationBuffer.SampleHull(RenderTime, CVarInterpolationMaxExtrapolation.GetValueOnGameThread(), Location, Rotation))
+	{
+		SetActorLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+	}
+
+	float Yaw;
+	if (InterpolationBuffer.SampleTurretYaw(RenderTime, Yaw))
+	{
+		TurretYaw = Yaw;
+		ApplyTurretVisual();
+	}
+
+	InterpolationBuffer.Prune(RenderTime);
+}
+
+void AMilitaryVehicleBase::ResetMovementNetStats()
+{
+	MovementNetStats.Reset(GetWorld()->GetTimeSeconds());
 }
 
 void AMilitaryVehicleBase::BeginPlay()
@@ -95,15 +307,41 @@ void AMilitaryVehicleBase::BeginPlay()
 				AbilitySystemComponent->GiveAbility(FGameplayAbilitySpec(AbilityClass, 1, INDEX_NONE, this));
 			}
 		}
+		ResolveFireAbility();
 	}
 
 	AbilitySystemComponent->InitAbilityActorInfo(this, this);
 
+	// Server keeps a pose history so shots can be tested against what the shooter saw
+	if (HasAuthority())
+	{
+		if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+		{
+			LagCompensation->RegisterVehicle(this);
+		}
+	}
+
+	if (UVehicleSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UVehicleSignificanceSubsystem>())
+	{
+		Significance->RegisterVehicle(this);
+	}
+
+	// Proxies may become interpolating at any time; the tick returns early while they aren't
+	if (GetNetMode() == NM_Client)
+	{
+		InterpolationTickFunction.Target = this;
+		InterpolationTickFunction.bCanEverTick = true;
+		InterpolationTickFunction.TickGroup = TG_PrePhysics;
+		InterpolationTickFunction.RegisterTickFunction(GetLevel());
+	}
+
 	if (ThirdPersonCamera && ThirdPersonSpringArm)
 	{
 		ThirdPersonCamera->AttachToComponent(ThirdPersonSpringArm, FAttachmentTransformRules::KeepRelativeTransform, USpringArmComponent::SocketName);
 	}
 
+	ResetMovementNetStats();
+
 	// Initialize camera state
 	UpdateCameraState();
 	
@@ -120,9 +358,55 @@ void AMilitaryVehicleBase::BeginPlay()
 	}
 }
 
+void AMilitaryVehicleBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+	{
+		LagCompensation->UnregisterVehicle(this);
+	}
+
+	if (UVehicleSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UVehicleSignificanceSubsystem>())
+	{
+		Significance->UnregisterVehicle(this);
+	}
+
+	InterpolationTickFunction.UnRegisterTickFunction();
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void AMilitaryVehicleBase::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+
+	TickTurretAimStream(DeltaTime);
+	UpdateWeaponFire();
+
+	if (bTurretVisualDirty)
+	{
+		ApplyTurretVisual();
+	}
+}
+
+void AMilitaryVehicleBase::QueueDriverInput()
+{
+	// The game-thread inputs are set as well, for replication to the server and anything reading them this frame;
+	// the physics steps then take theirs from the queue
+	UMilitaryVehicleMovementComponent* VehicleMovement = Cast<UMilitaryVehicleMovementComponent>(GetChaosVehicleMovement());
+	if (VehicleMovement && VehicleMovement->IsStepInputEnabled())
+	{
+		LatestDriverInput.Time = GetWorld()->GetTimeSeconds();
+		VehicleMovement->QueueStepInput(LatestDriverInput);
+	}
+}
+
+void AMilitaryVehicleBase::ApplyTurretVisual()
+{
+	bTurretVisualDirty = false;
+	if (TurretComponent)
+	{
+		TurretComponent->SetTurretYaw(TurretYaw);
+	}
 }
 
 UChaosWheeledVehicleMovementComponent* AMilitaryVehicleBase::GetChaosVehicleMovement() const
@@ -177,6 +461,8 @@ void AMilitaryVehicleBase::SetupPlayerInputComponent(UInputComponent* PlayerInpu
 	if (FireAction)
 	{
 		EnhancedInputComponent->BindAction(FireAction, ETriggerEvent::Started, this, &AMilitaryVehicleBase::OnFire);
+		EnhancedInputComponent->BindAction(FireAction, ETriggerEvent::Completed, this, &AMilitaryVehicleBase::OnFireReleased);
+		EnhancedInputComponent->BindAction(FireAction, ETriggerEvent::Canceled, this, &AMilitaryVehicleBase::OnFireReleased);
 	}
 	
 	if (LookWithMouseAction)
@@ -209,12 +495,17 @@ void AMilitaryVehicleBase::UpdateCameraState()
 // Enhanced Input Callbacks
 void AMilitaryVehicleBase::OnThrottle(const FInputActionValue& Value)
 {
+	RecordInput(EVehicleInputAction::Throttle, Value);
+
 	// Get the 2D vector from input
 	const float SteerAmount = Value.Get<float>();
 
 	if (bIsDriverRole)
 	{
 		// Forward/Backward (Y axis)
+		LatestDriverInput.Throttle = SteerAmount;
+		QueueDriverInput();
+
 		if (UChaosWheeledVehicleMovementComponent* VehicleMovement = GetChaosVehicleMovement())
 		{
 			VehicleMovement->SetThrottleInput(SteerAmount);
@@ -223,11 +514,16 @@ void AMilitaryVehicleBase::OnThrottle(const FInputActionValue& Value)
 }
 void AMilitaryVehicleBase::OnSteer(const FInputActionValue& Value)
 {
+	RecordInput(EVehicleInputAction::Steer, Value);
+
 	const float SteerAmount = Value.Get<float>();
 
 	if (bIsDriverRole)
 	{
 		// Forward/Backward (Y axis)
+		LatestDriverInput.Steering = SteerAmount;
+		QueueDriverInput();
+
 		if (UChaosWheeledVehicleMovementComponent* VehicleMovement = GetChaosVehicleMovement())
 		{
 			VehicleMovement->SetSteeringInput(SteerAmount);
@@ -237,10 +533,15 @@ void AMilitaryVehicleBase::OnSteer(const FInputActionValue& Value)
 
 void AMilitaryVehicleBase::OnBrake(const FInputActionValue& Value)
 {
+	RecordInput(EVehicleInputAction::Brake, Value);
+
 	const float SteerAmount = Value.Get<float>();
 	
 	if (bIsDriverRole)
 	{
+		LatestDriverInput.Brake = SteerAmount;
+		QueueDriverInput();
+
 		if (UChaosWheeledVehicleMovementComponent* VehicleMovement = GetChaosVehicleMovement())
 		{
 			VehicleMovement->SetBrakeInput(SteerAmount);
@@ -250,10 +551,15 @@ void AMilitaryVehicleBase::OnBrake(const FInputActionValue& Value)
 
 void AMilitaryVehicleBase::OnHandbrake(const FInputActionValue& Value)
 {
+	RecordInput(EVehicleInputAction::Handbrake, Value);
+
 	const bool bNewHandbrake = Value.Get<bool>();
 	
 	if (bIsDriverRole)
 	{
+		LatestDriverInput.bHandbrake = bNewHandbrake;
+		QueueDriverInput();
+
 		if (UChaosWheeledVehicleMovementComponent* VehicleMovement = GetChaosVehicleMovement())
 		{
 			VehicleMovement->SetHandbrakeInput(bNewHandbrake);
@@ -263,6 +569,8 @@ void AMilitaryVehicleBase::OnHandbrake(const FInputActionValue& Value)
 
 void AMilitaryVehicleBase::OnLook(const FInputActionValue& Value)
 {
+	RecordInput(EVehicleInputAction::Look, Value);
+
 	// Get the 2D vector from mouse movement
 	const FVector2D LookVector = Value.Get<FVector2D>();
 
@@ -293,49 +601,182 @@ void AMilitaryVehicleBase::OnBrakeCompleted(const FInputActionValue& Value)
 
 void AMilitaryVehicleBase::OnFire(const FInputActionValue& Value)
 {
+	RecordInput(EVehicleInputAction::Fire, Value);
+
 	if (bIsDriverRole) return;
 
-	if (AbilitySystemComponent && TurretComponent)
+	if (!AbilitySystemComponent || !TurretComponent || !ResolveFireAbility())
 	{
-		FGameplayEventData Payload;
-		Payload.Instigator = this;
-		
-		FHitResult Hit;
-		Hit.Location = TurretComponent->GetMuzzleLocation();
-		Hit.ImpactNormal = TurretComponent->GetMuzzleRotation().Vector();
-		
-		Payload.TargetData.Add(new FGameplayAbilityTargetData_SingleTargetHit(Hit));
+		return;
+	}
 
-		// Use a generic tag or a specific one if known. 
-		// Since we don't have tags defined, we can try to activate by tag "Ability.Fire" 
-		// but we also need to make sure the ability has this tag.
-		// For now, let's use the existing TryActivateAbility but we need a way to pass data.
-		
-		// Actually, the best way without tags is to use a custom RPC if we want to be sure.
-		// But let's try to find if there's any tag on the spec.
-		
-		for (const FGameplayAbilitySpec& Spec : AbilitySystemComponent->GetActivatableAbilities())
+	// A press fires straight away if the weapon is ready; Tick keeps automatic fire and bursts going
+	FireScheduler.PressTrigger(FireSchedule, GetWorld()->GetTimeSeconds());
+	UpdateWeaponFire();
+}
+
+void AMilitaryVehicleBase::OnFireReleased(const FInputActionValue& Value)
+{
+	RecordInput(EVehicleInputAction::FireReleased, Value);
+
+	FireScheduler.ReleaseTrigger();
+}
+
+void AMilitaryVehicleBase::UpdateWeaponFire()
+{
+	if (!FireAbilityHandle.IsValid() || !AbilitySystemComponent || !TurretComponent)
+	{
+		return;
+	}
+
+	if (bIsDriverRole)
+	{
+		FireScheduler.ReleaseTrigger();
+		return;
+	}
+
+	float FirstShotAge = 0.0f;
+	const int32 NumShots = FireScheduler.Advance(FireSchedule, GetWorld()->GetTimeSeconds(), FirstShotAge);
+	if (NumShots == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_MVS_OnFire);
+
+	// Fresh target data every batch: the ability system and its RPCs may keep the handle past this call, and one
+	// allocation per batch rather than per shot is cheap
+	const TSharedRef<FGameplayAbilityTargetData_WeaponFire> TargetData = MakeShared<FGameplayAbilityTargetData_WeaponFire>();
+	TargetData->MuzzleLocation = TurretComponent->GetMuzzleLocation();
+	TargetData->Direction = TurretComponent->GetMuzzleRotation().Vector();
+	TargetData->NumShots = static_cast<uint8>(NumShots);
+	TargetData->FirstShotAge = FirstShotAge;
+	FirePayload.TargetData.Clear();
+	FirePayload.TargetData.Data.Add(TargetData);
+
+	FirePayload.EventTag = MilitaryVehicleTags::Ability_Fire;
+	FirePayload.Instigator = this;
+
+	const FGameplayAbilitySpecHandle Handle = FireAbilityHandle;
+	if (!AbilitySystemComponent->TriggerAbilityFromGameplayEvent(Handle, AbilitySystemComponent->AbilityActorInfo.Get(), MilitaryVehicleTags::Ability_Fire, &FirePayload, *AbilitySystemComponent))
+	{
+		// Blocked activations land here too; only a spec that is gone needs looking up again
+		if (!AbilitySystemComponent->FindAbilitySpecFromHandle(Handle))
 		{
-			// We can't easily pass TriggerEventData to TryActivateAbility.
-			// However, we can use TriggerAbilityFromGameplayEvent if we know the tag.
-			// If we don't know the tag, we can try to use the ability's own tags.
-			if (Spec.Ability->AbilityTags.HasTag(FGameplayTag::RequestGameplayTag(TEXT("Ability.Fire"), false)))
-			{
-				AbilitySystemComponent->TriggerAbilityFromGameplayEvent(Spec.Handle, AbilitySystemComponent->AbilityActorInfo.Get(), FGameplayTag::RequestGameplayTag(TEXT("Ability.Fire")), &Payload, *AbilitySystemComponent);
-				return;
-			}
+			FireAbilityHandle = FGameplayAbilitySpecHandle();
 		}
+	}
+}
 
-		// Fallback to original behavior if no tag matches
+bool AMilitaryVehicleBase::ResolveFireAbility()
+{
+	// The server resolves right after granting; clients once the granted specs have replicated
+	if (!FireAbilityHandle.IsValid())
+	{
 		for (const FGameplayAbilitySpec& Spec : AbilitySystemComponent->GetActivatableAbilities())
 		{
-			AbilitySystemComponent->TryActivateAbility(Spec.Handle);
+			if (Spec.Ability && Spec.Ability->AbilityTags.HasTagExact(MilitaryVehicleTags::Ability_Fire))
+			{
+				FireAbilityHandle = Spec.Handle;
+				if (const UGameplayAbility_FireWeapon* FireAbility = Cast<UGameplayAbility_FireWeapon>(Spec.Ability))
+				{
+					FireSchedule = FireAbility->GetFireSchedule();
+				}
+				break;
+			}
 		}
 	}
+	return FireAbilityHandle.IsValid();
+}
+
+FArmorHit AMilitaryVehicleBase::MakeArmorHit(const FVector& Location, const FVector& Direction, const FVector& Normal, const UPrimitiveComponent* HitComponent) const
+{
+	const FTransform& MeshTransform = GetMesh()->GetComponentTransform();
+
+	FArmorHit Hit;
+	Hit.LocalLocation = MeshTransform.InverseTransformPosition(Location);
+	Hit.LocalDirection = MeshTransform.InverseTransformVectorNoScale(Direction.GetSafeNormal());
+	Hit.LocalNormal = MeshTransform.InverseTransformVectorNoScale(Normal.GetSafeNormal());
+	Hit.bTurret = HitComponent && HitComponent == TurretComponent;
+	return Hit;
+}
+
+float AMilitaryVehicleBase::ResolveArmorDamage(const FArmorHit& Hit, float Damage, float PenetrationMm) const
+{
+	return ArmorProfile ? ArmorProfile->ResolveDamage(Hit, Damage, PenetrationMm) : Damage;
+}
+
+void AMilitaryVehicleBase::SetDriverInput(float Throttle, float Steering, float Brake)
+{
+	OnThrottle(FInputActionValue(Throttle));
+	OnSteer(FInputActionValue(Steering));
+	OnBrake(FInputActionValue(Brake));
+}
+
+void AMilitaryVehicleBase::AddTurretYawInput(float YawInput)
+{
+	OnLookWithMouse(FInputActionValue(FVector2D(YawInput, 0.0f)));
+}
+
+void AMilitaryVehicleBase::FireWeapon()
+{
+	OnFire(FInputActionValue(true));
+	OnFireReleased(FInputActionValue(false));
+}
+
+void AMilitaryVehicleBase::ApplyRecordedInput(EVehicleInputAction Action, const FInputActionValue& Value)
+{
+	switch (Action)
+	{
+	case EVehicleInputAction::Throttle:
+		OnThrottle(Value);
+		break;
+	case EVehicleInputAction::Steer:
+		OnSteer(Value);
+		break;
+	case EVehicleInputAction::Brake:
+		OnBrake(Value);
+		break;
+	case EVehicleInputAction::Handbrake:
+		OnHandbrake(Value);
+		break;
+	case EVehicleInputAction::Look:
+		OnLook(Value);
+		break;
+	case EVehicleInputAction::LookWithMouse:
+		OnLookWithMouse(Value);
+		break;
+	case EVehicleInputAction::Fire:
+		OnFire(Value);
+		break;
+	case EVehicleInputAction::FireReleased:
+		OnFireReleased(Value);
+		break;
+	case EVehicleInputAction::ToggleRole:
+		OnToggleRole(Value);
+		break;
+	default:
+		break;
+	}
+}
+
+void AMilitaryVehicleBase::RecordInput(EVehicleInputAction Action, const FInputActionValue& Value) const
+{
+	if (!IsPlayerControlled() || !IsLocallyControlled())
+	{
+		return;
+	}
+
+	if (UInputRecordingSubsystem* Recorder = GetWorld()->GetSubsystem<UInputRecordingSubsystem>())
+	{
+		Recorder->RecordInput(this, Action, Value);
+	}
 }
 
 void AMilitaryVehicleBase::OnToggleRole(const FInputActionValue& Value)
 {
+	RecordInput(EVehicleInputAction::ToggleRole, Value);
+
 	if (HasAuthority())
 	{
 		Server_ToggleRole_Implementation();
@@ -348,12 +789,14 @@ void AMilitaryVehicleBase::OnToggleRole(const FInputActionValue& Value)
 
 void AMilitaryVehicleBase::Server_ToggleRole_Implementation()
 {
+	CombatStats::Count(this, CombatStats::EEvent::Rpc);
 	bIsDriverRole = !bIsDriverRole;
 	
 	// When switching roles, also update the camera preference
 	// Driver role always implies third person
 	// Gunner role will now default to gunner sight when switched to
 	bIsThirdPersonCamera = bIsDriverRole;
+	RestartTurretAimStream();
 	
 	if (IsNetMode(NM_Standalone) || HasAuthority())
 	{
@@ -363,6 +806,8 @@ void AMilitaryVehicleBase::Server_ToggleRole_Implementation()
 
 void AMilitaryVehicleBase::OnLookWithMouse(const FInputActionValue& Value)
 {
+	RecordInput(EVehicleInputAction::LookWithMouse, Value);
+
 	// Get the 2D vector from mouse movement
 	const FVector2D LookVector = Value.Get<FVector2D>();
 	
@@ -391,44 +836,227 @@ void AMilitaryVehicleBase::OnLookWithMouse(const FInputActionValue& Value)
 		if (TurretComponent)
 		{
 			TurretComponent->RotateTurret(LookVector.X);
-			
-			// Update the replicated variable on the client so that 
-			// it's immediately available for the local ability activation
-			TurretYaw = TurretComponent->GetRelativeRotation().Yaw;
-			
-			// Send to server
-			if (!HasAuthority())
+
+			// Update the yaw on the client so that it's immediately available for the local ability activation.
+			// The server gets it from the aim stream in TickTurretAimStream.
+			if (HasAuthority())
 			{
-				Server_RotateTurret(LookVector.X, TurretYaw);
+				SetAuthoritativeTurretYaw(TurretComponent->GetTurretYaw());
+			}
+			else
+			{
+				TurretYaw = TurretComponent->GetTurretYaw();
 			}
 		}
 	}
 }
 
-void AMilitaryVehicleBase::Server_RotateTurret_Implementation(float YawInput, float CurrentYaw)
+void AMilitaryVehicleBase::SetAuthoritativeTurretYaw(float NewYaw)
 {
-	if (TurretComponent)
+	TurretYaw = FRotator::NormalizeAxis(NewYaw);
+	ReplicatedTurretYaw = TurretAim::QuantizeYaw(TurretYaw);
+}
+
+void AMilitaryVehicleBase::TickTurretAimStream(float DeltaTime)
+{
+	if (HasAuthority())
 	{
-		// Use the client's current yaw as a base to maintain synchronization
-		FRotator NewRotation = TurretComponent->GetRelativeRotation();
-		NewRotation.Yaw = CurrentYaw;
-		TurretComponent->SetRelativeRotation(NewRotation);
+		// Remote aim may traverse at MaxYawRate, with a short window of slack for packets that arrive bunched up
+		if (TurretComponent)
+		{
+			const float MaxYawRate = TurretComponent->GetMaxYawRate();
+			AimBudgetDegrees = FMath::Min(AimBudgetDegrees + MaxYawRate * DeltaTime, MaxYawRate * CVarTurretAimBudgetWindow.GetValueOnGameThread());
+		}
+		return;
+	}
 
-		// Also apply the input for the current frame to keep it smooth
-		TurretComponent->RotateTurret(YawInput);
-		
-		// Update TurretYaw for replication to other clients
-		TurretYaw = TurretComponent->GetRelativeRotation().Yaw;
+	if (!IsLocallyControlled() || bIsDriverRole)
+	{
+		return;
+	}
+
+	const float SendRate = CVarTurretAimSendRate.GetValueOnGameThread();
+	AimSendAccumulator += DeltaTime;
+	if (SendRate <= 0.0f || AimSendAccumulator < 1.0f / SendRate)
+	{
+		return;
+	}
+	AimSendAccumulator = FMath::Fmod(AimSendAccumulator, 1.0f / SendRate);
+
+	// Only a changed aim becomes a new sample; unacknowledged ones keep being resent until the server confirms them
+	const uint16 QuantizedYaw = TurretAim::QuantizeYaw(TurretYaw);
+	const bool bAimChanged = PendingAimSamples.Num() > 0
+		? PendingAimSamples.Last().Yaw != QuantizedYaw
+		: QuantizedYaw != TurretAimAck.Yaw;
+	if (bAimChanged)
+	{
+		FTurretAimSample& Sample = PendingAimSamples.AddDefaulted_GetRef();
+		Sample.Sequence = ++AimSequence;
+		Sample.Yaw = QuantizedYaw;
+
+		if (PendingAimSamples.Num() > 64)
+		{
+			PendingAimSamples.RemoveAt(0, PendingAimSamples.Num() - 64, false);
+		}
+	}
+
+	if (PendingAimSamples.Num() == 0)
+	{
+		return;
+	}
+
+	FTurretAimPacket Packet;
+	Packet.Epoch = AimStreamEpoch;
+	Packet.LatestSequence = PendingAimSamples.Last().Sequence;
+	Packet.NumSamples = static_cast<uint8>(FMath::Min(PendingAimSamples.Num(), TurretAim::RedundantSamples));
+	for (int32 Index = 0; Index < Packet.NumSamples; ++Index)
+	{
+		Packet.Yaws[Index] = PendingAimSamples[PendingAimSamples.Num() - 1 - Index].Yaw;
+	}
+	Server_TurretAim(Packet);
+}
+
+void AMilitaryVehicleBase::Server_TurretAim_Implementation(const FTurretAimPacket& Packet)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MVS_ServerTurretAim);
+	CombatStats::Count(this, CombatStats::EEvent::Rpc);
+
+	if (!TurretComponent || bIsDriverRole || Packet.Epoch != TurretAimAck.Epoch)
+	{
+		return;
+	}
+
+	// Oldest first, skipping anything already applied from an earlier packet
+	for (int32 Index = Packet.NumSamples - 1; Index >= 0; --Index)
+	{
+		const uint16 Sequence = Packet.GetSequence(Index);
+		if (TurretAim::IsNewerSequence(Sequence, LastAppliedAimSequence))
+		{
+			ApplyRemoteAim(TurretAim::DequantizeYaw(Packet.Yaws[Index]));
+			LastAppliedAimSequence = Sequence;
+		}
 	}
+
+	TurretAimAck.Sequence = LastAppliedAimSequence;
+	TurretAimAck.Yaw = ReplicatedTurretYaw;
+}
+
+void AMilitaryVehicleBase::ApplyRemoteAim(float TargetYaw)
+{
+	// The client only says where it wants to aim; how fast the turret gets there is the server's call
+	const float DeltaYaw = FMath::Clamp(FMath::FindDeltaAngleDegrees(TurretYaw, TargetYaw), -AimBudgetDegrees, AimBudgetDegrees);
+	AimBudgetDegrees -= FMath::Abs(DeltaYaw);
+
+	TurretComponent->SetTurretYaw(TurretYaw + DeltaYaw);
+	SetAuthoritativeTurretYaw(TurretComponent->GetTurretYaw());
 }
 
 void AMilitaryVehicleBase::OnRep_TurretYaw()
 {
-	if (TurretComponent)
+	if (UpdateInterpolatingMovement())
+	{
+		// Turret yaw carries no stamp of its own; place it where the hull stamps say updates are sent from
+		InterpolationBuffer.AddTurretYaw(InterpolationBuffer.EstimateSendTime(GetServerWorldTime()), TurretAim::DequantizeYaw(ReplicatedTurretYaw));
+		return;
+	}
+
+	TurretYaw = TurretAim::DequantizeYaw(ReplicatedTurretYaw);
+
+	// Low-significance vehicles tick slowly; their turret catches up on the next tick instead of on every update
+	if (GetActorTickInterval() > 0.0f)
+	{
+		bTurretVisualDirty = true;
+	}
+	else
+	{
+		ApplyTurretVisual();
+	}
+}
+
+void AMilitaryVehicleBase::RestartTurretAimStream()
+{
+	if (!HasAuthority())
+	{
+		return;
+	}
+
+	TurretAimAck.Epoch = (TurretAimAck.Epoch + 1) & TurretAim::EpochMask;
+	TurretAimAck.Sequence = 0;
+	TurretAimAck.Yaw = ReplicatedTurretYaw;
+	LastAppliedAimSequence = 0;
+	AimBudgetDegrees = 0.0f;
+}
+
+void AMilitaryVehicleBase::OnRep_TurretAimAck()
+{
+	// The server started a new stream; whatever we had pending belonged to the old one
+	if (TurretAimAck.Epoch != AimStreamEpoch)
+	{
+		AimStreamEpoch = TurretAimAck.Epoch;
+		AimSequence = 0;
+		AimSendAccumulator = 0.0f;
+		PendingAimSamples.Reset();
+		return;
+	}
+
+	// Find what we predicted for the acknowledged sample and forget everything up to it
+	int32 NumAcked = 0;
+	float PredictedYaw = TurretYaw;
+	while (NumAcked < PendingAimSamples.Num() && !TurretAim::IsNewerSequence(PendingAimSamples[NumAcked].Sequence, TurretAimAck.Sequence))
 	{
-		FRotator NewRotation = TurretComponent->GetRelativeRotation();
-		NewRotation.Yaw = TurretYaw;
-		TurretComponent->SetRelativeRotation(NewRotation);
+		PredictedYaw = TurretAim::DequantizeYaw(PendingAimSamples[NumAcked].Yaw);
+		++NumAcked;
+	}
+	if (NumAcked == 0 && PendingAimSamples.Num() > 0)
+	{
+		// Ack for a sample we no longer have; wait for a newer one
+		return;
+	}
+	PendingAimSamples.RemoveAt(0, NumAcked, false);
+
+	// Replay the aim made since then on top of where the server actually put the turret
+	const float Error = FMath::FindDeltaAngleDegrees(PredictedYaw, TurretAim::DequantizeYaw(TurretAimAck.Yaw));
+	if (FMath::Abs(Error) > CVarTurretAimTolerance.GetValueOnGameThread())
+	{
+		TurretYaw = FRotator::NormalizeAxis(TurretYaw + Error);
+		for (FTurretAimSample& Sample : PendingAimSamples)
+		{
+			Sample.Yaw = TurretAim::QuantizeYaw(TurretAim::DequantizeYaw(Sample.Yaw) + Error);
+		}
+
+		if (TurretComponent)
+		{
+			TurretComponent->SetTurretYaw(TurretYaw);
+		}
+	}
+}
+
+void AMilitaryVehicleBase::Multicast_ShotFired_Implementation(const FProjectileShotEvent& Shot)
+{
+	// The server already fired the real round
+	if (GetNetMode() != NM_Client)
+	{
+		return;
+	}
+	CombatStats::Count(this, CombatStats::EEvent::Rpc);
+
+	if (UProjectileShotSubsystem* ShotSubsystem = GetWorld()->GetSubsystem<UProjectileShotSubsystem>())
+	{
+		ShotSubsystem->SimulateShot(this, Shot);
+	}
+}
+
+void AMilitaryVehicleBase::Multicast_ShotImpact_Implementation(const FProjectileImpactEvent& Impact)
+{
+	if (GetNetMode() != NM_Client)
+	{
+		return;
+	}
+	CombatStats::Count(this, CombatStats::EEvent::Rpc);
+
+	if (UProjectileShotSubsystem* ShotSubsystem = GetWorld()->GetSubsystem<UProjectileShotSubsystem>())
+	{
+		ShotSubsystem->HandleImpact(this, Impact.ShotId, Impact.Location);
 	}
 }
 
@@ -438,6 +1066,20 @@ void AMilitaryVehicleBase::SwitchCamera()
 	UpdateCameraState();
 }
 
+void AMilitaryVehicleBase::PossessedBy(AController* NewController)
+{
+	Super::PossessedBy(NewController);
+
+	RestartTurretAimStream();
+}
+
+void AMilitaryVehicleBase::UnPossessed()
+{
+	Super::UnPossessed();
+
+	RestartTurretAimStream();
+}
+
 void AMilitaryVehicleBase::PossessAsDriver(AController* VehicleController)
 {
 	if (VehicleController)
@@ -6,6 +6,13 @@
 #include "WheeledVehiclePawn.h"
 #include "AbilitySystemInterface.h"
 #include "AbilitySystemComponent.h"
+#include "MilitaryVehicleSim/Abilities/GameplayAbility_FireWeapon.h"
+#include "MilitaryVehicleSim/Networking/ProjectileShotSubsystem.h"
+#include "MilitaryVehicleSim/Networking/SnapshotInterpolation.h"
+#include "MilitaryVehicleSim/Networking/TurretAimStream.h"
+#include "MilitaryVehicleSim/Networking/VehicleMovementReplication.h"
+#include "MilitaryVehicleSim/Vehicles/VehicleArmorProfile.h"
+#include "MilitaryVehicleSim/Vehicles/VehicleInputQueue.h"
 #include "MilitaryVehicleBase.generated.h"
 
 class UCameraComponent;
@@ -17,6 +24,7 @@ class UAbilitySystemComponent;
 
 class UInputMappingContext;
 class UInputAction;
+enum class EVehicleInputAction : uint8;
 
 /**
  * 
@@ -26,10 +34,14 @@ class MILITARYVEHICLESIM_API AMilitaryVehicleBase : public AWheeledVehiclePawn,
 {
 	GENERATED_BODY()
 public:
-	AMilitaryVehicleBase();
+	AMilitaryVehicleBase(const FObjectInitializer& ObjectInitializer);
 
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+	virtual void OnRep_ReplicatedMovement() override;
 	virtual void Tick(float DeltaTime) override;
+	virtual void PossessedBy(AController* NewController) override;
+	virtual void UnPossessed() override;
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
 	// IAbilitySystemInterface
@@ -48,26 +60,63 @@ public:
 	UFUNCTION(Server, Reliable)
 	void Server_ToggleRole();
 
-	UFUNCTION(Server, Reliable)
-	void Server_RotateTurret(float YawInput, float CurrentYaw);
+	/** Owning gunner's aim samples, streamed at mvs.TurretAim.SendRate. */
+	UFUNCTION(Server, Unreliable)
+	void Server_TurretAim(const FTurretAimPacket& Packet);
 
-	UPROPERTY(ReplicatedUsing = OnRep_TurretYaw)
+	/** Current turret yaw. Authoritative on the server, predicted on the owning client. */
 	float TurretYaw;
 
 	UFUNCTION()
 	void OnRep_TurretYaw();
 
+	// Shot events, see UProjectileShotSubsystem
+	UFUNCTION(NetMulticast, Unreliable)
+	void Multicast_ShotFired(const FProjectileShotEvent& Shot);
+
+	UFUNCTION(NetMulticast, Unreliable)
+	void Multicast_ShotImpact(const FProjectileImpactEvent& Impact);
+
+	uint16 AllocateShotId() { return ++ShotSequence; }
+
 	// Camera management
 	void SwitchCamera();
 
+	// Programmatic control for AI controllers, routed through the same handlers as player input
+	void SetDriverInput(float Throttle, float Steering, float Brake);
+	void AddTurretYawInput(float YawInput);
+	/** One trigger pull: a single shot, or a whole burst for burst weapons. */
+	void FireWeapon();
+
+	/** Calls the input handler of a recorded action, see UInputRecordingSubsystem. */
+	void ApplyRecordedInput(EVehicleInputAction Action, const struct FInputActionValue& Value);
+
 	UFUNCTION(BlueprintCallable, Category = "Vehicle")
 	UHealthComponent* GetHealthComponent() const { return HealthComponent; }
 
+	UTurretComponent* GetTurretComponent() const { return TurretComponent; }
+
+	/** Expresses a hit at the vehicle's current pose in hull mesh space. */
+	FArmorHit MakeArmorHit(const FVector& Location, const FVector& Direction, const FVector& Normal, const UPrimitiveComponent* HitComponent) const;
+
+	/** Damage a round deals after this vehicle's armor; unchanged if the vehicle has no armor profile. */
+	float ResolveArmorDamage(const FArmorHit& Hit, float Damage, float PenetrationMm) const;
+
 	// Get typed vehicle movement component
 	UChaosWheeledVehicleMovementComponent* GetChaosVehicleMovement() const;
 
+	/** Latest hull state of the compact movement path, including the wheel and suspension summary. */
+	const FVehicleNetState& GetNetMovementState() const { return MovementSnapshot.GetLatest(); }
+
+	/** Movement bytes this machine received for this vehicle, for both replication paths. */
+	UFUNCTION(BlueprintCallable, Category = "Vehicle")
+	FVehicleMovementNetStats GetMovementNetStats() const { return MovementNetStats; }
+
+	void ResetMovementNetStats();
+
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	
 	// Input handlers
 	void OnThrottle(const struct FInputActionValue& Value);
@@ -78,6 +127,7 @@ protected:
 	void OnBrakeStarted(const struct FInputActionValue& Value);
 	void OnBrakeCompleted(const struct FInputActionValue& Value);
 	void OnFire(const struct FInputActionValue& Value);
+	void OnFireReleased(const struct FInputActionValue& Value);
 	void OnToggleRole(const struct FInputActionValue& Value);
 	void OnLookWithMouse(const struct FInputActionValue& Value);
 	
@@ -133,6 +183,10 @@ protected:
 	
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Abilities")
 	TArray<TSubclassOf<UGameplayAbility>> InitialAbilities;
+
+	/** Baked armor zones of this vehicle. Without one, every hit deals the round's flat damage. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Armor")
+	TObjectPtr<UVehicleArmorProfile> ArmorProfile;
 	
 	// Role state
 	UPROPERTY(ReplicatedUsing = OnRep_IsDriverRole)
@@ -141,6 +195,97 @@ protected:
 	UPROPERTY(Replicated)
 	bool bIsThirdPersonCamera;
 
+	/** TurretYaw for everyone but the owner, quantized so sub-step jitter never triggers a send. */
+	UPROPERTY(ReplicatedUsing = OnRep_TurretYaw)
+	uint16 ReplicatedTurretYaw;
+
+	/** Last applied aim sample, for the owner to reconcile its prediction against. */
+	UPROPERTY(ReplicatedUsing = OnRep_TurretAimAck)
+	FTurretAimAck TurretAimAck;
+
+	UFUNCTION()
+	void OnRep_TurretAimAck();
+
+	/** Hull movement when mvs.VehicleMovement.Compact is on, replacing FRepMovement. */
+	UPROPERTY(ReplicatedUsing = OnRep_MovementSnapshot)
+	FVehicleMovementSnapshot MovementSnapshot;
+
+	/** Server time ReplicatedMovement was gathered, for proxies to interpolate on; unused by the compact path. */
+	UPROPERTY(Replicated)
+	uint16 ReplicatedMovementTimeMs;
+
+	UFUNCTION()
+	void OnRep_MovementSnapshot();
+
 private:
+	friend struct FVehicleInterpolationTickFunction;
+
 	void UpdateCameraState();
+
+	/** Hands a player's input to UInputRecordingSubsystem; bot and playback input is not recorded. */
+	void RecordInput(EVehicleInputAction Action, const struct FInputActionValue& Value) const;
+
+	void SetAuthoritativeTurretYaw(float NewYaw);
+	void TickTurretAimStream(float DeltaTime);
+	void ApplyRemoteAim(float TargetYaw);
+
+	/** Server: starts a new aim stream epoch when control or role changes, so the new stream can start at sequence zero. */
+	void RestartTurretAimStream();
+	void ApplyTurretVisual();
+
+	/**
+	 * Simulated proxies with mvs.Interpolation.Enabled render from InterpolationBuffer instead of physics. Switches
+	 * between the two as the role or the cvar change; returns whether interpolating.
+	 */
+	bool UpdateInterpolatingMovement();
+	void AddInterpolationSample(const FRepMovement& Movement, uint16 TimeMs);
+
+	/** Runs from InterpolationTickFunction every frame, not from the significance-throttled actor tick. */
+	void TickInterpolation(float DeltaTime);
+
+	/** Client's estimate of the server's world time, or the local world time without a game state. */
+	double GetServerWorldTime() const;
+
+	/** Finds the granted ability tagged Ability.Fire and its fire schedule, once per grant rather than per shot. */
+	bool ResolveFireAbility();
+
+	/** Sends the shots the fire scheduler has due, in one batch. */
+	void UpdateWeaponFire();
+
+	/** Hands LatestDriverInput to the physics-thread step queue when the movement component takes step input. */
+	void QueueDriverInput();
+
+	// Owning client: samples sent but not yet acknowledged, oldest first
+	TArray<FTurretAimSample> PendingAimSamples;
+	uint16 AimSequence;
+	float AimSendAccumulator;
+	uint8 AimStreamEpoch;
+
+	// Server: last sample applied and how far the turret may still traverse right now
+	uint16 LastAppliedAimSequence;
+	float AimBudgetDegrees;
+
+	uint16 ShotSequence;
+
+	// Fire dispatch: the fire spec, its schedule and a payload reused by every batch with new target data
+	FGameplayAbilitySpecHandle FireAbilityHandle;
+	FWeaponFireSchedule FireSchedule;
+	FWeaponFireScheduler FireScheduler;
+	FGameplayEventData FirePayload;
+
+	// Proxies: replicated turret yaw not yet applied to the turret mesh
+	bool bTurretVisualDirty;
+
+	// Proxies: received hull and turret states on the server's timeline, rendered a few update intervals behind
+	FVehicleInterpolationBuffer InterpolationBuffer;
+	FVehicleInterpolationTickFunction InterpolationTickFunction;
+	bool bInterpolatingMovement;
+
+	// Server: ReplicatedMovement as last stamped, so an unchanged state keeps its stamp and isn't resent
+	FRepMovement LastStampedMovement;
+
+	FVehicleMovementNetStats MovementNetStats;
+
+	// Complete driver input for the physics step queue, see mvs.Vehicle.FixedStepInput
+	FVehicleInputSample LatestDriverInput;
 };
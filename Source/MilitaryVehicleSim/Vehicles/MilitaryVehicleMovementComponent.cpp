@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MilitaryVehicleMovementComponent.h"
+
+#include "HAL/IConsoleManager.h"
+#include "PhysicsEngine/PhysicsSettings.h"
+
+static TAutoConsoleVariable<bool> CVarFixedStepInput(
+	TEXT("mvs.Vehicle.FixedStepInput"),
+	false,
+	TEXT("Queue driver inputs with timestamps and apply them on the physics thread, per async physics step, instead of once ")
+	TEXT("per game frame. Needs async physics (bTickPhysicsAsync in [/Script/Engine.PhysicsSettings]); read when a vehicle's ")
+	TEXT("physics state is created."));
+
+namespace
+{
+	/** Wheeled simulation that replaces the marshalled driver input with the queued one current at each step. */
+	class FStepInputVehicleSimulation : public UChaosWheeledVehicleSimulation
+	{
+	public:
+		explicit FStepInputVehicleSimulation(const TSharedRef<FVehicleStepInputs, ESPMode::ThreadSafe>& InStepInputs)
+			: StepInputs(InStepInputs)
+		{
+		}
+
+		// Physics thread, once per step
+		virtual void ApplyInput(const FControlInputs& ControlInputs, float DeltaTime) override
+		{
+			FVehicleInputSample Sample;
+			while (StepInputs->Pending.Dequeue(Sample))
+			{
+				// The step clock starts at the first input and then advances by exactly the steps taken
+				if (!bHasStepTime)
+				{
+					StepTime = Sample.Time - DeltaTime;
+					bHasStepTime = true;
+				}
+				Inputs.Push(Sample);
+			}
+
+			if (!bHasStepTime)
+			{
+				UChaosWheeledVehicleSimulation::ApplyInput(ControlInputs, DeltaTime);
+				return;
+			}
+
+			StepTime += DeltaTime;
+			const FVehicleInputSample& Input = Inputs.ConsumeUpTo(StepTime);
+
+			FControlInputs StepControls = ControlInputs;
+			StepControls.ThrottleInput = Input.Throttle;
+			StepControls.SteeringInput = Input.Steering;
+			StepControls.BrakeInput = Input.Brake;
+			StepControls.HandbrakeInput = Input.bHandbrake ? 1.0f : 0.0f;
+			UChaosWheeledVehicleSimulation::ApplyInput(StepControls, DeltaTime);
+		}
+
+	private:
+		TSharedRef<FVehicleStepInputs, ESPMode::ThreadSafe> StepInputs;
+
+		// Physics thread only
+		FVehicleInputQueue Inputs;
+		double StepTime = 0.0;
+		bool bHasStepTime = false;
+	};
+}
+
+UMilitaryVehicleMovementComponent::UMilitaryVehicleMovementComponent()
+	: StepInputs(MakeShared<FVehicleStepInputs, ESPMode::ThreadSafe>())
+{
+}
+
+void UMilitaryVehicleMovementComponent::QueueStepInput(const FVehicleInputSample& Sample)
+{
+	if (bStepInputEnabled)
+	{
+		StepInputs->Pending.Enqueue(Sample);
+	}
+}
+
+TUniquePtr<Chaos::FSimpleWheeledVehicle> UMilitaryVehicleMovementComponent::CreatePhysicsVehicle()
+{
+	// Without async physics there are no fixed steps to apply inputs to
+	const UPhysicsSettings* PhysicsSettings = UPhysicsSettings::Get();
+	bStepInputEnabled = CVarFixedStepInput.GetValueOnGameThread() && PhysicsSettings->bTickPhysicsAsync && PhysicsSettings->AsyncFixedTimeStepSize > 0.0f;
+	if (!bStepInputEnabled)
+	{
+		return Super::CreatePhysicsVehicle();
+	}
+
+	// What the wheeled component does, with a simulation that reads the step queue
+	VehicleSimulationPT = MakeUnique<FStepInputVehicleSimulation>(StepInputs);
+	return UChaosVehicleMovementComponent::CreatePhysicsVehicle();
+}
@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ChaosWheeledVehicleMovementComponent.h"
+#include "Containers/Queue.h"
+#include "MilitaryVehicleSim/Vehicles/VehicleInputQueue.h"
+#include "MilitaryVehicleMovementComponent.generated.h"
+
+/** Driver inputs handed from the game thread to the vehicle's physics-thread simulation. */
+struct FVehicleStepInputs
+{
+	TQueue<FVehicleInputSample, EQueueMode::Spsc> Pending;
+};
+
+/**
+ * Wheeled movement whose physics-thread simulation can take the driver input per physics step. With step input
+ * enabled, input samples stamped with world time are queued here, and every async physics step applies the newest
+ * sample stamped at or before that step's time, instead of the one input Chaos marshals per game frame. Which step
+ * an input lands on depends only on its stamp and AsyncFixedTimeStepSize, not on the game frame rate.
+ *
+ * Needs async physics (bTickPhysicsAsync). Only inputs handled on the machine simulating the vehicle go through the
+ * queue; a remote client's inputs reach the server once per frame as usual.
+ */
+UCLASS()
+class MILITARYVEHICLESIM_API UMilitaryVehicleMovementComponent : public UChaosWheeledVehicleMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	UMilitaryVehicleMovementComponent();
+
+	/** Game thread: queues a complete driver input for the physics steps at or after its time. */
+	void QueueStepInput(const FVehicleInputSample& Sample);
+
+	/** Whether the physics vehicle was created with step input, by mvs.Vehicle.FixedStepInput at the time. */
+	bool IsStepInputEnabled() const { return bStepInputEnabled; }
+
+protected:
+	virtual TUniquePtr<Chaos::FSimpleWheeledVehicle> CreatePhysicsVehicle() override;
+
+private:
+	TSharedRef<FVehicleStepInputs, ESPMode::ThreadSafe> StepInputs;
+	bool bStepInputEnabled = false;
+};
@@ -0,0 +1,241 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VehicleArmorProfile.h"
+
+#include "Engine/SkeletalMesh.h"
+#include "MilitaryVehicleSim/MilitaryVehicleSim.h"
+#if WITH_EDITOR
+#include "AnimationRuntime.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#endif
+
+void UVehicleArmorProfile::PostLoad()
+{
+	Super::PostLoad();
+
+	BuildZoneTable();
+}
+
+#if WITH_EDITOR
+void UVehicleArmorProfile::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	if (PropertyChangedEvent.MemberProperty && PropertyChangedEvent.MemberProperty->GetMetaData(TEXT("Category")) == TEXT("Baking"))
+	{
+		BakeZoneGrid();
+	}
+	BuildZoneTable();
+}
+
+void UVehicleArmorProfile::BakeZones()
+{
+	Modify();
+	BakeZoneGrid();
+	BuildZoneTable();
+}
+
+void UVehicleArmorProfile::BakeZoneGrid()
+{
+	const USkeletalMesh* Mesh = SourceMesh.LoadSynchronous();
+	if (!Mesh)
+	{
+		GridBounds = FBox(ForceInit);
+		ZoneGrid.Reset();
+		return;
+	}
+
+	struct FZoneBody
+	{
+		const UBodySetup* BodySetup;
+		FTransform Transform;
+		/** Turret or Tracks; hull bodies are Num and take their zone from the cell's position. */
+		EArmorZone Zone;
+	};
+
+	const auto MatchesAny = [](const FString& BoneName, const TArray<FString>& Wildcards)
+	{
+		return Wildcards.ContainsByPredicate([&BoneName](const FString& Wildcard) { return BoneName.MatchesWildcard(Wildcard); });
+	};
+
+	// Bodies at the reference pose, in mesh space like the hits
+	TArray<FZoneBody> Bodies;
+	FBox Bounds(ForceInit);
+	const FVector Forward = LocalForward.GetSafeNormal(UE_SMALL_NUMBER, FVector::ForwardVector);
+	float HullMin = MAX_flt;
+	float HullMax = -MAX_flt;
+	if (const UPhysicsAsset* PhysicsAsset = Mesh->GetPhysicsAsset())
+	{
+		const FReferenceSkeleton& RefSkeleton = Mesh->GetRefSkeleton();
+		for (const TObjectPtr<USkeletalBodySetup>& BodySetup : PhysicsAsset->SkeletalBodySetups)
+		{
+			const int32 BoneIndex = BodySetup ? RefSkeleton.FindBoneIndex(BodySetup->BoneName) : INDEX_NONE;
+			if (BoneIndex == INDEX_NONE)
+			{
+				continue;
+			}
+
+			const FString BoneName = BodySetup->BoneName.ToString();
+			const EArmorZone Zone = MatchesAny(BoneName, TurretBones) ? EArmorZone::Turret : MatchesAny(BoneName, TrackBones) ? EArmorZone::Tracks : EArmorZone::Num;
+			const FZoneBody& Body = Bodies.Add_GetRef({ BodySetup, FAnimationRuntime::GetComponentSpaceTransformRefPose(RefSkeleton, BoneIndex), Zone });
+
+			const FBox BodyBounds = BodySetup->AggGeom.CalcAABB(Body.Transform);
+			Bounds += BodyBounds;
+			if (Body.Zone == EArmorZone::Num)
+			{
+				FVector Corners[8];
+				BodyBounds.GetVertices(Corners);
+				for (const FVector& Corner : Corners)
+				{
+					HullMin = FMath::Min(HullMin, static_cast<float>(FVector::DotProduct(Corner, Forward)));
+					HullMax = FMath::Max(HullMax, static_cast<float>(FVector::DotProduct(Corner, Forward)));
+				}
+			}
+		}
+	}
+
+	if (Bodies.Num() == 0 || !Bounds.bIsValid)
+	{
+		UE_LOG(LogMilitaryVehicle, Warning, TEXT("%s: %s has no physics bodies, baking zones from its bounds along +X"), *GetName(), *Mesh->GetName());
+		BakeZoneGridFromBounds(Mesh->GetBounds().GetBox());
+		return;
+	}
+
+	GridBounds = Bounds;
+	ZoneGrid.SetNumUninitialized(GridX * GridY * GridZ);
+	const FVector CellSize = Bounds.GetSize() / FVector(GridX, GridY, GridZ);
+	const float HullLength = FMath::Max(HullMax - HullMin, UE_KINDA_SMALL_NUMBER);
+
+	for (int32 Z = 0; Z < GridZ; ++Z)
+	{
+		for (int32 Y = 0; Y < GridY; ++Y)
+		{
+			for (int32 X = 0; X < GridX; ++X)
+			{
+				// Hits land on body surfaces, so even empty cells take the zone of the body nearest their centre
+				const FVector Centre = Bounds.Min + CellSize * FVector(X + 0.5f, Y + 0.5f, Z + 0.5f);
+				const FZoneBody* Nearest = nullptr;
+				float NearestDistance = MAX_flt;
+				for (const FZoneBody& Body : Bodies)
+				{
+					const float Distance = Body.BodySetup->GetShortestDistanceToPoint(Centre, Body.Transform);
+					if (Distance >= 0.0f && Distance < NearestDistance)
+					{
+						Nearest = &Body;
+						NearestDistance = Distance;
+					}
+				}
+
+				EArmorZone Zone = Nearest ? Nearest->Zone : EArmorZone::Side;
+				if (Zone == EArmorZone::Num)
+				{
+					const float U = (FVector::DotProduct(Centre, Forward) - HullMin) / HullLength;
+					Zone = U >= 1.0f - FrontFraction ? EArmorZone::Front : U <= RearFraction ? EArmorZone::Rear : EArmorZone::Side;
+				}
+
+				ZoneGrid[X + GridX * (Y + GridY * Z)] = static_cast<uint8>(Zone);
+			}
+		}
+	}
+}
+
+void UVehicleArmorProfile::BakeZoneGridFromBounds(const FBox& Bounds)
+{
+	GridBounds = Bounds;
+	ZoneGrid.SetNumUninitialized(GridX * GridY * GridZ);
+
+	for (int32 Z = 0; Z < GridZ; ++Z)
+	{
+		for (int32 Y = 0; Y < GridY; ++Y)
+		{
+			for (int32 X = 0; X < GridX; ++X)
+			{
+				// Classify each cell by its centre, as a fraction of the hull's length, width and height
+				const float U = (X + 0.5f) / GridX;
+				const float V = (Y + 0.5f) / GridY;
+				const float W = (Z + 0.5f) / GridZ;
+
+				EArmorZone Zone = EArmorZone::Side;
+				if (W >= TurretHeightFraction)
+				{
+					Zone = EArmorZone::Turret;
+				}
+				else if (W <= TrackHeightFraction && (V <= TrackWidthFraction || V >= 1.0f - TrackWidthFraction))
+				{
+					Zone = EArmorZone::Tracks;
+				}
+				else if (U >= 1.0f - FrontFraction)
+				{
+					Zone = EArmorZone::Front;
+				}
+				else if (U <= RearFraction)
+				{
+					Zone = EArmorZone::Rear;
+				}
+
+				ZoneGrid[X + GridX * (Y + GridY * Z)] = static_cast<uint8>(Zone);
+			}
+		}
+	}
+}
+#endif
+
+void UVehicleArmorProfile::BuildZoneTable()
+{
+	ZoneTable[static_cast<int32>(EArmorZone::Front)] = Front;
+	ZoneTable[static_cast<int32>(EArmorZone::Side)] = Side;
+	ZoneTable[static_cast<int32>(EArmorZone::Rear)] = Rear;
+	ZoneTable[static_cast<int32>(EArmorZone::Turret)] = Turret;
+	ZoneTable[static_cast<int32>(EArmorZone::Tracks)] = Tracks;
+
+	const FVector Size = GridBounds.bIsValid ? GridBounds.GetSize() : FVector::ZeroVector;
+	GridScale = FVector(
+		Size.X > 0.0 ? GridX / Size.X : 0.0,
+		Size.Y > 0.0 ? GridY / Size.Y : 0.0,
+		Size.Z > 0.0 ? GridZ / Size.Z : 0.0);
+
+	if (ZoneGrid.Num() != GridX * GridY * GridZ)
+	{
+		UE_LOG(LogMilitaryVehicle, Warning, TEXT("%s has no baked zone grid; every hull hit counts as side armor"), *GetName());
+	}
+}
+
+EArmorZone UVehicleArmorProfile::FindZone(const FArmorHit& Hit) const
+{
+	if (Hit.bTurret)
+	{
+		return EArmorZone::Turret;
+	}
+
+	if (ZoneGrid.Num() != GridX * GridY * GridZ)
+	{
+		return EArmorZone::Side;
+	}
+
+	// Hits land on the surface, so clamp into the grid rather than rejecting points just outside the bounds
+	const FVector Cell = (Hit.LocalLocation - GridBounds.Min) * GridScale;
+	const int32 X = FMath::Clamp(FMath::FloorToInt32(Cell.X), 0, GridX - 1);
+	const int32 Y = FMath::Clamp(FMath::FloorToInt32(Cell.Y), 0, GridY - 1);
+	const int32 Z = FMath::Clamp(FMath::FloorToInt32(Cell.Z), 0, GridZ - 1);
+	return static_cast<EArmorZone>(ZoneGrid[X + GridX * (Y + GridY * Z)]);
+}
+
+float UVehicleArmorProfile::ResolveDamage(const FArmorHit& Hit, float Damage, float PenetrationMm) const
+{
+	if (PenetrationMm <= 0.0f)
+	{
+		return Damage;
+	}
+
+	const FArmorZoneSettings& Zone = ZoneTable[static_cast<int32>(FindZone(Hit))];
+
+	// Sloped armor is thicker along the round's path by 1 / cos(obliquity)
+	const float MinCosObliquity = FMath::Cos(FMath::DegreesToRadians(MaxObliquityDegrees));
+	const float CosObliquity = FMath::Max(static_cast<float>(FVector::DotProduct(-Hit.LocalDirection, Hit.LocalNormal)), MinCosObliquity);
+	const float EffectiveThicknessMm = Zone.ThicknessMm / CosObliquity;
+
+	const float DamageScale = PenetrationMm >= EffectiveThicknessMm ? Zone.DamageMultiplier : NonPenetratingDamageScale;
+	return Damage * DamageScale;
+}
@@ -0,0 +1,164 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "VehicleArmorProfile.generated.h"
+
+class USkeletalMesh;
+
+UENUM()
+enum class EArmorZone : uint8
+{
+	Front,
+	Side,
+	Rear,
+	Turret,
+	Tracks,
+	Num UMETA(Hidden)
+};
+
+/** Protection of one armor zone. */
+USTRUCT()
+struct FArmorZoneSettings
+{
+	GENERATED_BODY()
+
+	/** Line-of-sight thickness at normal incidence, in millimetres. */
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "0.0"))
+	float ThicknessMm = 50.0f;
+
+	/** Scale on a round's damage once it gets through this zone. */
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "0.0"))
+	float DamageMultiplier = 1.0f;
+};
+
+/** A hit on a vehicle in the space of its hull mesh, so rewound poses resolve the same as current ones. */
+struct FArmorHit
+{
+	FVector LocalLocation = FVector::ZeroVector;
+	/** Unit travel direction of the round. */
+	FVector LocalDirection = FVector::ForwardVector;
+	/** Unit surface normal at the impact. */
+	FVector LocalNormal = -FVector::ForwardVector;
+	/** Hits on the turret component skip the zone grid. */
+	bool bTurret = false;
+};
+
+/**
+ * Armor zones of a vehicle class, baked into a coarse grid over the hull mesh's bounds so a hit resolves its zone
+ * with one cell lookup and its penetration with a little arithmetic, never another trace.
+ * Each cell takes the zone of the nearest body in SourceMesh's physics asset: turret and track bodies by bone name,
+ * hull bodies front, side or rear by where the cell lies along LocalForward. The grid is baked in the editor, with
+ * Bake Zones or by editing the baking settings, and saved with the asset; cooking and shipped builds only read it.
+ */
+UCLASS(BlueprintType)
+class MILITARYVEHICLESIM_API UVehicleArmorProfile : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	static constexpr int32 GridX = 16;
+	static constexpr int32 GridY = 8;
+	static constexpr int32 GridZ = 8;
+
+	EArmorZone FindZone(const FArmorHit& Hit) const;
+
+	/**
+	 * Damage a round deals through this armor. Rounds that fail to penetrate the zone at their angle of impact
+	 * only deal NonPenetratingDamageScale of it. Zero penetration means the round ignores armor.
+	 */
+	float ResolveDamage(const FArmorHit& Hit, float Damage, float PenetrationMm) const;
+
+	virtual void PostLoad() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+
+	/** Rebakes the zone grid from SourceMesh; run it again after the mesh or its physics asset changes. */
+	UFUNCTION(CallInEditor, Category = "Baking")
+	void BakeZones();
+#endif
+
+protected:
+	UPROPERTY(EditAnywhere, Category = "Armor")
+	FArmorZoneSettings Front;
+
+	UPROPERTY(EditAnywhere, Category = "Armor")
+	FArmorZoneSettings Side;
+
+	UPROPERTY(EditAnywhere, Category = "Armor")
+	FArmorZoneSettings Rear;
+
+	UPROPERTY(EditAnywhere, Category = "Armor")
+	FArmorZoneSettings Turret;
+
+	UPROPERTY(EditAnywhere, Category = "Armor")
+	FArmorZoneSettings Tracks;
+
+	UPROPERTY(EditAnywhere, Category = "Armor", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float NonPenetratingDamageScale = 0.1f;
+
+	/** Steepest obliquity that still counts, in degrees; flatter impacts are treated as this angle. */
+	UPROPERTY(EditAnywhere, Category = "Armor", meta = (ClampMin = "0.0", ClampMax = "89.0"))
+	float MaxObliquityDegrees = 80.0f;
+
+#if WITH_EDITORONLY_DATA
+	/** Hull mesh the zone grid is baked over, from the bodies of its physics asset. */
+	UPROPERTY(EditAnywhere, Category = "Baking")
+	TSoftObjectPtr<USkeletalMesh> SourceMesh;
+
+	/** Direction the hull faces in mesh space. */
+	UPROPERTY(EditAnywhere, Category = "Baking")
+	FVector LocalForward = FVector::ForwardVector;
+
+	/** Wildcards of the bones whose bodies count as turret armor. */
+	UPROPERTY(EditAnywhere, Category = "Baking")
+	TArray<FString> TurretBones = { TEXT("*turret*"), TEXT("*gun*") };
+
+	/** Wildcards of the bones whose bodies count as track armor. */
+	UPROPERTY(EditAnywhere, Category = "Baking")
+	TArray<FString> TrackBones = { TEXT("*track*"), TEXT("*wheel*") };
+
+	/** Share of the hull bodies' length, from the front, that counts as front armor. */
+	UPROPERTY(EditAnywhere, Category = "Baking", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float FrontFraction = 0.3f;
+
+	/** Share of the hull bodies' length, from the back, that counts as rear armor. */
+	UPROPERTY(EditAnywhere, Category = "Baking", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float RearFraction = 0.2f;
+
+	/**
+	 * Only for meshes without a physics asset, which are baked as a bounds-fraction approximation along +X: share of
+	 * the width on each side, and of the height from the bottom, taken up by the tracks.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Baking", meta = (ClampMin = "0.0", ClampMax = "0.5"))
+	float TrackWidthFraction = 0.15f;
+
+	UPROPERTY(EditAnywhere, Category = "Baking", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float TrackHeightFraction = 0.35f;
+
+	/** Only for meshes without a physics asset: share of the height, from the bottom, above which the mesh counts as turret. */
+	UPROPERTY(EditAnywhere, Category = "Baking", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float TurretHeightFraction = 0.7f;
+#endif
+
+private:
+#if WITH_EDITOR
+	void BakeZoneGrid();
+	void BakeZoneGridFromBounds(const FBox& Bounds);
+#endif
+	void BuildZoneTable();
+
+	/** Baked bounds of the hull mesh, in mesh space. */
+	UPROPERTY()
+	FBox GridBounds = FBox(ForceInit);
+
+	/** One EArmorZone per cell, X fastest. */
+	UPROPERTY()
+	TArray<uint8> ZoneGrid;
+
+	/** Zone settings indexed by EArmorZone, filled on load. */
+	FArmorZoneSettings ZoneTable[static_cast<int32>(EArmorZone::Num)];
+	FVector GridScale = FVector::ZeroVector;
+};
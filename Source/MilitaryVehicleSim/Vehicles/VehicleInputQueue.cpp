@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VehicleInputQueue.h"
+
+void FVehicleInputQueue::Push(const FVehicleInputSample& Sample)
+{
+	// Changes made within the same frame collapse into the last one
+	if (Samples.Num() > 0 && Samples.Last().Time >= Sample.Time)
+	{
+		Samples.Last() = Sample;
+		return;
+	}
+	Samples.Add(Sample);
+}
+
+const FVehicleInputSample& FVehicleInputQueue::ConsumeUpTo(double StepTime)
+{
+	int32 NumConsumed = 0;
+	while (NumConsumed < Samples.Num() && Samples[NumConsumed].Time <= StepTime)
+	{
+		Current = Samples[NumConsumed++];
+	}
+
+	if (NumConsumed > 0)
+	{
+		Samples.RemoveAt(0, NumConsumed, false);
+	}
+	return Current;
+}
@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Complete driver input state, stamped with the world time it was set at. */
+struct FVehicleInputSample
+{
+	double Time = 0.0;
+	float Throttle = 0.0f;
+	float Steering = 0.0f;
+	float Brake = 0.0f;
+	bool bHandbrake = false;
+};
+
+/**
+ * Driver inputs in the order they happened, consumed up to a step time. UMilitaryVehicleMovementComponent's
+ * physics-thread simulation consumes it once per async physics step, so each step applies the input current at its
+ * own time rather than whatever input the game frame that covered it ended with.
+ */
+class MILITARYVEHICLESIM_API FVehicleInputQueue
+{
+public:
+	/** Appends a sample. Samples must arrive in time order. */
+	void Push(const FVehicleInputSample& Sample);
+
+	/** Advances to the latest sample at or before StepTime and drops everything older. */
+	const FVehicleInputSample& ConsumeUpTo(double StepTime);
+
+	/** Sample applied by the last ConsumeUpTo. */
+	const FVehicleInputSample& GetCurrent() const { return Current; }
+
+	int32 Num() const { return Samples.Num(); }
+
+private:
+	TArray<FVehicleInputSample> Samples;
+	FVehicleInputSample Current;
+};
@@ -0,0 +1,198 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VehicleSignificanceSubsystem.h"
+
+#include "ChaosWheeledVehicleMovementComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "MilitaryVehicleSim/Networking/MilitaryVehicleReplicationGraph.h"
+#include "MilitaryVehicleSim/Vehicles/MilitaryVehicleBase.h"
+
+static TAutoConsoleVariable<bool> CVarSignificanceEnabled(
+	TEXT("mvs.Significance.Enabled"),
+	true,
+	TEXT("Step vehicle tick, animation, turret and replication rates down with distance from the nearest viewer."));
+
+static TAutoConsoleVariable<float> CVarSignificanceUpdateInterval(
+	TEXT("mvs.Significance.UpdateInterval"),
+	0.25f,
+	TEXT("Seconds between significance updates."));
+
+static TAutoConsoleVariable<float> CVarSignificanceHiddenTime(
+	TEXT("mvs.Significance.HiddenTime"),
+	0.5f,
+	TEXT("Seconds without being rendered after which a client treats a vehicle as the lowest tier."));
+
+bool UVehicleSignificanceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UVehicleSignificanceSubsystem::Deinitialize()
+{
+	Vehicles.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId UVehicleSignificanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UVehicleSignificanceSubsystem, STATGROUP_Tickables);
+}
+
+void UVehicleSignificanceSubsystem::RegisterVehicle(AMilitaryVehicleBase* Vehicle)
+{
+	if (!Vehicle)
+	{
+		return;
+	}
+
+	FTrackedVehicle& Tracked = Vehicles.AddDefaulted_GetRef();
+	Tracked.Vehicle = Vehicle;
+	Tracked.DefaultNetUpdateFrequency = Vehicle->NetUpdateFrequency;
+}
+
+void UVehicleSignificanceSubsystem::UnregisterVehicle(AMilitaryVehicleBase* Vehicle)
+{
+	const int32 Index = Vehicles.IndexOfByPredicate([Vehicle](const FTrackedVehicle& Tracked)
+	{
+		return Tracked.Vehicle.Get() == Vehicle;
+	});
+
+	if (Index != INDEX_NONE)
+	{
+		Vehicles.RemoveAtSwap(Index, 1, false);
+	}
+}
+
+void UVehicleSignificanceSubsystem::Tick(float DeltaTime)
+{
+	TimeUntilUpdate -= DeltaTime;
+	if (TimeUntilUpdate > 0.0f || Tiers.Num() == 0)
+	{
+		return;
+	}
+	TimeUntilUpdate = CVarSignificanceUpdateInterval.GetValueOnGameThread();
+
+	UpdateSignificance();
+}
+
+int32 UVehicleSignificanceSubsystem::GetTierForDistanceSquared(float DistanceSquared) const
+{
+	for (int32 TierIndex = 0; TierIndex < Tiers.Num(); ++TierIndex)
+	{
+		if (Tiers[TierIndex].MaxDistance <= 0.0f || DistanceSquared <= FMath::Square(Tiers[TierIndex].MaxDistance))
+		{
+			return TierIndex;
+		}
+	}
+	return Tiers.Num() - 1;
+}
+
+void UVehicleSignificanceSubsystem::UpdateSignificance()
+{
+	UWorld* World = GetWorld();
+	const bool bEnabled = CVarSignificanceEnabled.GetValueOnGameThread();
+	const bool bCanRender = World->GetNetMode() != NM_DedicatedServer;
+	const float HiddenTime = CVarSignificanceHiddenTime.GetValueOnGameThread();
+
+	// Server: every connection's view point. Clients only have their local controllers.
+	ViewLocations.Reset();
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (const APlayerController* PlayerController = It->Get())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			ViewLocations.Add(ViewLocation);
+		}
+	}
+
+	const int32 LowestTier = Tiers.Num() - 1;
+	for (int32 Index = Vehicles.Num() - 1; Index >= 0; --Index)
+	{
+		FTrackedVehicle& Tracked = Vehicles[Index];
+		AMilitaryVehicleBase* Vehicle = Tracked.Vehicle.Get();
+		if (!Vehicle)
+		{
+			Vehicles.RemoveAtSwap(Index, 1, false);
+			continue;
+		}
+
+		int32 NetTier = 0;
+		int32 VisualTier = 0;
+		if (bEnabled && !Vehicle->IsLocallyControlled())
+		{
+			// With nobody watching at all, every vehicle falls to the lowest tier
+			float NearestDistanceSquared = MAX_flt;
+			const FVector Location = Vehicle->GetActorLocation();
+			for (const FVector& ViewLocation : ViewLocations)
+			{
+				NearestDistanceSquared = FMath::Min(NearestDistanceSquared, FVector::DistSquared(Location, ViewLocation));
+			}
+
+			NetTier = GetTierForDistanceSquared(NearestDistanceSquared);
+			VisualTier = bCanRender && !Vehicle->WasRecentlyRendered(HiddenTime) ? LowestTier : NetTier;
+		}
+
+		if (Tracked.NetTier != NetTier)
+		{
+			ApplyNetTier(Tracked, NetTier);
+		}
+		if (Tracked.VisualTier != VisualTier)
+		{
+			ApplyVisualTier(Tracked, VisualTier);
+		}
+	}
+}
+
+void UVehicleSignificanceSubsystem::ApplyNetTier(FTrackedVehicle& Tracked, int32 TierIndex) const
+{
+	Tracked.NetTier = TierIndex;
+
+	AMilitaryVehicleBase* Vehicle = Tracked.Vehicle.Get();
+	if (!Vehicle->HasAuthority())
+	{
+		return;
+	}
+
+	const float NetUpdateFrequency = FMath::Max(1.0f, Tracked.DefaultNetUpdateFrequency * Tiers[TierIndex].NetUpdateFrequencyScale);
+	Vehicle->NetUpdateFrequency = NetUpdateFrequency;
+
+	// The replication graph keeps its own per-actor period, taken from the class when the actor was added
+	const UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (UMilitaryVehicleReplicationGraph* RepGraph = NetDriver ? Cast<UMilitaryVehicleReplicationGraph>(NetDriver->GetReplicationDriver()) : nullptr)
+	{
+		RepGraph->SetActorNetUpdateFrequency(Vehicle, NetUpdateFrequency);
+	}
+}
+
+void UVehicleSignificanceSubsystem::ApplyVisualTier(FTrackedVehicle& Tracked, int32 TierIndex) const
+{
+	Tracked.VisualTier = TierIndex;
+
+	AMilitaryVehicleBase* Vehicle = Tracked.Vehicle.Get();
+	const FVehicleSignificanceTier& Tier = Tiers[TierIndex];
+
+	// The authority's tick aims turrets and fires weapons, and mesh and movement drive physics on the authority and the
+	// owner, so only proxies are stepped down. The server scales down through NetUpdateFrequency instead.
+	if (Vehicle->GetLocalRole() != ROLE_SimulatedProxy)
+	{
+		return;
+	}
+
+	Vehicle->SetActorTickInterval(Tier.TickInterval);
+	if (USkeletalMeshComponent* Mesh = Vehicle->GetMesh())
+	{
+		Mesh->SetComponentTickInterval(Tier.AnimTickInterval);
+	}
+	if (UChaosWheeledVehicleMovementComponent* Movement = Vehicle->GetChaosVehicleMovement())
+	{
+		Movement->SetComponentTickInterval(Tier.MovementTickInterval);
+	}
+}
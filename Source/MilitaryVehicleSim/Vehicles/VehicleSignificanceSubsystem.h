@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "VehicleSignificanceSubsystem.generated.h"
+
+class AMilitaryVehicleBase;
+
+/** Update rates for vehicles within one distance band of the nearest viewer. */
+USTRUCT()
+struct FVehicleSignificanceTier
+{
+	GENERATED_BODY()
+
+	/** Upper bound of the band. Zero means unbounded; the last tier should use it. */
+	UPROPERTY(Config)
+	float MaxDistance = 0.0f;
+
+	/** Actor tick interval on simulated proxies, which also paces their turret visual updates. */
+	UPROPERTY(Config)
+	float TickInterval = 0.0f;
+
+	/** Tick interval of the mesh and its anim instance on simulated proxies. */
+	UPROPERTY(Config)
+	float AnimTickInterval = 0.0f;
+
+	/** Tick interval of the vehicle movement component on simulated proxies. */
+	UPROPERTY(Config)
+	float MovementTickInterval = 0.0f;
+
+	/** Scale applied to the vehicle's default NetUpdateFrequency on the server. */
+	UPROPERTY(Config)
+	float NetUpdateFrequencyScale = 1.0f;
+};
+
+/**
+ * Ranks every vehicle by distance to the nearest viewer and steps its update rates down by tier. On the server the
+ * viewers are every player controller's view point, so NetUpdateFrequency follows the closest connection; clients
+ * use their local camera and also treat vehicles that were not rendered recently as the lowest tier.
+ * Locally controlled vehicles always stay at full rate. Tiers are configured in DefaultGame.ini.
+ */
+UCLASS(Config = Game)
+class MILITARYVEHICLESIM_API UVehicleSignificanceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void RegisterVehicle(AMilitaryVehicleBase* Vehicle);
+	void UnregisterVehicle(AMilitaryVehicleBase* Vehicle);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	UPROPERTY(Config)
+	TArray<FVehicleSignificanceTier> Tiers;
+
+private:
+	struct FTrackedVehicle
+	{
+		TWeakObjectPtr<AMilitaryVehicleBase> Vehicle;
+		float DefaultNetUpdateFrequency = 0.0f;
+		int32 NetTier = INDEX_NONE;
+		int32 VisualTier = INDEX_NONE;
+	};
+
+	int32 GetTierForDistanceSquared(float DistanceSquared) const;
+	void UpdateSignificance();
+	void ApplyNetTier(FTrackedVehicle& Tracked, int32 TierIndex) const;
+	void ApplyVisualTier(FTrackedVehicle& Tracked, int32 TierIndex) const;
+
+	TArray<FTrackedVehicle> Vehicles;
+	TArray<FVector> ViewLocations;
+	float TimeUntilUpdate = 0.0f;
+};